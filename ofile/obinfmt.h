@@ -0,0 +1,80 @@
+#ifndef OBINFMT_H
+#define OBINFMT_H
+/*=============================================================================
+MIT License
+
+Copyright(c) 2019 willywood
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+=============================================================================*/
+
+///////////////////////////////////////////////////////////////////////////
+// The binary interchange format written by OOStreamBinary and read by
+// OIStreamBinary. It carries the same information as the XML format, but it
+// is compact and needs no parsing. It does not depend on the build
+// (OFILE_64BIT_FILE_ADDRESSES, the size of a long) or on the byte order of
+// the machine, so it can be used for backup and for moving objects between
+// builds and machines.
+//
+// Document: "OFBX", a version byte, the byte order mark cByteOrder as four
+//           bytes in the order of the writer, the root identity, the
+//           application name as a string, then records until cEnd.
+// Record:   a tag byte. Except for cDefine and cEnd it is followed by the
+//           index of its label in the string table, or 0 if it has none.
+// cDefine   A string. It is added to the string table. The first string
+//           has the index 1. Labels and class names are written once.
+// cObject   Class id, index of the class name, identity and version,
+//           followed by the records of the object and cEnd.
+// cBegin    A contained object(beginObject()). Records and cEnd follow.
+//
+// Integers and lengths are variable length(LEB128), signed values are zigzag
+// encoded(see OUtilityFunction). Reals are written in the byte order of the
+// writer and are swapped by a reader with the other byte order. Strings and
+// byte data are a length followed by the bytes.
+///////////////////////////////////////////////////////////////////////////
+
+class OBinaryFormat
+{
+public:
+	enum {cVersion = 1};
+	enum {cByteOrder = 0x01020408};
+	enum Tag {cDefine = 1,
+			  cObject,      // Class id, class name, identity, version
+			  cEnd,         // End of an object or the document
+			  cBegin,
+			  cInt,         // Short, long and 64 bit long
+			  cChar,        // One byte
+			  cBool,        // One byte, 0 or 1
+			  cFloat,       // Four bytes
+			  cDouble,      // Eight bytes
+			  cString,      // Length and bytes
+			  cWChar,       // Unsigned integer
+			  cWString,     // Length and unsigned integers
+			  cBytes,       // Length and bytes
+			  cBits,        // Length and bytes
+			  cIntArray,    // Length and integers
+			  cFloatArray,  // Length and four bytes each
+			  cDoubleArray, // Length and eight bytes each
+			  cRef,         // Identity or 0
+			  cBlob         // Length and bytes
+			  };
+	static const char *magic(void){return "OFBX";}
+};
+
+#endif  // OBINFMT_H
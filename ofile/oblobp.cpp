@@ -50,20 +50,31 @@ SOFTWARE.
 #include "oblobp.h"
 #include "ostrm.h"
 #include "ofile.h"
+#include "ox.h"
 
 
 OBlobP::BlobAllocator OBlobP::ballocator;
 OFMemoryRegister OBlobP::_cache;
+unsigned long OBlobP::_sBudget = 0;
+OBlobP *OBlobP::_sHead = 0;
+OBlobP *OBlobP::_sTail = 0;
+
+// Guards the list of blobs in memory.
+static OFMutex sListMutex;
 
 OBlobP::OBlobP(void):_blobLength(0),_file(0),_mark(0),
 					 _fileLength(0),
-					 _blob(0),_dirty(true)
+					 _blob(0),_dirty(true),
+					 _ranges(0),_lastRange(0),_rangeLength(0),_placed(false),
+					 _prev(0),_next(0)
 // Default constructor
 {}
 
 OBlobP::OBlobP(char * blob, size_t size):_blobLength(size),_file(0),_mark(0),
 										_fileLength(0),_blob(blob),
-										_dirty(true)
+										_dirty(true),
+										_ranges(0),_lastRange(0),_rangeLength(0),_placed(false),
+										_prev(0),_next(0)
 // Existing data constructor. Takes over responsibility for managing the 
 // data pointed to by blob.
 {
@@ -72,7 +83,9 @@ OBlobP::OBlobP(char * blob, size_t size):_blobLength(size),_file(0),_mark(0),
 }
 
 
-OBlobP::OBlobP(OIStream *in):_blobLength(0),_mark(0),_blob(0),_dirty(false)
+OBlobP::OBlobP(OIStream *in):_blobLength(0),_mark(0),_blob(0),_dirty(false),
+							 _ranges(0),_lastRange(0),_rangeLength(0),_placed(false),
+							 _prev(0),_next(0)
 // Read from file constructor.
 // The blob data is not actually read yet. It will be read only
 // when accessed.
@@ -111,7 +124,9 @@ void OBlobP::read(OIStream *in)
 
 OBlobP::OBlobP(size_t size):_blobLength(size),_file(0),_mark(0),
 							_fileLength(0),
-							_dirty(true)
+							_dirty(true),
+							_ranges(0),_lastRange(0),_rangeLength(0),_placed(false),
+							_prev(0),_next(0)
 // Empty blob constructor
 {
 	_blob = new char[size];
@@ -120,23 +135,26 @@ OBlobP::OBlobP(size_t size):_blobLength(size),_file(0),_mark(0),
 }
 
 OBlobP::OBlobP(const OBlobP &from):_file(0),_mark(0),
-								   _fileLength(0),_dirty(true)
+								   _fileLength(0),_dirty(true),
+								   _ranges(0),_lastRange(0),_rangeLength(0),_placed(false),
+								   _prev(0),_next(0)
 // Copy constructor.
 {
-	// get the blob into memory.
-	from.const_getBlob();
+	// get the blob data.
+	const char *data = from.const_getBlob();
+	oulong length = from.size();
 
-	if(from._blobLength != 0)
+	if(length != 0)
 	{
-		_blob = new char[from._blobLength];
-		memcpy(getBlob(),from.const_getBlob(),from._blobLength);
+		_blob = new char[length];
+		memcpy(_blob,data,length);
 	}
 	else
 	{
 		_blob = 0;
 	}
 
-	_blobLength = from._blobLength;
+	_blobLength = length;
 
 	// Add to global cache
 	_cache.add(_blobLength);
@@ -145,6 +163,8 @@ OBlobP::OBlobP(const OBlobP &from):_file(0),_mark(0),
 OBlobP::~OBlobP(void)
 // Destructor
 {
+	unlink();
+	freeRanges();
 	delete []_blob;
 
 	// Subtract from global cache
@@ -156,23 +176,25 @@ OBlobP& OBlobP::operator =(const OBlobP &from)
 // Assignment operator
 {
 	// Get rid of old data.
+	freeRanges();
 	delete []_blob;
 
 	// Subtract from global cache
 	_cache.subtract(_blobLength);
 
-	// get the blob into memory.
-	from.const_getBlob();
+	// get the blob data.
+	const char *data = from.const_getBlob();
+	oulong length = from.size();
 
-	if(from._blobLength != 0)
+	if(length != 0)
 	{
-		_blob = new char[from._blobLength];
-		memcpy(getBlob(),from.const_getBlob(),from._blobLength);
+		_blob = new char[length];
+		memcpy(_blob,data,length);
 	}
 	else
 		_blob = 0;
 
-	_blobLength = from._blobLength;
+	_blobLength = length;
 	// Add to global cache
 	_cache.add(_blobLength);
 
@@ -205,13 +227,81 @@ void OBlobP::oWrite(OOStream *out,const char *label)const
 	// If this is not the case you probably failed to attach it to a file.
 	oFAssert(_file == out->file());
 
+	if(_dirty && _ranges)
+	{
+		if(_rangeLength != _fileLength)
+		{
+		// This should not be entered on the second pass of commit , otherwise
+		// it can corrupt the free list calculation.
+
+			// The blob has grown. Move the data that is in the file to a
+			// new place, without reading it into memory.
+			OFilePos_t mark = _file->getSpace(_rangeLength);
+			_file->copyBlob(_mark,mark,_fileLength);
+			_file->freeBlobSpace(_mark,_fileLength);
+			// Cast away const
+			((OBlobP *)this)->_mark = mark;
+			((OBlobP *)this)->_fileLength = _rangeLength;
+		}
+
+		out->writeBlobHeader(_mark,_fileLength);
+
+		// Write only the changed parts.
+		if(out->writing())
+		{
+			for(Range *r = _ranges; r; r = r->next)
+				out->writeBlob(r->data,_mark + r->offset,r->length,label);
+			// Cast away const
+			((OBlobP *)this)->freeRanges();
+			((OBlobP *)this)->_dirty = false;
+		}
+		return;
+	}
+
+	if(_dirty && _blob && _blobLength && _file->hasSharedBlobs())
+	{
+		// The space may be shared with other blobs, so it is never written
+		// over. New space is found for the data once in each commit.
+		if(!_placed)
+		{
+		// This should not be entered on the second pass of commit, otherwise
+		// it can corrupt the free list calculation. Commit streams every
+		// dirty object in its first pass when blobs are shared.
+
+			if(_mark)
+				_file->freeBlobSpace(_mark,_fileLength);
+
+			bool write;
+			// Cast away const
+			((OBlobP *)this)->_mark = _file->getBlobSpace(_blob,_blobLength,write);
+			((OBlobP *)this)->_fileLength = _blobLength;
+			if(write)
+				((OBlobP *)this)->_placed = true;
+			else
+				// Another blob has already written the same data.
+				((OBlobP *)this)->_dirty = false;
+		}
+
+		out->writeBlobHeader(_mark,_fileLength);
+
+		if(_dirty && out->writeBlob(_blob,_mark,_fileLength,label))
+		{
+			((OBlobP *)this)->_dirty = false;
+			((OBlobP *)this)->_placed = false;
+		}
+		// Now that it is clean it can be purged.
+		if(_sBudget && !_dirty)
+			touch();
+		return;
+	}
+
 	if(_dirty && _mark && (_blobLength != _fileLength))
 	{
 	// This should not be entered on the second pass of commit , otherwise
 	// it can corrupt the free list calculation.
 
 		// Free the space in the file if the length has changed
-		_file->freeSpace(_mark,_fileLength);
+		_file->freeBlobSpace(_mark,_fileLength);
 		// Cast away const
 		((OBlobP *)this)->_mark = 0;
 		// Cast away const
@@ -235,6 +325,10 @@ void OBlobP::oWrite(OOStream *out,const char *label)const
 		((OBlobP*)this)->_dirty = !out->writeBlob(_blob, _mark, _fileLength, label);
 	}
 
+	// Now that it is clean it can be purged.
+	if(_sBudget && _blob && !_dirty)
+		touch();
+
 }
 
 char * OBlobP::getBlob(void)const
@@ -247,31 +341,58 @@ char * OBlobP::getBlob(void)const
 	if(!_blob && _file)
 	{
 		// Multiple processes on the same file should not enter at the same time.
-		OFGuard(_file->mutex());
+		OFGuard guard(_file->mutex());
 
-		if(_mark && _fileLength)
+		if((_mark && _fileLength) || _ranges)
 		{
+			oulong length = size();
+
 			// Blob is not in memory
 			// Create some memory.
-			((OBlobP*) this)->_blob = new char[_fileLength];
-			// Read from file.
-			_file->readBlob(_blob,_mark,_fileLength);
+			char *blob = new char[length];
+			// Read from file, together with any uncommitted writes.
+			readRange(0,length,blob);
+			((OBlobP *)this)->freeRanges();
 
-			((OBlobP *)this)->_blobLength = _fileLength;
+			((OBlobP*) this)->_blob = blob;
+			((OBlobP *)this)->_blobLength = length;
 
 			// Add to global cache
 			_cache.add(_blobLength);
 		}
 	}
+
+	if(_sBudget && _blob && _file)
+	{
+		// Make room for this blob by purging the least recently used.
+		touch();
+		purgeColdest(this);
+	}
 	return(_blob);
 }
 
+const char *OBlobP::view(void)const
+// Get the blob data for reading only. If the blob is not in memory and
+// its file is mapped, this points straight into the mapping and no memory
+// is allocated. Otherwise the blob is read into memory as by getBlob().
+// Returns adress of blob data or 0 if there is none.
+{
+	if(!_blob && !_ranges && _file && _mark && _fileLength)
+	{
+		const char *view = _file->view(_mark,_fileLength);
+		if(view)
+			return view;
+	}
+	return getBlob();
+}
+
 void OBlobP::setBlob(char * blob,size_t size)
 // Set the blobs data, to blob. The blob takes over responsibility for
 // the data, so it must not be deleted by anyone else. Any previous data
 // will be deallocated.
 {
 	// Deallocate previous blobs memory
+	freeRanges();
 	delete []_blob;
 
 	// Subtract from global cache
@@ -297,6 +418,8 @@ void OBlobP::copyToBlob(const char *from,oulong size)
 	// object in a valid state.
 	char *newBlob = new char[size];
 
+	freeRanges();
+
 	if(_blob)
 	{
 		// Deallocate previous blobs memory
@@ -339,11 +462,13 @@ void OBlobP::oDetach(OFile *)
 
 	if(_mark){
 		// Free the space in the file.
-		_file->freeSpace(_mark,_fileLength);
+		_file->freeBlobSpace(_mark,_fileLength);
 		_mark = 0;
 		_fileLength = 0;
 	}
 
+	// It can no longer be read again, so it must not be purged.
+	unlink();
 	_file = 0;
 }
 
@@ -357,6 +482,8 @@ bool OBlobP::purge(void)
 	oFAssert(_file);
 	if(!_dirty)
 	{
+		unlink();
+
 		// Deallocate previous blobs memory
 		delete []_blob;
 
@@ -381,9 +508,254 @@ size_t OBlobP::size(void)const
 	{
 		return _blobLength;
 	}
+	else if (_ranges)
+	{
+		return _rangeLength;
+	}
 	else
 	{
 		return _fileLength;
 	}
 }
 
+
+void OBlobP::readRange(oulong offset,oulong length,void *buf)const
+// Read length bytes of the blob data, starting at offset, into buf.
+// If the blob is not in memory the data is read straight from the file.
+{
+	oFAssert(offset + length <= size());
+
+	if(_blob)
+	{
+		if(_sBudget && _file)
+			touch();
+		memcpy(buf,_blob + offset,length);
+		return;
+	}
+
+	if(!length)
+		return;
+
+	// Multiple processes on the same file should not enter at the same time.
+	OFGuard guard(_file->mutex());
+
+	if(offset < _fileLength)
+	{
+		oulong end = offset + length < _fileLength ? offset + length : _fileLength;
+		const char *view = _file->view(_mark,_fileLength);
+		if(view)
+			memcpy(buf,view + offset,end - offset);
+		else
+			_file->readBlob(buf,_mark + offset,end - offset);
+	}
+
+	// Overlay the writes that are not yet in the file. Anything beyond
+	// _fileLength is covered by these.
+	for(Range *r = _ranges; r; r = r->next)
+	{
+		oulong from = offset > r->offset ? offset : r->offset;
+		oulong to = offset + length < r->offset + r->length ? offset + length : r->offset + r->length;
+		if(from < to)
+			memcpy((char *)buf + (from - offset),r->data + (from - r->offset),to - from);
+	}
+}
+
+void OBlobP::writeRange(oulong offset,oulong length,const void *buf)
+// Write length bytes from buf to the blob data, starting at offset.
+// Writing past the end extends the blob, but offset must be within it.
+// If the blob is in a file but not in memory the data is kept until the
+// next commit, which writes only the changed parts. A blob that has grown
+// is moved in the file without being read into memory.
+{
+	oFAssert(offset <= size());
+
+	if(!length)
+		return;
+
+	if(!_blob && _file && _mark && !_file->isCompact() && !_file->hasSharedBlobs())
+	{
+		if(!_ranges)
+			_rangeLength = _fileLength;
+
+		addRange(offset,length,(const char *)buf);
+
+		if(offset + length > _rangeLength)
+			_rangeLength = offset + length;
+	}
+	else
+	{
+		// Make sure the blob is in memory
+		getBlob();
+
+		if(offset + length > _blobLength)
+		{
+			// Do this first because if it throws an exception we want to leave the
+			// object in a valid state.
+			char *newBlob = new char[offset + length];
+
+			if(_blob)
+				memcpy(newBlob,_blob,_blobLength);
+			delete []_blob;
+
+			// Add to global cache
+			_cache.add(offset + length - _blobLength);
+
+			_blob = newBlob;
+			_blobLength = offset + length;
+		}
+		memcpy(_blob + offset,buf,length);
+	}
+
+	oSetDirty();
+}
+
+oulong OBlobP::Reader::read(void *buf,oulong length)
+// Read up to length bytes from the current position.
+// Return the number of bytes read.
+{
+	oulong size = _blob.size();
+	if(_pos >= size)
+		return 0;
+	if(length > size - _pos)
+		length = size - _pos;
+
+	_blob.readRange(_pos,length,buf);
+	_pos += length;
+	return length;
+}
+
+void OBlobP::setMemoryBudget(unsigned long budget)
+// Static
+// Purge clean blobs that are in a file, the least recently used first,
+// when the memory used by all blobs exceeds budget bytes. This is checked
+// whenever a blob is used, and now. A purged blob is read again when it
+// is next used. 0 turns purging off.
+// The list of blobs in memory is shared by all files, and a blob would be
+// purged by whichever thread uses another, while the data of the first
+// may be in use. So with OF_MULTI_THREAD there is no budget.
+// Exceptions: OFileErr is thrown if a budget is set with OF_MULTI_THREAD.
+{
+#ifdef OF_MULTI_THREAD
+	if(budget)
+		throw OFileErr("A blob memory budget cannot be set with OF_MULTI_THREAD.");
+#endif
+	_sBudget = budget;
+	if(_sBudget)
+		purgeColdest(0);
+}
+
+// ========================= P R I V A T E =======================================
+
+void OBlobP::touch(void)const
+// Move the blob to the front of the list of blobs in memory.
+{
+	OFGuard guard(sListMutex);
+
+	OBlobP *self = (OBlobP *)this;
+	if(_sHead == self)
+		return;
+
+	self->unlink();
+
+	self->_next = _sHead;
+	if(_sHead)
+		_sHead->_prev = self;
+	else
+		_sTail = self;
+	_sHead = self;
+}
+
+void OBlobP::unlink(void)
+// Remove the blob from the list of blobs in memory, if it is there.
+{
+	OFGuard guard(sListMutex);
+
+	if(!_prev && _sHead != this)
+		return;
+
+	if(_prev)
+		_prev->_next = _next;
+	else
+		_sHead = _next;
+	if(_next)
+		_next->_prev = _prev;
+	else
+		_sTail = _prev;
+	_prev = _next = 0;
+}
+
+void OBlobP::purgeColdest(const OBlobP *keep)
+// Static
+// Purge the least recently used clean blobs, other than keep, until the
+// memory used is within the budget.
+{
+	OFGuard guard(sListMutex);
+
+	OBlobP *blob = _sTail;
+	while(blob && _cache.size() > _sBudget)
+	{
+		OBlobP *prev = blob->_prev;
+		if(blob != keep && !blob->_dirty)
+			blob->purge();
+		blob = prev;
+	}
+}
+
+void OBlobP::addRange(oulong offset,oulong length,const char *buf)
+// Keep a write until commit. A write that follows on from the last one
+// is added to it, so that writing a piece at a time does not fragment.
+{
+	Range *r = _lastRange;
+
+	if(!r || r->offset + r->length != offset)
+	{
+		r = new Range;
+		r->offset = offset;
+		r->length = 0;
+		r->capacity = 0;
+		r->data = 0;
+		r->next = 0;
+
+		if(_lastRange)
+			_lastRange->next = r;
+		else
+			_ranges = r;
+		_lastRange = r;
+	}
+
+	if(r->length + length > r->capacity)
+	{
+		oulong capacity = r->capacity * 2 > r->length + length ? r->capacity * 2 : r->length + length;
+		char *data = new char[capacity];
+		memcpy(data,r->data,r->length);
+		delete []r->data;
+
+		// Add to global cache
+		_cache.add(capacity - r->capacity);
+
+		r->data = data;
+		r->capacity = capacity;
+	}
+
+	memcpy(r->data + r->length,buf,length);
+	r->length += length;
+}
+
+void OBlobP::freeRanges(void)
+// Discard the uncommitted writes.
+{
+	while(_ranges)
+	{
+		Range *r = _ranges;
+		_ranges = r->next;
+
+		// Subtract from global cache
+		_cache.subtract(r->capacity);
+
+		delete []r->data;
+		delete r;
+	}
+	_lastRange = 0;
+	_rangeLength = 0;
+}
+
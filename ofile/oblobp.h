@@ -45,6 +45,18 @@ SOFTWARE.
 // 2.  If the blob is changed by accessing the pointer returned by getBlob()
 // then oSetDirty() should be called for the blob, to ensure the changes get saved.
 //
+// 3.  setMemoryBudget() purges clean blobs automatically, the least
+// recently used first, when all blobs use more memory than the budget.
+// They are read again when they are next used. A pointer returned by
+// getBlob() is then only valid until another blob is read, and changes
+// must be marked with oSetDirty() before that. The blobs in memory are
+// purged by whichever thread uses a blob, so with OF_MULTI_THREAD a budget
+// cannot be set.
+//
+// 4.  Large blobs need not be read into memory. readRange(), writeRange()
+// and append(), or the Reader and Writer classes built on them, work
+// against the blob's data in the file. Only the changed data is held in
+// memory until the next commit, and only that is written.
 //
 //======================================================================
 
@@ -76,8 +88,10 @@ public:
 
 	// Use this if you are going to change the blob data.
 	char * getBlob(void)const;
-	// Use this if you are not going to change the blob data.
-	const char *const_getBlob(void)const{return (const char *)getBlob();}
+	// Use this if you are not going to change the blob data. In a mapped
+	// file(see OFILE_MMAP) it is not copied into memory.
+	const char *const_getBlob(void)const{return view();}
+	const char *view(void)const;
 
 	void setBlob(char * blob,size_t size);
 	void copyToBlob(const char *from,oulong size);
@@ -90,8 +104,44 @@ public:
 	void oWrite(OOStream *,const char *label = 0)const;
 	bool purge(void);
 
+	// Ranged access. These do not read the whole blob into memory.
+	void readRange(oulong offset,oulong length,void *buf)const;
+	void writeRange(oulong offset,oulong length,const void *buf);
+	void append(const void *buf,oulong length){writeRange(size(),length,buf);}
+
+	// Reads the blob a piece at a time.
+	class Reader
+	{
+	public:
+		Reader(const OBlobP &blob,oulong pos = 0):_blob(blob),_pos(pos){}
+		oulong read(void *buf,oulong length);
+		void seek(oulong pos){_pos = pos;}
+		oulong tell(void)const{return _pos;}
+		bool eof(void)const{return _pos >= _blob.size();}
+	private:
+		const OBlobP &_blob;
+		oulong _pos;
+	};
+
+	// Writes the blob a piece at a time. Writing past the end appends.
+	class Writer
+	{
+	public:
+		Writer(OBlobP &blob,oulong pos = 0):_blob(blob),_pos(pos){}
+		void write(const void *buf,oulong length){_blob.writeRange(_pos,length,buf);_pos += length;}
+		void seek(oulong pos){_pos = pos;}
+		oulong tell(void)const{return _pos;}
+	private:
+		OBlobP &_blob;
+		oulong _pos;
+	};
+
 	// Total memory usage of all instances.
 	static unsigned long currentTotalMemoryUsage(void){return _cache.size();}
+	// Purge clean blobs when the total memory usage exceeds budget bytes.
+	// 0(the default) turns it off. Not available with OF_MULTI_THREAD.
+	static void setMemoryBudget(unsigned long budget);
+	static unsigned long memoryBudget(void){return _sBudget;}
 
 	class BlobAllocator
 	{
@@ -111,7 +161,34 @@ private:
 						  // currently in memory, or no data.
 	bool _dirty;
 
+	// A write to the blob's data in the file that is not yet committed.
+	struct Range
+	{
+		oulong offset;
+		oulong length;
+		oulong capacity;
+		char *data;
+		Range *next;
+	};
+	Range *_ranges;       // Uncommitted writes, oldest first.
+	Range *_lastRange;
+	oulong _rangeLength;  // Length of the blob including _ranges.
+	bool _placed;         // Space has been found for the data in this commit.
+
+	void addRange(oulong offset,oulong length,const char *buf);
+	void freeRanges(void);
+
+	// Blobs in memory that belong to a file, the most recently used first.
+	OBlobP *_prev;
+	OBlobP *_next;
+	void touch(void)const;
+	void unlink(void);
+	static void purgeColdest(const OBlobP *keep);
+
 	static OFMemoryRegister _cache; // Keeps track of memory usage.
+	static unsigned long _sBudget;
+	static OBlobP *_sHead;
+	static OBlobP *_sTail;
 };
 
 
@@ -42,7 +42,12 @@ SOFTWARE.
 // 2.  If the blob is changed by accessing the pointer returned by getBlob()
 // then oSetDirty() should be called for the blob, to ensure the changes get saved.
 //
-// 3.  Many compilers require that you instantiate the template in one
+// 3.  Large blobs need not be read into memory. readRange(), writeRange()
+// and append(), or the Reader and Writer classes built on them, work
+// against the blob's data in the file. Only the changed data is held in
+// memory until the next commit, and only that is written.
+//
+// 4.  Many compilers require that you instantiate the template in one
 // of the source files. If not, your compilation will succeed, but link
 // will fail. This can be done as follows:
 // For the following blob type
@@ -87,10 +92,13 @@ public:
 	BlobT getBlob(void)const;
 	// Use this if you are not going to change the blob data.
 	const BlobT const_getBlob(void)const{return (const BlobT)getBlob();}
+	// The blob data for reading only. In a mapped file(see OFILE_MMAP) it
+	// is not copied into memory.
+	const void *view(void)const;
 
 	void setBlob(BlobT blob,oulong size);
 	void copyToBlob(const BlobT from,oulong size);
-	oulong size(void)const{return _blob ? _blobLength : _fileLength;}
+	oulong size(void)const{return _blob ? _blobLength : (_ranges ? _rangeLength : _fileLength);}
 
 	void oAttach(OFile *file);
 	void oDetach(OFile *file = 0);
@@ -100,6 +108,37 @@ public:
 	void oWrite(OOStream *,const char *label = 0)const;
 	bool purge(void);
 
+	// Ranged access. These do not read the whole blob into memory.
+	void readRange(oulong offset,oulong length,void *buf)const;
+	void writeRange(oulong offset,oulong length,const void *buf);
+	void append(const void *buf,oulong length){writeRange(size(),length,buf);}
+
+	// Reads the blob a piece at a time.
+	class Reader
+	{
+	public:
+		Reader(const OBlobT &blob,oulong pos = 0):_blob(blob),_pos(pos){}
+		oulong read(void *buf,oulong length);
+		void seek(oulong pos){_pos = pos;}
+		oulong tell(void)const{return _pos;}
+		bool eof(void)const{return _pos >= _blob.size();}
+	private:
+		const OBlobT &_blob;
+		oulong _pos;
+	};
+
+	// Writes the blob a piece at a time. Writing past the end appends.
+	class Writer
+	{
+	public:
+		Writer(OBlobT &blob,oulong pos = 0):_blob(blob),_pos(pos){}
+		void write(const void *buf,oulong length){_blob.writeRange(_pos,length,buf);_pos += length;}
+		void seek(oulong pos){_pos = pos;}
+		oulong tell(void)const{return _pos;}
+	private:
+		OBlobT &_blob;
+		oulong _pos;
+	};
 
 	static BlobAllocator ballocator;
 
@@ -113,28 +152,47 @@ private:
 	BlobT _blob;          // Handle of blob in memory. _blob == 0 if not
 						  // currently in memory, or no data.
 	bool _dirty;
+
+	// A write to the blob's data in the file that is not yet committed.
+	struct Range
+	{
+		oulong offset;
+		oulong length;
+		oulong capacity;
+		char *data;
+		Range *next;
+	};
+	Range *_ranges;       // Uncommitted writes, oldest first.
+	Range *_lastRange;
+	oulong _rangeLength;  // Length of the blob including _ranges.
+	bool _placed;         // Space has been found for the data in this commit.
+
+	void addRange(oulong offset,oulong length,const char *buf);
+	void freeRanges(void);
 };
 
 
 template <class T,class BlobAllocator>
 OBlobT<T,BlobAllocator>::OBlobT(void):_blobLength(0), _file(0),_mark(0),
 									  _fileLength(0),_blob(0),
-									  _dirty(true)
+									  _dirty(true),
+									  _ranges(0),_lastRange(0),_rangeLength(0),_placed(false)
 // Default constructor
 {}
 
 template <class T,class BlobAllocator>
 OBlobT<T,BlobAllocator>::OBlobT(BlobT blob,oulong size):_blobLength(size), _file(0),_mark(0),
  														_fileLength(0),_blob(blob),
- 														_dirty(true)
+ 														_dirty(true),
+									  _ranges(0),_lastRange(0),_rangeLength(0),_placed(false)
 // Existing data constructor. Takes over responsibility for managing the 
 // data pointed to by blob.
 {}
 
 
 template <class T,class BlobAllocator>
-OBlobT<T,BlobAllocator>::OBlobT(OIStream *in):_blobLength(0), _mark(0), _blob(0),_dirty(false)
-											  
+OBlobT<T,BlobAllocator>::OBlobT(OIStream *in):_blobLength(0), _mark(0), _blob(0),_dirty(false),
+									  _ranges(0),_lastRange(0),_rangeLength(0),_placed(false)
 // Read from file constructor.
 // The blob data is not actually read yet. It will be read only
 // when accessed.
@@ -178,7 +236,8 @@ void OBlobT<T,BlobAllocator>::read(OIStream *in)
 template <class T,class BlobAllocator>
 OBlobT<T,BlobAllocator>::OBlobT(oulong size):_blobLength(size), _file(0),_mark(0),
 											 _fileLength(0),
-											 _dirty(true)
+											 _dirty(true),
+									  _ranges(0),_lastRange(0),_rangeLength(0),_placed(false)
 // Empty blob constructor
 {
 	_blob = ballocator.allocate(size);
@@ -187,7 +246,8 @@ OBlobT<T,BlobAllocator>::OBlobT(oulong size):_blobLength(size), _file(0),_mark(0
 template <class T,class BlobAllocator>
 OBlobT<T,BlobAllocator>::OBlobT(const OBlobT<T,BlobAllocator> &from):
 											  _file(0),_mark(0),
-											  _fileLength(0),_dirty(true)
+											  _fileLength(0),_dirty(true),
+									  _ranges(0),_lastRange(0),_rangeLength(0),_placed(false)
 // Copy constructor.
 {
 	// get the blob into memory.
@@ -211,6 +271,7 @@ OBlobT<T,BlobAllocator>::OBlobT(const OBlobT<T,BlobAllocator> &from):
 template <class T,class BlobAllocator>
 OBlobT<T,BlobAllocator>::~OBlobT(void)
 {
+	freeRanges();
 	if(_blob)
 		ballocator.deallocate(_blob);
 }
@@ -222,6 +283,7 @@ OBlobT<T,BlobAllocator>& OBlobT<T,BlobAllocator>::
 // Assignment operator
 {
 	// Get rid of old data.
+	freeRanges();
 	if(_blob)
 		ballocator.deallocate(_blob);
 
@@ -266,13 +328,78 @@ void OBlobT<T,BlobAllocator>::oWrite(OOStream *out,const char *label)const
 	// If this is not the case you proably failed to attach it to a file.
 	oFAssert(_file == out->file());
 
+	if(_dirty && _ranges)
+	{
+		if(_rangeLength != _fileLength)
+		{
+		// This should not be entered on the second pass of commit , otherwise
+		// it can corrupt the free list calculation.
+
+			// The blob has grown. Move the data that is in the file to a
+			// new place, without reading it into memory.
+			OFilePos_t mark = _file->getSpace(_rangeLength);
+			_file->copyBlob(_mark,mark,_fileLength);
+			_file->freeBlobSpace(_mark,_fileLength);
+			// Cast away const
+			((OBlobT<T,BlobAllocator> *)this)->_mark = mark;
+			((OBlobT<T,BlobAllocator> *)this)->_fileLength = _rangeLength;
+		}
+
+		out->writeBlobHeader(_mark,_fileLength);
+
+		// Write only the changed parts.
+		if(out->writing())
+		{
+			for(Range *r = _ranges; r; r = r->next)
+				out->writeBlob(r->data,_mark + r->offset,r->length,label);
+			// Cast away const
+			((OBlobT<T,BlobAllocator> *)this)->freeRanges();
+			((OBlobT<T,BlobAllocator> *)this)->_dirty = false;
+		}
+		return;
+	}
+
+	if(_dirty && _blob && _blobLength && _file->hasSharedBlobs())
+	{
+		// The space may be shared with other blobs, so it is never written
+		// over. New space is found for the data once in each commit.
+		if(!_placed)
+		{
+		// This should not be entered on the second pass of commit, otherwise
+		// it can corrupt the free list calculation. Commit streams every
+		// dirty object in its first pass when blobs are shared.
+
+			if(_mark)
+				_file->freeBlobSpace(_mark,_fileLength);
+
+			bool write;
+			// Cast away const
+			((OBlobT<T,BlobAllocator> *)this)->_mark = _file->getBlobSpace(ballocator.address(_blob),_blobLength,write);
+			((OBlobT<T,BlobAllocator> *)this)->_fileLength = _blobLength;
+			if(write)
+				((OBlobT<T,BlobAllocator> *)this)->_placed = true;
+			else
+				// Another blob has already written the same data.
+				((OBlobT<T,BlobAllocator> *)this)->_dirty = false;
+		}
+
+		out->writeBlobHeader(_mark,_fileLength);
+
+		if(_dirty && out->writeBlob(ballocator.address(_blob),_mark,_fileLength,label))
+		{
+			((OBlobT<T,BlobAllocator> *)this)->_dirty = false;
+			((OBlobT<T,BlobAllocator> *)this)->_placed = false;
+		}
+		return;
+	}
+
 	if(_dirty && _mark && (_blobLength != _fileLength))
 	{
 	// This should not be entered on the second pass of commit , otherwise
 	// it can corrupt the free list calculation.
 
 		// Free the space in the file if the length has changed
-		_file->freeSpace(_mark,_fileLength);
+		_file->freeBlobSpace(_mark,_fileLength);
 		// Cast away const
 		((OBlobT<T,BlobAllocator> *)this)->_mark = 0;
 		// Cast away const
@@ -304,31 +431,50 @@ typename OBlobT<T,BlobAllocator>::BlobT  OBlobT<T,BlobAllocator>::getBlob(void)c
 	if(!_blob && _file)
 	{
 		// Multiple processes on the same file should not enter at the same time.
-		OFGuard(_file->mutex());
+		OFGuard guard(_file->mutex());
 
-		if(_mark && _fileLength)
+		if((_mark && _fileLength) || _ranges)
 		{
+			oulong length = size();
+
 			// Blob is not in memory
-			// cast away const on
-			((OBlobT<T,BlobAllocator> *)this)->
 			// Create some memory. 
-			_blob = ballocator.allocate(_fileLength);
-			// Read from file.
-			_file->readBlob(ballocator.address(_blob),_mark,_fileLength);
+			BlobT blob = ballocator.allocate(length);
+			// Read from file, together with any uncommitted writes.
+			readRange(0,length,ballocator.address(blob));
 			// cast away const
-			((OBlobT<T,BlobAllocator> *)this)->
-			_blobLength = _fileLength;
+			((OBlobT<T,BlobAllocator> *)this)->freeRanges();
+			((OBlobT<T,BlobAllocator> *)this)->_blob = blob;
+			((OBlobT<T,BlobAllocator> *)this)->_blobLength = length;
 		}
 	}
 	return(_blob);
 }
 
+template <class T,class BlobAllocator>
+const void *OBlobT<T,BlobAllocator>::view(void)const
+// Get the blob data for reading only. If the blob is not in memory and
+// its file is mapped, this points straight into the mapping and no memory
+// is allocated. Otherwise the blob is read into memory as by getBlob().
+// Returns adress of blob data or 0 if there is none.
+{
+	if(!_blob && !_ranges && _file && _mark && _fileLength)
+	{
+		const char *view = _file->view(_mark,_fileLength);
+		if(view)
+			return view;
+	}
+	BlobT blob = getBlob();
+	return blob ? ballocator.address(blob) : 0;
+}
+
 template <class T,class BlobAllocator>
 void OBlobT<T,BlobAllocator>::setBlob(BlobT blob,oulong size)
 // Set the blobs data, to blob. The blob takes over responsibility for
 // the data, so it must not be deleted by anyone else. Any previous data
 // will be deallocated.
 {
+	freeRanges();
 	if(_blob)
 		// Deallocate previous blobs memory
 		ballocator.deallocate(_blob);
@@ -350,6 +496,7 @@ void OBlobT<T,BlobAllocator>::copyToBlob(const BlobT from,oulong size)
 	// object in a valid state.
 	BlobT newBlob = ballocator.allocate(size);
 
+	freeRanges();
 	if(_blob)
 		// Deallocate previous blobs memory
 		ballocator.deallocate(_blob);
@@ -390,7 +537,7 @@ void OBlobT<T,BlobAllocator>::oDetach(OFile * /* file = 0 */)
 
 	if(_mark){
 		// Free the space in the file.
-		_file->freeSpace(_mark,_fileLength);
+		_file->freeBlobSpace(_mark,_fileLength);
 		_mark = 0;
 		_fileLength = 0;
 	}
@@ -423,6 +570,163 @@ bool OBlobT<T,BlobAllocator>::purge(void)
 		return false;
 }
 
+template <class T,class BlobAllocator>
+void OBlobT<T,BlobAllocator>::readRange(oulong offset,oulong length,void *buf)const
+// Read length bytes of the blob data, starting at offset, into buf.
+// If the blob is not in memory the data is read straight from the file.
+{
+	oFAssert(offset + length <= size());
+
+	if(_blob)
+	{
+		memcpy(buf,(char *)ballocator.address(_blob) + offset,length);
+		return;
+	}
+
+	if(!length)
+		return;
+
+	// Multiple processes on the same file should not enter at the same time.
+	OFGuard guard(_file->mutex());
+
+	if(offset < _fileLength)
+	{
+		oulong end = offset + length < _fileLength ? offset + length : _fileLength;
+		const char *view = _file->view(_mark,_fileLength);
+		if(view)
+			memcpy(buf,view + offset,end - offset);
+		else
+			_file->readBlob(buf,_mark + offset,end - offset);
+	}
+
+	// Overlay the writes that are not yet in the file. Anything beyond
+	// _fileLength is covered by these.
+	for(Range *r = _ranges; r; r = r->next)
+	{
+		oulong from = offset > r->offset ? offset : r->offset;
+		oulong to = offset + length < r->offset + r->length ? offset + length : r->offset + r->length;
+		if(from < to)
+			memcpy((char *)buf + (from - offset),r->data + (from - r->offset),to - from);
+	}
+}
+
+template <class T,class BlobAllocator>
+void OBlobT<T,BlobAllocator>::writeRange(oulong offset,oulong length,const void *buf)
+// Write length bytes from buf to the blob data, starting at offset.
+// Writing past the end extends the blob, but offset must be within it.
+// If the blob is in a file but not in memory the data is kept until the
+// next commit, which writes only the changed parts. A blob that has grown
+// is moved in the file without being read into memory.
+{
+	oFAssert(offset <= size());
+
+	if(!length)
+		return;
+
+	if(!_blob && _file && _mark && !_file->isCompact() && !_file->hasSharedBlobs())
+	{
+		if(!_ranges)
+			_rangeLength = _fileLength;
+
+		addRange(offset,length,(const char *)buf);
+
+		if(offset + length > _rangeLength)
+			_rangeLength = offset + length;
+	}
+	else
+	{
+		// Make sure the blob is in memory
+		getBlob();
+
+		if(offset + length > _blobLength)
+		{
+			// Do this first because if it throws an exception we want to leave the
+			// object in a valid state.
+			BlobT newBlob = ballocator.allocate(offset + length);
+
+			if(_blob)
+			{
+				memcpy(ballocator.address(newBlob),ballocator.address(_blob),_blobLength);
+				ballocator.deallocate(_blob);
+			}
+
+			_blob = newBlob;
+			_blobLength = offset + length;
+		}
+		memcpy((char *)ballocator.address(_blob) + offset,buf,length);
+	}
+
+	oSetDirty();
+}
+
+template <class T,class BlobAllocator>
+oulong OBlobT<T,BlobAllocator>::Reader::read(void *buf,oulong length)
+// Read up to length bytes from the current position.
+// Return the number of bytes read.
+{
+	oulong size = _blob.size();
+	if(_pos >= size)
+		return 0;
+	if(length > size - _pos)
+		length = size - _pos;
+
+	_blob.readRange(_pos,length,buf);
+	_pos += length;
+	return length;
+}
+
+template <class T,class BlobAllocator>
+void OBlobT<T,BlobAllocator>::addRange(oulong offset,oulong length,const char *buf)
+// Keep a write until commit. A write that follows on from the last one
+// is added to it, so that writing a piece at a time does not fragment.
+{
+	Range *r = _lastRange;
+
+	if(!r || r->offset + r->length != offset)
+	{
+		r = new Range;
+		r->offset = offset;
+		r->length = 0;
+		r->capacity = 0;
+		r->data = 0;
+		r->next = 0;
+
+		if(_lastRange)
+			_lastRange->next = r;
+		else
+			_ranges = r;
+		_lastRange = r;
+	}
+
+	if(r->length + length > r->capacity)
+	{
+		oulong capacity = r->capacity * 2 > r->length + length ? r->capacity * 2 : r->length + length;
+		char *data = new char[capacity];
+		memcpy(data,r->data,r->length);
+		delete []r->data;
+		r->data = data;
+		r->capacity = capacity;
+	}
+
+	memcpy(r->data + r->length,buf,length);
+	r->length += length;
+}
+
+template <class T,class BlobAllocator>
+void OBlobT<T,BlobAllocator>::freeRanges(void)
+// Discard the uncommitted writes.
+{
+	while(_ranges)
+	{
+		Range *r = _ranges;
+		_ranges = r->next;
+		delete []r->data;
+		delete r;
+	}
+	_lastRange = 0;
+	_rangeLength = 0;
+}
+
 // Define the static allocator.
 template <class T,class BlobAllocator>
 BlobAllocator OBlobT<T,BlobAllocator>::ballocator;
@@ -0,0 +1,305 @@
+#ifndef OCHUNKT_H
+#define OCHUNKT_H
+/*=============================================================================
+MIT License
+
+Copyright(c) 2019 willywood
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+=============================================================================*/
+
+
+
+//======================================================================
+// OChunkBlobT : A large blob stored as a table of fixed size chunks.
+// Each chunk is a blob of its own, so Blob is a blob type such as an
+// OBlobT instantiation or OBlobP.
+//
+// A chunk is only read when its data is accessed, and only chunks that
+// have been changed are rewritten on commit. Growing the blob adds chunks
+// or grows the last one, so the rest of the data is never moved, and no
+// large contiguous space is needed in the file.
+//
+// Use:
+//
+// 1.  As with the other blobs, call oAttach() and oDetach() from the
+// containing classes overidden virtual functions of the same name.
+//
+// 2.  Change the data with writeRange() or append(). These mark the
+// changed chunks dirty, but the containing object must still be made
+// dirty for the chunk table to be saved.
+//
+//======================================================================
+
+#include <vector>
+#include "ostrm.h"
+#include "oistrm.h"
+#include "ofile.h"
+
+using std::vector;
+
+
+template <class Blob>
+class OChunkBlobT{
+public:
+	enum {cDefaultChunkSize = 65536};
+
+	// Default constructor
+	OChunkBlobT(oulong chunkSize = cDefaultChunkSize);
+
+	OChunkBlobT(OIStream *in);
+	// Copy constructor
+	OChunkBlobT(const OChunkBlobT &from);
+
+	~OChunkBlobT(void);
+
+	OChunkBlobT& operator =(const OChunkBlobT& from);
+
+	void read(OIStream *in);
+
+	oulong size(void)const{return _length;}
+	oulong chunkSize(void)const{return _chunkSize;}
+	// The chunks may be accessed individually.
+	size_t chunks(void)const{return _chunks.size();}
+	Blob &chunk(size_t i)const{return *_chunks[i];}
+
+	void readRange(oulong offset,oulong length,void *buf)const;
+	void writeRange(oulong offset,oulong length,const void *buf);
+	void append(const void *buf,oulong length){writeRange(_length,length,buf);}
+
+	void oAttach(OFile *file);
+	void oDetach(OFile *file = 0);
+	void oSetDirty(bool d = true);
+	bool oAttached(void)const{return _file != 0;}
+
+	void oWrite(OOStream *,const char *label = 0)const;
+	bool purge(void);
+
+private:
+	void clear(void);
+	void copy(const OChunkBlobT &from);
+
+	oulong _chunkSize;       // Length in bytes of every chunk but the last.
+	oulong _length;          // The current length in bytes of the blob.
+	vector<Blob *> _chunks;  // The chunk table.
+	OFile *_file;            // The file to which the blob is attached.
+};
+
+
+template <class Blob>
+OChunkBlobT<Blob>::OChunkBlobT(oulong chunkSize):_chunkSize(chunkSize),_length(0),_file(0)
+// Default constructor
+{
+	oFAssert(_chunkSize);
+}
+
+template <class Blob>
+OChunkBlobT<Blob>::OChunkBlobT(OIStream *in):_chunkSize(cDefaultChunkSize),_length(0),_file(0)
+// Read from file constructor.
+// The chunk data is not actually read yet. It will be read only
+// when accessed.
+{
+	read(in);
+}
+
+template <class Blob>
+OChunkBlobT<Blob>::OChunkBlobT(const OChunkBlobT<Blob> &from):_chunkSize(from._chunkSize),
+															  _length(0),_file(0)
+// Copy constructor. The copy is not attached to a file.
+{
+	copy(from);
+}
+
+template <class Blob>
+OChunkBlobT<Blob>::~OChunkBlobT(void)
+{
+	clear();
+}
+
+template <class Blob>
+OChunkBlobT<Blob>& OChunkBlobT<Blob>::operator =(const OChunkBlobT<Blob> &from)
+// Assignment operator. The chunks of an attached blob are replaced, and
+// their space in the file is freed.
+{
+	if(this != &from)
+	{
+		OFile *file = _file;
+		if(file)
+			oDetach();
+		clear();
+
+		_chunkSize = from._chunkSize;
+		copy(from);
+
+		if(file)
+			oAttach(file);
+	}
+	return *this;
+}
+
+template <class Blob>
+void OChunkBlobT<Blob>::read(OIStream *in)
+// Read the chunk table from file.
+// This should only be used on an empty, unattached blob.
+{
+	oFAssert(_chunks.empty());
+
+	_chunkSize = in->readLong("_chunkSize");
+	_length = in->readLong64("_length");
+	long n = in->readLong("_chunks");
+
+	_chunks.reserve(n);
+	for(long i = 0; i < n; i++)
+		_chunks.push_back(new Blob(in));
+
+	_file = in->file();
+}
+
+template <class Blob>
+void OChunkBlobT<Blob>::oWrite(OOStream *out,const char *label)const
+// Write the chunk table to the stream. Each chunk writes its own data
+// only if it has changed.
+{
+	out->writeLong((O_LONG)_chunkSize,"_chunkSize");
+	out->writeLong64(_length,"_length");
+	out->writeLong((O_LONG)_chunks.size(),"_chunks");
+
+	for(size_t i = 0; i < _chunks.size(); i++)
+		_chunks[i]->oWrite(out,label);
+}
+
+template <class Blob>
+void OChunkBlobT<Blob>::readRange(oulong offset,oulong length,void *buf)const
+// Read length bytes of the blob data, starting at offset, into buf.
+// Only the chunks that hold the range are read.
+{
+	oFAssert(offset + length <= _length);
+
+	while(length)
+	{
+		size_t i = (size_t)(offset / _chunkSize);
+		oulong from = offset % _chunkSize;
+		oulong n = _chunkSize - from < length ? _chunkSize - from : length;
+
+		_chunks[i]->readRange(from,n,buf);
+
+		buf = (char *)buf + n;
+		offset += n;
+		length -= n;
+	}
+}
+
+template <class Blob>
+void OChunkBlobT<Blob>::writeRange(oulong offset,oulong length,const void *buf)
+// Write length bytes from buf to the blob data, starting at offset.
+// Writing past the end extends the blob, but offset must be within it.
+// Only the chunks that hold the range are made dirty.
+{
+	oFAssert(offset <= _length);
+
+	while(length)
+	{
+		size_t i = (size_t)(offset / _chunkSize);
+		oulong from = offset % _chunkSize;
+		oulong n = _chunkSize - from < length ? _chunkSize - from : length;
+
+		if(i == _chunks.size())
+		{
+			// Start a new chunk.
+			Blob *chunk = new Blob;
+			if(_file)
+				chunk->oAttach(_file);
+			_chunks.push_back(chunk);
+		}
+
+		_chunks[i]->writeRange(from,n,buf);
+
+		buf = (const char *)buf + n;
+		offset += n;
+		length -= n;
+		if(offset > _length)
+			_length = offset;
+	}
+}
+
+template <class Blob>
+void OChunkBlobT<Blob>::oAttach(OFile *file)
+// Attach all the chunks to a file.
+{
+	oFAssert(!_file);
+
+	_file = file;
+	for(size_t i = 0; i < _chunks.size(); i++)
+		_chunks[i]->oAttach(file);
+}
+
+template <class Blob>
+void OChunkBlobT<Blob>::oDetach(OFile * /* file = 0 */)
+// Detach all the chunks from a file. This reads them into memory.
+{
+	oFAssert(_file);
+
+	for(size_t i = 0; i < _chunks.size(); i++)
+		_chunks[i]->oDetach(_file);
+	_file = 0;
+}
+
+template <class Blob>
+void OChunkBlobT<Blob>::oSetDirty(bool d)
+// Set all the chunks dirty or clean.
+{
+	for(size_t i = 0; i < _chunks.size(); i++)
+		_chunks[i]->oSetDirty(d);
+}
+
+template <class Blob>
+bool OChunkBlobT<Blob>::purge(void)
+// Purge the chunks that have not changed from memory.
+// Return true if all the chunks were purged.
+{
+	bool purged = true;
+	for(size_t i = 0; i < _chunks.size(); i++)
+		if(!_chunks[i]->purge())
+			purged = false;
+	return purged;
+}
+
+// ========================= P R I V A T E =======================================
+
+template <class Blob>
+void OChunkBlobT<Blob>::clear(void)
+// Delete the chunks.
+{
+	for(size_t i = 0; i < _chunks.size(); i++)
+		delete _chunks[i];
+	_chunks.clear();
+	_length = 0;
+}
+
+template <class Blob>
+void OChunkBlobT<Blob>::copy(const OChunkBlobT<Blob> &from)
+// Copy the chunks of another blob into memory.
+{
+	_chunks.reserve(from._chunks.size());
+	for(size_t i = 0; i < from._chunks.size(); i++)
+		_chunks.push_back(new Blob(*from._chunks[i]));
+	_length = from._length;
+}
+
+#endif
@@ -42,7 +42,8 @@ void OUFile::convert(void)
 	if(userSourceVersion() > userVersion())
 	{
 		// Make sure every object is read so that it can be converted.
-		OIterator it(this,cOPersist);
+		// Read in file order so that the file is read sequentially.
+		OScanIterator it(this,cOPersist);
 		while(it++);
 
 		if(!isReadOnly())
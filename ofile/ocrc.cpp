@@ -0,0 +1,268 @@
+/*=============================================================================
+MIT License
+
+Copyright(c) 2019 willywood
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+=============================================================================*/
+
+// The table version processes 8 bytes at a time(slicing by 8). The
+// hardware version is chosen at run time on x86, and at compile time on
+// ARM, where the CRC instructions are only available if the compiler
+// targets them.
+
+#include "odefs.h"
+#include <string.h>
+#include "ocrc.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define OCRC_SSE42 1
+#include <nmmintrin.h>
+#define OCRC_SSE42_TARGET __attribute__((target("sse4.2")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define OCRC_SSE42 1
+#include <nmmintrin.h>
+#include <intrin.h>
+#define OCRC_SSE42_TARGET
+#elif defined(__ARM_FEATURE_CRC32)
+#define OCRC_ARM 1
+#include <arm_acle.h>
+#endif
+
+// The reflected polynomial
+const OSYS_ULONG32 cPolynomial = 0x82F63B78UL;
+
+static OSYS_ULONG32 sTable[8][256];
+static bool sHardware = false;
+
+static bool hasHardware(void)
+{
+#if defined(OCRC_ARM)
+	return true;
+#elif defined(OCRC_SSE42) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info,1);
+	return (info[2] & (1 << 20)) != 0;
+#elif defined(OCRC_SSE42)
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse4.2") != 0;
+#else
+	return false;
+#endif
+}
+
+static void initialize(void)
+// Build the tables and find out whether the processor has CRC instructions.
+{
+	for(int i = 0; i < 256; i++)
+	{
+		OSYS_ULONG32 crc = (OSYS_ULONG32)i;
+		for(int j = 0; j < 8; j++)
+			crc = (crc >> 1) ^ ((crc & 1) ? cPolynomial : 0);
+		sTable[0][i] = crc;
+	}
+	for(int i = 0; i < 256; i++)
+		for(int k = 1; k < 8; k++)
+			sTable[k][i] = (sTable[k - 1][i] >> 8) ^ sTable[0][sTable[k - 1][i] & 0xFF];
+
+	sHardware = hasHardware();
+}
+
+// Initialize before main, so that threads do not race to do it.
+static struct OCRCInit
+{
+	OCRCInit(void){initialize();}
+}sInit;
+
+static OSYS_ULONG32 updateTable(OSYS_ULONG32 crc,const unsigned char *p,size_t size)
+{
+	while(size >= 8)
+	{
+		// Bytes are taken one at a time so that it works with either byte order.
+		OSYS_ULONG32 lo = crc ^ (p[0] | (p[1] << 8) | (p[2] << 16) | ((OSYS_ULONG32)p[3] << 24));
+		crc = sTable[7][lo & 0xFF] ^
+			  sTable[6][(lo >> 8) & 0xFF] ^
+			  sTable[5][(lo >> 16) & 0xFF] ^
+			  sTable[4][lo >> 24] ^
+			  sTable[3][p[4]] ^
+			  sTable[2][p[5]] ^
+			  sTable[1][p[6]] ^
+			  sTable[0][p[7]];
+		p += 8;
+		size -= 8;
+	}
+	while(size--)
+		crc = (crc >> 8) ^ sTable[0][(crc ^ *p++) & 0xFF];
+	return crc;
+}
+
+#if defined(OCRC_SSE42)
+OCRC_SSE42_TARGET
+static OSYS_ULONG32 updateHardware(OSYS_ULONG32 crc,const unsigned char *p,size_t size)
+{
+#if defined(__x86_64__) || defined(_M_X64)
+	OSYS_ULONG64 crc64 = crc;
+	for(; size >= 8; p += 8, size -= 8)
+	{
+		OSYS_ULONG64 v;
+		memcpy(&v,p,8);
+		crc64 = _mm_crc32_u64(crc64,v);
+	}
+	crc = (OSYS_ULONG32)crc64;
+#endif
+	for(; size >= 4; p += 4, size -= 4)
+	{
+		unsigned int v;
+		memcpy(&v,p,4);
+		crc = _mm_crc32_u32(crc,v);
+	}
+	while(size--)
+		crc = _mm_crc32_u8(crc,*p++);
+	return crc;
+}
+#elif defined(OCRC_ARM)
+static OSYS_ULONG32 updateHardware(OSYS_ULONG32 crc,const unsigned char *p,size_t size)
+{
+	for(; size >= 8; p += 8, size -= 8)
+	{
+		OSYS_ULONG64 v;
+		memcpy(&v,p,8);
+		crc = __crc32cd(crc,v);
+	}
+	while(size--)
+		crc = __crc32cb(crc,*p++);
+	return crc;
+}
+#endif
+
+OSYS_ULONG32 OCRC32C::update(OSYS_ULONG32 crc,const void *buf,size_t size)
+// Return the checksum crc continued over size bytes at buf.
+{
+	crc = ~crc;
+#if defined(OCRC_SSE42) || defined(OCRC_ARM)
+	if(sHardware)
+		return ~updateHardware(crc,(const unsigned char *)buf,size);
+#endif
+	return ~updateTable(crc,(const unsigned char *)buf,size);
+}
+
+bool OCRC32C::hardware(void)
+{
+	return sHardware;
+}
+
+
+// ========================= O H A S H 6 4 =======================================
+
+static const OSYS_ULONG64 cPrime1 = 11400714785074694791ULL;
+static const OSYS_ULONG64 cPrime2 = 14029467366897019727ULL;
+static const OSYS_ULONG64 cPrime3 = 1609587929392839161ULL;
+static const OSYS_ULONG64 cPrime4 = 9650029242287828579ULL;
+static const OSYS_ULONG64 cPrime5 = 2870177450012600261ULL;
+
+static inline OSYS_ULONG64 rotl64(OSYS_ULONG64 x,int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+static inline OSYS_ULONG64 read64(const unsigned char *p)
+// Little endian, whatever the processor.
+{
+	OSYS_ULONG64 v = 0;
+	for(int i = 7; i >= 0; i--)
+		v = (v << 8) | p[i];
+	return v;
+}
+
+static inline OSYS_ULONG32 read32(const unsigned char *p)
+{
+	return (OSYS_ULONG32)p[0] | ((OSYS_ULONG32)p[1] << 8) |
+		   ((OSYS_ULONG32)p[2] << 16) | ((OSYS_ULONG32)p[3] << 24);
+}
+
+static inline OSYS_ULONG64 hashRound(OSYS_ULONG64 acc,OSYS_ULONG64 input)
+{
+	acc += input * cPrime2;
+	return rotl64(acc,31) * cPrime1;
+}
+
+static inline OSYS_ULONG64 hashMerge(OSYS_ULONG64 acc,OSYS_ULONG64 v)
+{
+	acc ^= hashRound(0,v);
+	return acc * cPrime1 + cPrime4;
+}
+
+OSYS_ULONG64 OHash64::compute(const void *buf,size_t size,OSYS_ULONG64 seed)
+// Return the hash of size bytes at buf.
+{
+	const unsigned char *p = (const unsigned char *)buf;
+	const unsigned char *end = p + size;
+	OSYS_ULONG64 h;
+
+	if(size >= 32)
+	{
+		OSYS_ULONG64 v1 = seed + cPrime1 + cPrime2;
+		OSYS_ULONG64 v2 = seed + cPrime2;
+		OSYS_ULONG64 v3 = seed;
+		OSYS_ULONG64 v4 = seed - cPrime1;
+
+		for(; p + 32 <= end; p += 32)
+		{
+			v1 = hashRound(v1,read64(p));
+			v2 = hashRound(v2,read64(p + 8));
+			v3 = hashRound(v3,read64(p + 16));
+			v4 = hashRound(v4,read64(p + 24));
+		}
+
+		h = rotl64(v1,1) + rotl64(v2,7) + rotl64(v3,12) + rotl64(v4,18);
+		h = hashMerge(h,v1);
+		h = hashMerge(h,v2);
+		h = hashMerge(h,v3);
+		h = hashMerge(h,v4);
+	}
+	else
+		h = seed + cPrime5;
+
+	h += (OSYS_ULONG64)size;
+
+	for(; p + 8 <= end; p += 8)
+	{
+		h ^= hashRound(0,read64(p));
+		h = rotl64(h,27) * cPrime1 + cPrime4;
+	}
+	if(p + 4 <= end)
+	{
+		h ^= (OSYS_ULONG64)read32(p) * cPrime1;
+		h = rotl64(h,23) * cPrime2 + cPrime3;
+		p += 4;
+	}
+	for(; p < end; p++)
+	{
+		h ^= *p * cPrime5;
+		h = rotl64(h,11) * cPrime1;
+	}
+
+	// Avalanche
+	h ^= h >> 33;
+	h *= cPrime2;
+	h ^= h >> 29;
+	h *= cPrime3;
+	h ^= h >> 32;
+	return h;
+}
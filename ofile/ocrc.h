@@ -0,0 +1,50 @@
+#ifndef OCRC_H
+#define OCRC_H
+/*=============================================================================
+MIT License
+
+Copyright(c) 2019 willywood
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+=============================================================================*/
+
+#include <stddef.h>
+
+
+class OCRC32C
+// CRC32C(Castagnoli) checksums. The CRC instructions of SSE4.2 or ARMv8
+// are used when the processor has them, otherwise a table.
+{
+public:
+	// Continue the checksum crc over size bytes at buf. Start with crc = 0.
+	static OSYS_ULONG32 update(OSYS_ULONG32 crc,const void *buf,size_t size);
+	static OSYS_ULONG32 compute(const void *buf,size_t size){return update(0,buf,size);}
+	// The processor's CRC instructions are used.
+	static bool hardware(void);
+};
+
+class OHash64
+// A 64 bit hash of data(the xxHash64 algorithm), used to find blobs with
+// the same content. It is the same on all processors.
+{
+public:
+	static OSYS_ULONG64 compute(const void *buf,size_t size,OSYS_ULONG64 seed = 0);
+};
+
+#endif
@@ -60,6 +60,8 @@ typedef unsigned __int64 uint64_t;
 //#define OF_THREADS_MUTEX
 
 typedef int64_t OSYS_LONG64; // Eight bytes
+typedef uint64_t OSYS_ULONG64; // Eight bytes
+typedef uint32_t OSYS_ULONG32; // Four bytes
 //typedef __int64 OSYS_LONG64; // Eight bytes
 
 // Uncomment this if you are using the standard library in its namespace - std
@@ -181,11 +183,33 @@ typedef OSYS_LONG64 O_LONG64; // Eight bytes
 typedef long O_LONG64;    // Eight bytes
 #endif
 
+// Byte order in which a stream stores fixed width values as raw bytes
+// (see ofaststrm.h). cRawNone if the stream does not store them that way.
+enum ORawOrder{cRawNone,cRawNative,cRawSwapped};
+
 #define OFILE_CREATE             0x00000001L
 #define OFILE_OPEN_FOR_WRITING	 0x00000002L
 #define OFILE_OPEN_READ_ONLY	 0x00000004L
 // Fast object resolution
 #define OFILE_FAST_FIND			 0x00000008L
+// Compact encoding of objects and indexes. Only used when a file is created.
+#define OFILE_COMPACT			 0x00000010L
+// Compress objects when they are written. Files written with it cannot be
+// read by versions without compression.
+#define OFILE_COMPRESS			 0x00000020L
+// Store a checksum of each object, the index and the header, and verify
+// them when they are read. Only used when a file is created.
+#define OFILE_CHECKSUM			 0x00000040L
+// Place small objects in pages of equal sized slots, so that they are
+// allocated quickly and do not fragment the file. Files written with it
+// cannot be read by versions without size classes.
+#define OFILE_SIZE_CLASSES		 0x00000080L
+// Map a file that is opened read only into memory, so that blobs can be
+// read in place instead of being copied(see OFile::view()).
+#define OFILE_MMAP				 0x00000100L
+// Store blobs with the same content once, sharing their space. Files
+// written with it cannot be read by versions without it.
+#define OFILE_DEDUP				 0x00000200L
 
 // For eliminating compiler warnings
 #define OFILE_UNUSED(x) (void)(x)
@@ -0,0 +1,222 @@
+#ifndef OFASTSTRM_H
+#define OFASTSTRM_H
+/*=============================================================================
+MIT License
+
+Copyright(c) 2019 willywood
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+=============================================================================*/
+
+
+///////////////////////////////////////////////////////////////////////////
+// Fast streaming of fixed width attributes.
+//
+// Normally every attribute costs a virtual call, a byte order test and a
+// buffered copy. A class with a hot schema can instead describe its fixed
+// width attributes once in a member template
+//
+//	template<class S> void oFields(S &s)
+//	{
+//		s.Long(_count,"count");
+//		s.Double(_value,"value");
+//	}
+//
+// and call OFastWrite(out,*this) from oWrite() and OFastRead(in,*this) from
+// its stream constructor. On a binary file stream the attributes are copied
+// to or from a local buffer by code specialised for the byte order of the
+// file, and the buffer goes to the stream in one call. The bytes are the
+// same as those written by the equivalent writeXxx() calls, so the two can
+// be mixed freely. On any other stream(XML or a compact file) the attributes
+// are passed to the virtual methods one at a time with their labels.
+//
+// Attribute methods: Char, Bool, Short, Long, Long64, Float, Double. They are
+// named rather than overloaded because O_LONG and O_LONG64 may be the same type.
+///////////////////////////////////////////////////////////////////////////
+
+#include <string.h>
+#include "ostrm.h"
+#include "oistrm.h"
+
+// Largest group of attributes that is buffered. Larger groups use the
+// virtual methods.
+const long cFastBufferSize = 512;
+
+// Copy N bytes of which the first S are reversed when Swap is true.
+template<bool Swap> struct OFastCopy{
+	template<int N,int S> static void copy(char *dst,const char *src)
+	{
+		memcpy(dst,src,N);
+	}
+};
+
+template<> struct OFastCopy<true>{
+	template<int N,int S> static void copy(char *dst,const char *src)
+	{
+		for(int i = 0; i < S; i++)
+			dst[i] = src[S - 1 - i];
+		memcpy(dst + S,src + S,N - S);
+	}
+};
+
+// Counts the bytes of the attributes.
+class OFastSize{
+public:
+	OFastSize(void):_size(0){}
+	void Char(char &,const char * = 0){_size += 1;}
+	void Bool(bool &,const char * = 0){_size += 1;}
+	void Short(O_SHORT &,const char * = 0){_size += sizeof(O_SHORT);}
+	void Long(O_LONG &,const char * = 0){_size += sizeof(O_LONG);}
+	void Long64(O_LONG64 &,const char * = 0){_size += sizeof(O_LONG64);}
+	void Float(float &,const char * = 0){_size += sizeof(float);}
+	void Double(double &,const char * = 0){_size += sizeof(double);}
+	long size(void)const{return _size;}
+private:
+	long _size;
+};
+
+// Writes the attributes to a buffer in the byte order of the file.
+// The swaps match those of OOStreamFile.
+template<bool Swap> class OFastOStream{
+public:
+	OFastOStream(char *buf):_p(buf){}
+	void Char(char &data,const char * = 0){*_p++ = data;}
+	void Bool(bool &data,const char * = 0){*_p++ = data ? 0x1 : 0x0;}
+	void Short(O_SHORT &data,const char * = 0){put<sizeof(O_SHORT),2>(&data);}
+	void Long(O_LONG &data,const char * = 0){put<sizeof(O_LONG),4>(&data);}
+	void Long64(O_LONG64 &data,const char * = 0){put<sizeof(O_LONG64),8>(&data);}
+	void Float(float &data,const char * = 0){put<sizeof(float),4>(&data);}
+	void Double(double &data,const char * = 0){put<sizeof(double),8>(&data);}
+private:
+	template<int N,int S> void put(const void *data)
+	{
+		OFastCopy<Swap>::template copy<N,S>(_p,(const char *)data);
+		_p += N;
+	}
+	char *_p;
+};
+
+// Reads the attributes from a buffer in the byte order of the file.
+template<bool Swap> class OFastIStream{
+public:
+	OFastIStream(const char *buf):_p(buf){}
+	void Char(char &data,const char * = 0){data = *_p++;}
+	void Bool(bool &data,const char * = 0){data = *_p++ != 0x0;}
+	void Short(O_SHORT &data,const char * = 0){get<sizeof(O_SHORT),2>(&data);}
+	void Long(O_LONG &data,const char * = 0){get<sizeof(O_LONG),4>(&data);}
+	void Long64(O_LONG64 &data,const char * = 0){get<sizeof(O_LONG64),8>(&data);}
+	void Float(float &data,const char * = 0){get<sizeof(float),4>(&data);}
+	void Double(double &data,const char * = 0){get<sizeof(double),8>(&data);}
+private:
+	template<int N,int S> void get(void *data)
+	{
+		OFastCopy<Swap>::template copy<N,S>((char *)data,_p);
+		_p += N;
+	}
+	const char *_p;
+};
+
+// Passes the attributes to the virtual methods of any output stream.
+class OFieldOStream{
+public:
+	OFieldOStream(OOStream *out):_out(out){}
+	void Char(char &data,const char *label = 0){_out->writeChar(data,label);}
+	void Bool(bool &data,const char *label = 0){_out->writeBool(data,label);}
+	void Short(O_SHORT &data,const char *label = 0){_out->writeShort(data,label);}
+	void Long(O_LONG &data,const char *label = 0){_out->writeLong(data,label);}
+	void Long64(O_LONG64 &data,const char *label = 0){_out->writeLong64(data,label);}
+	void Float(float &data,const char *label = 0){_out->writeFloat(data,label);}
+	void Double(double &data,const char *label = 0){_out->writeDouble(data,label);}
+private:
+	OOStream *_out;
+};
+
+// Reads the attributes with the virtual methods of any input stream.
+class OFieldIStream{
+public:
+	OFieldIStream(OIStream *in):_in(in){}
+	void Char(char &data,const char *label = 0){data = _in->readChar(label);}
+	void Bool(bool &data,const char *label = 0){data = _in->readBool(label);}
+	void Short(O_SHORT &data,const char *label = 0){data = _in->readShort(label);}
+	void Long(O_LONG &data,const char *label = 0){data = _in->readLong(label);}
+	void Long64(O_LONG64 &data,const char *label = 0){data = _in->readLong64(label);}
+	void Float(float &data,const char *label = 0){data = _in->readFloat(label);}
+	void Double(double &data,const char *label = 0){data = _in->readDouble(label);}
+private:
+	OIStream *_in;
+};
+
+template<class T> inline void OFastWrite(OOStream *out,const T &ob)
+// Write the attributes described by ob.oFields().
+{
+	T &fields = const_cast<T &>(ob);
+	OFastSize size;
+	fields.oFields(size);
+
+	ORawOrder order = out->rawOrder();
+	if(order == cRawNone || size.size() > cFastBufferSize)
+	{
+		OFieldOStream s(out);
+		fields.oFields(s);
+		return;
+	}
+
+	char buf[cFastBufferSize];
+	if(order == cRawNative)
+	{
+		OFastOStream<false> s(buf);
+		fields.oFields(s);
+	}
+	else
+	{
+		OFastOStream<true> s(buf);
+		fields.oFields(s);
+	}
+	out->writeBytes(buf,size.size());
+}
+
+template<class T> inline void OFastRead(OIStream *in,T &ob)
+// Read the attributes described by ob.oFields().
+{
+	OFastSize size;
+	ob.oFields(size);
+
+	ORawOrder order = in->rawOrder();
+	if(order == cRawNone || size.size() > cFastBufferSize)
+	{
+		OFieldIStream s(in);
+		ob.oFields(s);
+		return;
+	}
+
+	char buf[cFastBufferSize];
+	in->readBytes(buf,(int)size.size());
+	if(order == cRawNative)
+	{
+		OFastIStream<false> s(buf);
+		ob.oFields(s);
+	}
+	else
+	{
+		OFastIStream<true> s(buf);
+		ob.oFields(s);
+	}
+}
+
+#endif
@@ -48,7 +48,16 @@ SOFTWARE.
 #include "opersist.h"
 #include "ox.h"
 #include "ofmemreg.h"
+#include "ocrc.h"
 #include <string.h>
+#include <time.h>
+#include <vector>
+#include <algorithm>
+
+#ifdef OFILE_STD_IN_NAMESPACE
+using std::vector;
+using std::sort;
+#endif
 
 // Used to determine the word format of the current processor.
 unsigned long OFile::_sProcessorId = 0x01020408;
@@ -56,7 +65,9 @@ unsigned long OFile::_sProcessorId = 0x01020408;
 // Used to determine what coversions must be made to support changes
 // in ObjectFile data structurs. This should not interest the application
 // developer.
-long OFile::_sOFileSourceVersion = 2;
+// Version 3 stores the encoding in the header.
+// Version 4 may have compressed objects.
+long OFile::_sOFileSourceVersion = 4;
 
 // Set the version number of the application program source files.
 // This should be incremented whenever an object schema change is made.
@@ -84,6 +95,12 @@ OFMutex OFile::_sMutex; // Global mutex
 // handler for when the object threshold is exceeded.
 OFile::New_handler OFile::_sNew_handler = OFile::new_handler;
 
+// Counts of all files, and the function to call after each commit.
+OFileStats OFile::_sStats;
+OFileStats OFile::_sStatsBase;
+OFile::StatsHook OFile::_sStatsHook = 0;
+void *OFile::_sStatsHookArg = 0;
+
 OFile::New_handler OFile::set_new_handler(OFile::New_handler newNewHandler)
 // Static
 // Set a user defined new_handler for when the object threshold is
@@ -137,6 +154,10 @@ void OFile::reopen(const char *fname)
 		operation = (operation & ~OFILE_CREATE) | OFILE_OPEN_FOR_WRITING;
 
 	_in.open(fname,operation);
+
+	delete []_fileName;
+	_fileName = new char[strlen(fname) + 1];
+	strcpy(_fileName,fname);
 }
 
 void OFile::reopen(void)
@@ -151,6 +172,7 @@ void OFile::reopen(void)
 
 OFile::OFile(const char *fname,long operation,const char *magicNumber):
 											_oList(0),
+											_crcList(0),
 											_fList(this),
 											_in(this,fname,operation),
 											_operation(operation)
@@ -181,6 +203,10 @@ OFile::OFile(const char *fname,long operation,const char *magicNumber):
 // an exception is thrown.
 {
 	init(fname,magicNumber);
+
+	// Keep the name so that other read streams can be opened on the file.
+	_fileName = new char[strlen(fname) + 1];
+	strcpy(_fileName,fname);
 }
 
 #ifdef OF_OLE
@@ -190,6 +216,7 @@ OFile::OFile(IStorage *istorage,
 			 const char *magicNumber):
 										_fList(this),
 										_oList(0),
+										_crcList(0),
 										_in(this,istorage,fname,istorage_mode),
 										_operation(operation)
 
@@ -228,8 +255,11 @@ void OFile::init(const char *fname,const char *magicNumber)
 	// Must specify a file name
 	oFAssert(fname);
 
+	_fileName = 0;
+	_encoding = cEncodingFixed;
 	_oFileMark = 0;
 	_oFileLength = 0;
+	_oFileCrc = 0;
 	_oFileVersion = _sOFileSourceVersion;
 	_fileProcessorId = _sProcessorId;
 	_userVersion = userSourceVersion();
@@ -238,6 +268,14 @@ void OFile::init(const char *fname,const char *magicNumber)
 	_rootId = 0;
 	_autoCommit = false;
 	_retainIdentity = false;
+	_growthMin = 0;
+	_growthPercent = 0;
+	_holeMin = 0;
+	_view = 0;
+	_viewLength = 0;
+	memset(&_stats,0,sizeof(_stats));
+	memset(&_statsReset,0,sizeof(_statsReset));
+	_defragNext = 0;
 
 	if(OFILE_FAST_FIND & _operation)
 		_oList = new ObjectList;
@@ -263,6 +301,11 @@ void OFile::init(const char *fname,const char *magicNumber)
 
 		_fileProcessorId = _sProcessorId;
 
+		if(OFILE_COMPACT & _operation)
+			_encoding |= cEncodingCompact;
+		if(OFILE_CHECKSUM & _operation)
+			_encoding |= cEncodingChecksum;
+
 		// Initialize the magic number
 		for(int i = 0; i < 4 ;i++)
 			// If none is specified initialize to all 0's.
@@ -280,7 +323,8 @@ void OFile::init(const char *fname,const char *magicNumber)
 					sizeof(_oFileLength) +
 					sizeof(_rootId) +
 					sizeof(_fileLength) +
-					sizeof(_magicNumber));
+					sizeof(_magicNumber) +
+					3*sizeof(O_LONG));
 
 		_in.readBytes(&_fileProcessorId,4);
 
@@ -307,11 +351,33 @@ void OFile::init(const char *fname,const char *magicNumber)
 		if(magicNumber && (0 != memcmp(_magicNumber,magicNumber,4)))
 			throw OFileIOErr("Invalid file format.");
 
+		// From version 3 the encoding is stored. It is 0(fixed) in
+		// earlier files.
+		_encoding = _in.readLong();
+		if(_encoding & ~(cEncodingCompact | cEncodingCompressed | cEncodingChecksum |
+						 cEncodingSizeClasses | cEncodingSharedBlobs))
+			throw OFileErr("Invalid file format.");
+
+		if(hasChecksums())
+		{
+			_oFileCrc = (OSYS_ULONG32)_in.readLong();
+			OSYS_ULONG32 headerCrc = (OSYS_ULONG32)_in.readLong();
+
+			// The header checksum is of everything before it.
+			char header[cHeaderCrcOffset];
+			_in.readDataAt(0,header,cHeaderCrcOffset);
+			if(OCRC32C::compute(header,cHeaderCrcOffset) != headerCrc)
+				throw OFileIOErr("Header checksum does not match.");
+		}
+
 		// Finish reading the header
 		_in.finish();
 
+		// The rest of the file is in the file's encoding.
+		_in.setCompact(isCompact());
+
 		// Start reading the 'OFile' object.
-		_in.start(_oFileMark,_oFileLength);
+		_in.start(_oFileMark,_oFileLength,false,hasChecksums() ? &_oFileCrc : 0);
 		_uniqueId = _in.readLong();
 
 		OClassId_t cId;
@@ -322,15 +388,24 @@ void OFile::init(const char *fname,const char *magicNumber)
 #ifdef OF_HASH
 			_cList.classList(cId).resize(objectCount);
 #endif
+			OId prevId = 0;
 			for(long i = 0;i < objectCount;i++)
 			{
 				OId id = _in.readObjectId();
+				if(isCompact())
+				{
+					// Identities are stored as the difference from the previous one.
+					id += prevId;
+					prevId = id;
+				}
 				OFilePos_t mark = _in.readFilePos();
 				oulong length = _in.readLong();
 
 				// insert into Object list
 				// pair<ClassList::iterator,bool> ret = 
 				_cList.classListCr(cId).insert(ClassList::value_type(id,OEnt(mark,length)));
+				if(hasChecksums())
+					setCrc(id,(OSYS_ULONG32)_in.readLong());
 			}
 		}
 		if(OFILE_FAST_FIND & _operation){
@@ -364,6 +439,27 @@ void OFile::init(const char *fname,const char *magicNumber)
 		_in.finish();
 	}
 
+	// Compression can be turned on for any file that is written. Objects
+	// already in the file are left as they are.
+	if((OFILE_COMPRESS & _operation) && !isReadOnly())
+		_encoding |= cEncodingCompressed;
+	// So can size classes. Objects already in the file stay where they are
+	// until they change size.
+	if((OFILE_SIZE_CLASSES & _operation) && !isReadOnly())
+		_encoding |= cEncodingSizeClasses;
+	// And shared blobs. Blobs already in the file are not shared until they
+	// are written again.
+	if((OFILE_DEDUP & _operation) && !isReadOnly())
+		_encoding |= cEncodingSharedBlobs;
+
+	// A read only file does not change, so it can be mapped to read blobs
+	// in place.
+	if((OFILE_MMAP & _operation) && isReadOnly())
+	{
+		_viewLength = _in.fileLength();
+		_view = o_map(*_in.fd(),_viewLength);
+	}
+
 	// Global mutex
     OFGuard sguard(_sMutex);
 
@@ -381,6 +477,7 @@ void OFile::init(const char *fname,const char *magicNumber)
 	// was in the same header file in each compiler.
 	}catch(...){
 		delete _oList;
+		delete _crcList;
 		throw;
 	}
 
@@ -395,7 +492,16 @@ OFile::~OFile(void)
 	// Clears objects from memory and from the indexes.
 	pClear();
 
+	// Keep the counts of the file in the global counts.
+	addStats(_sStats,snapshot(_stats,false));
+	addStats(_sStats,_statsReset);
+
 	delete _oList;
+	delete _crcList;
+	delete []_fileName;
+
+	if(_view)
+		o_unmap(_view,_viewLength);
 
 	// Remove this file from the list of files
 	OFile *f = _sFileListHead;
@@ -482,6 +588,8 @@ void OFile::pClear(void)
 	if(_oList)
 //		_oList->clear();
 		_oList->erase(_oList->begin(),_oList->end());
+	delete _crcList;
+	_crcList = 0;
 }
 
 void OFile::reset(void)
@@ -497,6 +605,7 @@ void OFile::reset(void)
 
 	// Clear the free list
 	_fList.clear();
+	_defragNext = 0;
 
 	// Clear the file object
 	_oFileMark = 0; 
@@ -681,8 +790,8 @@ void OFile::pErase(OPersist *ob)
 
 		// Free the space in the file
 		const OEnt &oe = (*it).second;
-		if(oe._mark && oe._length)
-			_fList.freeSpace(oe._mark,oe._length);
+		if(oe._mark && oe.length())
+			_fList.freeSpace(oe._mark,oe.length());
 
 		// Erase from the class list
 		_cList.classList(ob->meta()->id()).erase(it);
@@ -690,6 +799,8 @@ void OFile::pErase(OPersist *ob)
 		if(OFILE_FAST_FIND & _operation)
 			// Erase from object list.
 			_oList->erase(ob->oId());
+		if(_crcList)
+			_crcList->erase(ob->oId());
 
 		ob->oSetInFile(false);
 
@@ -751,12 +862,25 @@ OPersist *OFile::getObject(const OId oId,OClassId_t cId)
 OPersist *OFile::getObject(ClassList::iterator it,OClassId_t cId)
 // Private.
 // Get an object from its iterator.
+{
+	return getObject(it,cId,_in,false);
+}
+
+OPersist *OFile::getObject(ClassList::iterator it,OClassId_t cId,OIStreamFile &in,bool started)
+// Private.
+// Get an object from its iterator, reading it from the stream in.
+// Parameters: started - true if in.start() has already been called for the
+//                       object. It is aborted if the object is in memory.
 {
 	// Do not enter in more than one thread.
     OFGuard guard(_mutex);
 
 	if((*it).second._ob)
 	{
+		if(started)
+			in.abort();
+		count(&OFileStats::cacheHits);
+
 		OPersist *ob = (*it).second._ob;
 		// Object is not purgeable because we are referencing it.
 		ob->pSetPurgeable(false);
@@ -764,8 +888,12 @@ OPersist *OFile::getObject(ClassList::iterator it,OClassId_t cId)
 	}
 	else
 	{
+		count(&OFileStats::cacheMisses);
+
 		// Start reading object
-		_in.start((*it).second._mark,(*it).second._length);
+		if(!started)
+			in.start((*it).second._mark,(*it).second.length(),(*it).second.compressed(),
+					 crcOf((*it).first));
 
 		// Set the current index so that OPersist's constructor can update it
 		_currentIndex = it;
@@ -774,17 +902,18 @@ OPersist *OFile::getObject(ClassList::iterator it,OClassId_t cId)
 		OPersist *ob;
 		try
 		{
-			ob =  meta->construct(_in);
+			ob =  meta->construct(in);
 		}catch(...){
 			// Abort reading of this object.
-			_in.abort();
+			in.abort();
 			// clean the index, because the object was not constructed.
 			(*it).second._ob = 0;
 			throw;
 		}
 		(*it).second._ob = ob;
 		// Terminate reading object.
-		_in.finish();
+		in.finish();
+		count(&OFileStats::objectsRead);
 
 	    ob->setId((*it).first);
 
@@ -795,6 +924,489 @@ OPersist *OFile::getObject(ClassList::iterator it,OClassId_t cId)
 	}
 }
 
+const OSYS_ULONG32 *OFile::crcOf(OId id)const
+// Private.
+// Return the checksum of the object with identity id in the file, or 0 if
+// it has none.
+{
+	if(!_crcList)
+		return 0;
+	CrcList::const_iterator it = _crcList->find(id);
+	return it == _crcList->end() ? 0 : &(*it).second;
+}
+
+void OFile::setCrc(OId id,OSYS_ULONG32 crc)
+// Private.
+// Set the checksum of the object with identity id in the file. The list of
+// checksums is only made for files that have them.
+{
+	if(!_crcList)
+		_crcList = new CrcList;
+	(*_crcList)[id] = crc;
+}
+
+// An object visited by parallelForEach.
+class ForEachEnt{
+public:
+	ForEachEnt(OFilePos_t mark,oulong length,bool compressed,const OSYS_ULONG32 *crc,
+			   OClassId_t cId,OFile::ClassList::iterator it):
+						_mark(mark),_length(length),_compressed(compressed),_crc(crc),
+						_cId(cId),_it(it){}
+	// Order by position in file. Objects not yet written(mark 0) go last.
+	bool operator<(const ForEachEnt &e)const
+		{return _mark != 0 && (e._mark == 0 || _mark < e._mark);}
+
+	OFilePos_t _mark;
+	oulong _length;
+	bool _compressed;
+	const OSYS_ULONG32 *_crc;	// Checksum to verify or 0
+	OClassId_t _cId;
+	OFile::ClassList::iterator _it;
+};
+
+// The share of the objects given to one worker of parallelForEach.
+class OFile::ForEachPart{
+public:
+	ForEachPart():_in(0),_count(0){}
+	OFile *_file;
+	ForEachPartFunc _fn;
+	void *_arg;
+	int _index;          // Index of the part in the batch
+	const vector<ForEachEnt> *_order;
+	size_t _begin;       // First object
+	size_t _end;         // One past the last object
+	OIStreamFile *_in;   // Own read stream, or 0 to use the file's stream.
+	long _count;         // Objects visited
+	OFileErr **_err;     // First error of any worker
+};
+
+void OFile::forEachWorker(void *p)
+// Static
+// Visit the objects of one part of parallelForEach.
+{
+	ForEachPart *part = (ForEachPart *)p;
+	OFile *f = part->_file;
+
+	try
+	{
+		for(size_t i = part->_begin; i < part->_end; i++)
+		{
+			{
+				// Stop if another worker has failed.
+				OFGuard guard(f->_mutex);
+				if(*part->_err)
+					return;
+			}
+
+			const ForEachEnt &e = (*part->_order)[i];
+#ifndef OF_REF_COUNT
+			bool referenced;
+			{
+				// An object that is already referenced stays referenced.
+				OFGuard guard(f->_mutex);
+				OPersist *inMemory = (*e._it).second._ob;
+				referenced = inMemory && !inMemory->oPurgeable();
+			}
+#endif
+			OPersist *ob;
+			if(part->_in)
+			{
+				// Read the start of the object before taking the file's
+				// mutex, so that the workers read the file in parallel.
+				part->_in->start(e._mark,e._length,e._compressed,e._crc);
+				ob = f->getObject(e._it,e._cId,*part->_in,true);
+			}
+			else
+				ob = f->getObject(e._it,e._cId);
+
+			bool keep = (*part->_fn)(ob,part->_arg,part->_index);
+			part->_count++;
+
+			// Let the object be purged, so that memory does not grow with
+			// the number of objects visited. With reference counts only the
+			// reference of getObject is removed, others hold theirs.
+#ifdef OF_REF_COUNT
+			if(!keep)
+#else
+			if(!keep && !referenced)
+#endif
+			{
+				OFGuard guard(f->_mutex);
+				ob->oSetPurgeable(false,f);
+			}
+		}
+	}catch(OFileErr &x){
+		OFGuard guard(f->_mutex);
+		if(!*part->_err)
+			*part->_err = new OFileErr(x);
+	}catch(...){
+		OFGuard guard(f->_mutex);
+		if(!*part->_err)
+			*part->_err = new OFileErr("Unknown exception in parallelForEach.");
+	}
+}
+
+// The function and argument of parallelForEach without parts.
+struct ForEachCall{
+	OFile::ForEachFunc _fn;
+	void *_arg;
+};
+
+static bool forEachCall(OPersist *ob,void *arg,int /* part */)
+{
+	ForEachCall *call = (ForEachCall *)arg;
+	return (*call->_fn)(ob,call->_arg);
+}
+
+long OFile::parallelForEach(OClassId_t cId,bool deep,ForEachFunc fn,void *arg,int nThreads)
+// Call fn(ob,arg) for every object of class cId, or its sub-classes if deep
+// is true. The objects are divided by their position in the file between
+// nThreads worker threads(default: one per processor). Each worker reads its
+// objects in file order through its own read stream, so the reading and the
+// calls to fn run in parallel. Objects are constructed one at a time under the
+// file's mutex.
+// Without OF_MULTI_THREAD, or where no thread support is implemented,
+// the objects are visited in the calling thread.
+// fn must be thread safe. Objects must not be attached or detached from the
+// file until parallelForEach returns. fn returns true to keep a reference to
+// the object, as getObject gives. Otherwise the reference is removed when fn
+// returns. Without OF_REF_COUNT the object is then made purgeable, unless it
+// was already referenced before.
+// Return the number of objects visited.
+// Exceptions: If fn or the reading of an object throws, the remaining objects
+// are not visited and an OFileErr is thrown when all the workers have stopped.
+{
+	ForEachCall call = {fn,arg};
+	return parallelForEach(cId,deep,forEachCall,0,&call,0,nThreads);
+}
+
+long OFile::parallelForEach(OClassId_t cId,bool deep,ForEachPartFunc fn,ForEachBatchFunc batchDone,
+							void *arg,long batchSize,int nThreads)
+// As parallelForEach above, but the objects are visited in batches of
+// batchSize objects in file order(default 0: one batch). Each batch is
+// divided into at most nThreads parts, also in file order, and fn is called
+// as fn(ob,arg,part) with the index of the part. When a batch has been
+// visited, batchDone(arg,parts) is called in the calling thread, if it is
+// not 0, before the next batch is started. This allows the results of the
+// parts to be collected in order.
+{
+	if(nThreads <= 0)
+		nThreads = OFThread::hardwareConcurrency();
+
+	// Collect the objects and sort them into file order.
+	vector<ForEachEnt> order;
+	{
+		OFGuard guard(_mutex);
+
+		const OMeta::Classes &classes = OMeta::meta(cId)->classes(deep);
+		for(OMeta::Classes::const_iterator cSetIt = classes.begin();cSetIt != classes.end();++cSetIt)
+		{
+			ClassList &cl = _cList.classList(*cSetIt);
+			for(ClassList::iterator it = cl.begin();it != cl.end();++it)
+				order.push_back(ForEachEnt((*it).second._mark,(*it).second.length(),
+											(*it).second.compressed(),
+											crcOf((*it).first),
+											*cSetIt,it));
+		}
+
+		// Make sure that what has been written can be seen by other streams.
+		if(!isReadOnly())
+			o_fflush(*fd());
+	}
+	if(order.empty())
+		return 0;
+	sort(order.begin(),order.end());
+
+	if(batchSize <= 0 || (size_t)batchSize > order.size())
+		batchSize = (long)order.size();
+	if(nThreads > batchSize)
+		nThreads = (int)batchSize;
+
+	OFileErr *err = 0;
+	ForEachPart *parts = new ForEachPart[nThreads];
+	int i;
+	for(i = 0; i < nThreads; i++)
+	{
+		ForEachPart &part = parts[i];
+		part._file = this;
+		part._fn = fn;
+		part._arg = arg;
+		part._index = i;
+		part._order = &order;
+		part._err = &err;
+#ifndef OF_THREAD_SYNCHRONOUS
+		// A failure to open another stream on the file(e.g. because the
+		// platform does not share a file open for writing) is not an error.
+		// The worker then reads through the file's stream.
+		if(_fileName && nThreads > 1)
+		{
+			try
+			{
+				part._in = new OIStreamFile(this,_fileName,OFILE_OPEN_READ_ONLY);
+				part._in->setCompact(isCompact());
+			}catch(OFileErr &){
+				part._in = 0;
+			}
+		}
+#endif
+	}
+
+	long count = 0;
+	for(size_t begin = 0; begin < order.size() && !err; begin += batchSize)
+	{
+		size_t size = min((size_t)batchSize,order.size() - begin);
+		int nParts = (int)min((size_t)nThreads,size);
+		OFThread *threads = new OFThread[nParts];
+
+		for(i = 0; i < nParts; i++)
+		{
+			parts[i]._begin = begin + size*i/nParts;
+			parts[i]._end = begin + size*(i + 1)/nParts;
+			parts[i]._count = 0;
+
+			// If a thread cannot be created do the work here.
+			if(!threads[i].start(forEachWorker,&parts[i]))
+				forEachWorker(&parts[i]);
+		}
+
+		for(i = 0; i < nParts; i++)
+		{
+			threads[i].join();
+			count += parts[i]._count;
+		}
+		delete []threads;
+
+		if(batchDone && !err)
+		{
+			try
+			{
+				(*batchDone)(arg,nParts);
+			}catch(OFileErr &x){
+				err = new OFileErr(x);
+			}catch(...){
+				err = new OFileErr("Unknown exception in parallelForEach.");
+			}
+		}
+	}
+
+	for(i = 0; i < nThreads; i++)
+		delete parts[i]._in;
+	delete []parts;
+
+	if(err)
+	{
+		OFileErr x(*err);
+		delete err;
+		throw x;
+	}
+	return count;
+}
+
+long OFile::verify(VerifyFunc badObject,void *arg)
+// Scrub the file. Read every object in the file, and the index, and check
+// that they match their checksums. The objects are read in file order, but
+// are not constructed. Objects changed since the last commit are checked
+// against what is in the file.
+// badObject - if not 0 it is called for each object that does not match.
+//             It is called with an identity and class of 0 for the index.
+// Return the number of objects that do not match. 0 if the file has no
+// checksums.
+{
+	if(!hasChecksums())
+		return 0;
+
+	// Do not enter in more than one thread.
+	OFGuard guard(_mutex);
+
+	vector<ForEachEnt> order;
+	for(OClassId_t cId = 1; cId <= cOMaxClasses; cId++)
+	{
+		ClassList &cl = _cList.classList(cId);
+		for(ClassList::iterator it = cl.begin();it != cl.end();++it)
+		{
+			const OSYS_ULONG32 *crc = crcOf((*it).first);
+			if((*it).second._mark && (*it).second.length() && crc)
+				order.push_back(ForEachEnt((*it).second._mark,(*it).second.length(),
+											(*it).second.compressed(),crc,cId,it));
+		}
+	}
+	sort(order.begin(),order.end());
+
+	// The index, if it has been written.
+	if(_oFileMark)
+		order.push_back(ForEachEnt(_oFileMark,_oFileLength,false,&_oFileCrc,0,ClassList::iterator()));
+
+	if(!isReadOnly())
+		o_fflush(*fd());
+
+	long nBad = 0;
+	vector<char> buf;
+	for(size_t i = 0; i < order.size(); i++)
+	{
+		const ForEachEnt &e = order[i];
+		bool ok;
+		try
+		{
+			buf.resize(e._length + 1);
+			_in.readDataAt(e._mark,&buf[0],e._length);
+			ok = OCRC32C::compute(&buf[0],e._length) == *e._crc;
+		}catch(OFileIOErr &){
+			// Beyond the end of the file.
+			ok = false;
+		}
+
+		if(!ok)
+		{
+			nBad++;
+			if(badObject)
+				badObject(e._cId ? (*e._it).first : 0,e._cId,arg);
+		}
+	}
+	return nBad;
+}
+
+const char *OFile::view(OFilePos_t mark,oulong size)const
+// Return the address of size bytes at mark in the mapping of the file,
+// or 0 if the file is not mapped. The file is mapped only if it was opened
+// read only with OFILE_MMAP, and the mapping is kept until the file is
+// destroyed.
+{
+	if(!_view || mark + size > _viewLength)
+		return 0;
+	return _view + mark;
+}
+
+OSpaceStats OFile::spaceStats(void)
+// Return how the space in the file is used, as of the last commit for
+// the index and as of now for the objects and free space. It is cheap
+// compared to a commit, so it can be used to decide when to defragment().
+{
+	// Do not enter in more than one thread.
+	OFGuard guard(_mutex);
+
+	OSpaceStats stats;
+	memset(&stats,0,sizeof(stats));
+	stats.fileLength = _fileLength;
+	stats.indexBytes = _oFileMark ? _oFileLength : 0;
+
+	_fList.spaceStats(stats);
+
+	for(OClassId_t cId = 1; cId <= cOMaxClasses; cId++)
+	{
+		const ClassList &cl = _cList.classList(cId);
+		for(ClassList::const_iterator it = cl.begin();it != cl.end();++it)
+		{
+			const OEnt &oe = (*it).second;
+			stats.classObjects[cId]++;
+			stats.classBytes[cId] += oe.length();
+			if(oe._mark && _fList.inSlot(oe._mark))
+				stats.pageSlack -= oe.length();
+		}
+		stats.objects += stats.classObjects[cId];
+		stats.liveBytes += stats.classBytes[cId];
+	}
+
+	// Objects not yet committed have no length, so this does not go negative.
+	stats.otherBytes = stats.fileLength - stats.indexBytes - stats.liveBytes -
+					   stats.freeBytes - stats.reservedBytes - stats.pageSlack;
+	return stats;
+}
+
+OFileStats OFile::stats(bool reset)
+// Return the counts of what this file has done since it was opened or
+// they were last reset. If reset is true they are set to 0.
+{
+	if(!reset)
+		return snapshot(_stats,false);
+
+	// The counts that are reset are still in the global counts.
+	OFGuard sguard(_sMutex);
+	OFileStats copy = snapshot(_stats,true);
+	addStats(_statsReset,copy);
+	return copy;
+}
+
+OFileStats OFile::globalStats(bool reset)
+// Static
+// Return the counts of what all files have done since the program started
+// or they were last reset. If reset is true they are set to 0. The counts
+// of each file are not affected.
+{
+	OFGuard sguard(_sMutex);
+
+	// Add up the counts of the closed files and of each open file.
+	OFileStats total = snapshot(_sStats,false);
+	for(OFile *f = _sFileListHead; f; f = f->_next)
+	{
+		addStats(total,snapshot(f->_stats,false));
+		addStats(total,f->_statsReset);
+	}
+
+	OFileStats copy = total;
+	addStats(copy,_sStatsBase,true);
+	if(reset)
+		_sStatsBase = total;
+	return copy;
+}
+
+void OFile::setStatsHook(StatsHook hook,void *arg)
+// Static
+// Set a function to be called at the end of every commit, for example to
+// export stats() to a metrics system. It is called with the file and arg.
+// 0 removes it.
+{
+	OFGuard sguard(_sMutex);
+
+	_sStatsHook = hook;
+	_sStatsHookArg = arg;
+}
+
+OFileStats OFile::snapshot(OFileStats &stats,bool reset)
+// Static
+// Return a copy of stats. Each counter is read, and cleared if reset is
+// true, atomically, so no counts are lost while other threads update them.
+{
+	oFAssert(sizeof(OFileStats) == OFileStats::cCounters*sizeof(OSYS_ULONG64));
+
+	OFileStats copy;
+	for(int i = 0; i < OFileStats::cCounters; i++)
+		copy.counter(i) = reset ? ofAtomicClear(stats.counter(i)) : ofAtomicAdd(stats.counter(i),0);
+	return copy;
+}
+
+void OFile::addStats(OFileStats &to,const OFileStats &from,bool subtract)
+// Static
+// Add each counter of from to to, or subtract it if subtract is true.
+// Adding is atomic, because the global counts can be added to by other
+// threads.
+{
+	for(int i = 0; i < OFileStats::cCounters; i++)
+	{
+		if(subtract)
+			to.counter(i) -= from.counter(i);
+		else
+			ofAtomicAdd(to.counter(i),from.counter(i));
+	}
+}
+
+OSYS_ULONG64 OFileStats::now(void)
+// Static
+// Return a time in microseconds for measuring durations.
+{
+#if defined(__WIN32__) || defined(_WIN32)
+	LARGE_INTEGER count,frequency;
+	QueryPerformanceCounter(&count);
+	QueryPerformanceFrequency(&frequency);
+	return (OSYS_ULONG64)(count.QuadPart/(frequency.QuadPart/1000000.0));
+#elif defined(__unix__) || defined(__APPLE__)
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (OSYS_ULONG64)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+#else
+	return (OSYS_ULONG64)((double)clock()*1000000/CLOCKS_PER_SEC);
+#endif
+}
+
 OPersist *OFile::restore(OPersist *ob)
 // Restore an object with data from the file. The objects address is
 // invalidated.
@@ -881,6 +1493,8 @@ long OFile::purge(OClassId_t cId,bool deep,long toPurge)
 	}
 
 	_sPermitObjectDestruction = save_permitObjectDestruction;
+	count(&OFileStats::purges);
+	count(&OFileStats::objectsPurged,objectsPurged);
 	return objectsPurged;
 }
 
@@ -945,11 +1559,25 @@ void OFile::write(OOStreamFile *out)const
 			out->writeLong((O_LONG)_cList.classList(cId).size());
 
 			// Write object headers
+			OId prevId = 0;
 			for(ClassList::iterator it = _cList.classList(cId).begin(); it != _cList.classList(cId).end();++it)
 			{
-				out->writeObjectId((*it).first);
+				if(isCompact())
+				{
+					// Identities are in ascending order so the difference from
+					// the previous one is small.
+					out->writeObjectId((*it).first - prevId);
+					prevId = (*it).first;
+				}
+				else
+					out->writeObjectId((*it).first);
 				out->writeFilePos((*it).second._mark);
 				out->writeLong((*it).second._length);
+				if(hasChecksums())
+				{
+					const OSYS_ULONG32 *crc = crcOf((*it).first);
+					out->writeLong(crc ? (O_LONG)*crc : 0);
+				}
 			}
 		}
 	}
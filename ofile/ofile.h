@@ -54,6 +54,69 @@ using std::min;
 
 
 class OIterator;
+class OScanIterator;
+
+struct OSpaceStats
+// How the space in an OFile is used(see OFile::spaceStats()).
+// Free space at the end of the file is reserved for growth and is not
+// counted as a hole.
+{
+	enum {cHoleBuckets = 32};
+
+	OFilePos_t fileLength;    // Length of the file.
+	OFilePos_t indexBytes;    // Length of the index and free list.
+	oulong objects;           // Number of objects.
+	OFilePos_t liveBytes;     // Bytes of object data.
+	oulong classObjects[cOMaxClasses + 1]; // Number of objects of each class.
+	OFilePos_t classBytes[cOMaxClasses + 1]; // Bytes of object data of each class.
+	OFilePos_t freeBytes;     // Bytes in holes.
+	oulong holes;             // Number of holes.
+	OFilePos_t largestHole;   // Length of the largest hole.
+	oulong holeHistogram[cHoleBuckets]; // Number of holes of length 2^n to 2^(n+1)-1.
+	OFilePos_t reservedBytes; // Free space at the end of the file.
+	oulong pages;             // Number of size class pages.
+	OFilePos_t pageSlack;     // Bytes of size class pages not used by objects.
+	OFilePos_t otherBytes;    // Remaining bytes. Header and blobs.
+
+	// Return the average length of an object in the file.
+	double averageObjectSize(void)const{return objects ? (double)liveBytes/objects : 0.0;}
+	// Return the fraction of the free space that is not in the largest hole.
+	// 0 is no fragmentation.
+	double fragmentation(void)const{return freeBytes ? 1.0 - (double)largestHole/freeBytes : 0.0;}
+};
+
+struct OFileStats
+// Counts of what OFiles have done(see OFile::stats()). Every member is an
+// OSYS_ULONG64 counter, so that they can be added and cleared together.
+// Times are in microseconds.
+{
+	OSYS_ULONG64 objectsRead;        // Objects constructed from the file.
+	OSYS_ULONG64 cacheHits;          // Objects asked for that were in memory.
+	OSYS_ULONG64 cacheMisses;        // Objects asked for that had to be read.
+	OSYS_ULONG64 bytesRead;          // Bytes read from the file.
+	OSYS_ULONG64 bytesWritten;       // Bytes written to the file.
+	OSYS_ULONG64 reads;              // Read calls to the io layer.
+	OSYS_ULONG64 writes;             // Write calls to the io layer.
+	OSYS_ULONG64 commits;            // Commits.
+	OSYS_ULONG64 commitSizeTime;     // Time finding the length of objects and placing them.
+	OSYS_ULONG64 commitAllocateTime; // Time allocating space for the index.
+	OSYS_ULONG64 commitWriteTime;    // Time writing objects.
+	OSYS_ULONG64 commitIndexTime;    // Time writing the index and the header.
+	OSYS_ULONG64 commitFreeListTime; // Time writing the free list.
+	OSYS_ULONG64 commitHoleTime;     // Time punching holes in the free space.
+	OSYS_ULONG64 purges;             // Calls to purge().
+	OSYS_ULONG64 objectsPurged;      // Objects removed from memory by purge().
+	OSYS_ULONG64 newHandlerCalls;    // Calls of the new_handler. Only in globalStats().
+	OSYS_ULONG64 freeListSearches;   // Searches of the free list for space.
+	OSYS_ULONG64 freeListSteps;      // Free spaces looked at by those searches.
+
+	enum {cCounters = 19};
+	OSYS_ULONG64 &counter(int i){return (&objectsRead)[i];}
+	OSYS_ULONG64 counter(int i)const{return (&objectsRead)[i];}
+
+	static OSYS_ULONG64 now(void);
+};
+
 
 
 class OFile
@@ -62,12 +125,27 @@ class OFile
 // These friends are defined so as to provide only the necassary
 // methods to the user of OFile, and no more.
 friend class OIterator;
+friend class OScanIterator;
 friend class FreeList;
 friend class OPersist;
 friend class OOStreamFile;
 friend class OIStreamFile;
 
 	enum {cHeaderLength = 100 + 2*(sizeof(OFilePos_t) - sizeof(long))};
+	// Position of the header checksum, which is of the bytes before it.
+	enum {cHeaderCrcOffset = 8 + 6*sizeof(O_LONG) + 2*sizeof(OFilePos_t)};
+	// Encodings of object data and indexes.
+	enum {cEncodingFixed = 0,		// Integers have a fixed size.
+		  cEncodingCompact = 1,		// Integers are variable length.
+		  cEncodingCompressed = 2,	// Objects may be compressed. Combines with the above.
+		  cEncodingChecksum = 4,	// Objects, index and header have checksums. Combines
+									// with the above.
+		  cEncodingSizeClasses = 8,	// Small objects are in size class pages. Combines
+									// with the above.
+		  cEncodingSharedBlobs = 16	// Blobs with the same content share their space.
+		 };							// Combines with the above.
+	// Bit of an object entry length that marks a compressed object.
+	enum {cOEntCompressed = 0x80000000UL};
 
 class OEnt{
 // Node of a class list.
@@ -77,9 +155,16 @@ public:
 	OEnt(OPersist *ob,OFilePos_t fMark):_ob(ob),_mark(fMark),_length(0){}
 	OEnt(OFilePos_t mark,long length):_ob(0),_mark(mark),_length(length){}
 
+	// Length of the object in the file.
+	oulong length(void)const{return _length & (cOEntCompressed - 1);}
+	// Object is stored compressed.
+	bool compressed(void)const{return (_length & cOEntCompressed) != 0;}
+	void setLength(oulong length,bool compressed)
+		{_length = compressed ? (length | cOEntCompressed) : length;}
+
 	OPersist *_ob;	 // Pointer to object. 0 if object is not in memory
 	OFilePos_t _mark;	 // Objects position in file. 0 if not yet written to file
-	oulong _length;	 // length of object in file.
+	oulong _length;	 // length of object in file and the compressed bit.
 };
 public:
 // These would benefit from an allocator using a fixed size block heap.
@@ -88,9 +173,11 @@ public:
 // This is not defined usually.
 typedef hash_map<OId,OEnt,hash <OId >,equal_to<OId> >  ClassList;
 typedef hash_map<OId,OClassId_t,hash <OId >,equal_to<OId>  > ObjectList;
+typedef hash_map<OId,OSYS_ULONG32,hash <OId >,equal_to<OId>  > CrcList;
 #else
 typedef map<OId,OEnt,less <OId > >  ClassList;
 typedef map<OId,OClassId_t,less<OId> > ObjectList;
+typedef map<OId,OSYS_ULONG32,less<OId> > CrcList;
 #endif
 private:
 class ClassLists{
@@ -108,6 +195,11 @@ private:
 
 public:
 	typedef void (*New_handler)();
+	// Return true to keep a reference to ob after the call.
+	typedef bool (*ForEachFunc)(OPersist *ob,void *arg);
+	typedef bool (*ForEachPartFunc)(OPersist *ob,void *arg,int part);
+	typedef void (*ForEachBatchFunc)(void *arg,int parts);
+	typedef void (*VerifyFunc)(OId id,OClassId_t cId,void *arg);
 
 	OFile(const char *fname,long operation,const char *magicNumber = 0);
 #ifdef OF_OLE
@@ -126,10 +218,23 @@ public:
 	oulong objectCount(OClassId_t id = cOPersist,bool deep = true);
 	OPersist *getObject(const OId,OClassId_t = cOPersist);
 	virtual void commit(bool compact = false,bool wipeFreeSpace = false);
+	oulong defragment(oulong budget = 1048576L);
 	void fastFindOff(void);
 	long purge(OClassId_t cId = cOPersist,bool deep = true,long toPurge = LONG_MAX);
 	OPersist *restore(OPersist *ob);
+	long parallelForEach(OClassId_t cId,bool deep,ForEachFunc fn,void *arg = 0,int nThreads = 0);
+	long parallelForEach(OClassId_t cId,bool deep,ForEachPartFunc fn,ForEachBatchFunc batchDone,
+						 void *arg = 0,long batchSize = 0,int nThreads = 0);
 	void setObjectOId(OPersist *ob,OId id);
+	long verify(VerifyFunc badObject = 0,void *arg = 0);
+	OSpaceStats spaceStats(void);
+
+	// Counters. They are always kept. A snapshot is returned, and the
+	// counters are cleared if reset is true.
+	typedef void (*StatsHook)(OFile *file,void *arg);
+	OFileStats stats(bool reset = false);
+	static OFileStats globalStats(bool reset = false);
+	static void setStatsHook(StatsHook hook,void *arg = 0);
 
 	// Version control methods
 	// Return the version of this file.
@@ -140,6 +245,11 @@ public:
 	static void setUserSourceVersion(long v){_sUserSourceVersion = v;}
 
 	bool needSwap(void)const{return	_sProcessorId != _fileProcessorId;}
+	bool isCompact(void)const{return (_encoding & cEncodingCompact) != 0;}
+	bool isCompressed(void)const{return (_encoding & cEncodingCompressed) != 0;}
+	bool hasChecksums(void)const{return (_encoding & cEncodingChecksum) != 0;}
+	bool hasSizeClasses(void)const{return (_encoding & cEncodingSizeClasses) != 0;}
+	bool hasSharedBlobs(void)const{return (_encoding & cEncodingSharedBlobs) != 0;}
 
 	virtual bool isDirty(void);
 	bool isReadOnly(void)const{return (OFILE_OPEN_READ_ONLY & _operation) == OFILE_OPEN_READ_ONLY;}
@@ -148,6 +258,13 @@ public:
 	void setAutoCommit(bool autoCommit = true){_autoCommit = autoCommit;}
 	bool isAutoCommit(void)const{return _autoCommit;}
 
+	// File growth(see setGrowth()).
+	void setGrowth(oulong minGrowth,int percent = 0);
+	bool isGrowing(void)const{return _growthMin || _growthPercent;}
+	// Release the disk space of free space of at least minLength bytes at
+	// each commit. 0(the default) leaves it allocated.
+	void setHolePunching(oulong minLength){_holeMin = minLength;}
+
 	// This function should be used with care.
 	void setRetainIdentity(bool retainIdentity){_retainIdentity = retainIdentity;}
 	bool retainIdentity(void)const{return _retainIdentity;}
@@ -178,8 +295,17 @@ public:
     // caution, otherwise they can screw up the file.
   	OFilePos_t getSpace(oulong length){return _fList.getSpace(length);}
 	void freeSpace(OFilePos_t mark,oulong length){_fList.freeSpace(mark,length);}
+	// Space for blob data. In a file with shared blobs(see OFILE_DEDUP) blobs
+	// with the same content share it, and write is set false if the data
+	// is already there.
+	OFilePos_t getBlobSpace(const void *buf,oulong length,bool &write);
+	void freeBlobSpace(OFilePos_t mark,oulong length){_fList.freeBlobSpace(mark,length);}
 	// Read a blob of binary data from the given position in the file.
    	void readBlob(void *buf,OFilePos_t mark,unsigned long size){_in.readBlob(buf,mark,size);}
+	// Read only access to blob data in place, if the file is mapped.
+	const char *view(OFilePos_t mark,oulong size)const;
+	// Copy size bytes of blob data in the file from one position to another.
+	void copyBlob(OFilePos_t from,OFilePos_t to,oulong size);
 
 	// Physically close the current file
 	void close(void);
@@ -198,10 +324,24 @@ private:
 	void pErase(OPersist *);
 
 	OPersist *getObject(ClassList::iterator it,OClassId_t);
+	OPersist *getObject(ClassList::iterator it,OClassId_t,OIStreamFile &in,bool started);
+	const OSYS_ULONG32 *crcOf(OId id)const;
+	void setCrc(OId id,OSYS_ULONG32 crc);
+	// Used by parallelForEach
+	class ForEachPart;
+	static void forEachWorker(void *part);
 	// Used by friend: FreeList
 	void setLength(OFilePos_t len){_fileLength = len;}
 	void increaseLengthBy(oulong len);
+	oulong growthFor(oulong len)const;
 	long size(void)const;
+	long compactSize(void)const;
+	// Used by friends to count in the file stats. The global stats are the
+	// sum of those of the files.
+	void count(OSYS_ULONG64 OFileStats::*counter,OSYS_ULONG64 n = 1)
+		{ofAtomicAdd(_stats.*counter,n);}
+	static OFileStats snapshot(OFileStats &stats,bool reset);
+	static void addStats(OFileStats &to,const OFileStats &from,bool subtract = false);
 	FreeList *freeList(void){return &_fList;}
 	// Accessors for Object File only
 	O_fd *fd(void){return _in.fd();}
@@ -226,18 +366,27 @@ private:
 	static New_handler _sNew_handler;       // handler for when the object threshold
 										    // is exceeded.
 	static int _sUniqueFileId;              // First avaialable unique identity of OFile.
+	static OFileStats _sStats;              // Counts of closed files, and global counts.
+	static OFileStats _sStatsBase;          // Counts of all files when the global
+										    // counts were last reset.
+	static StatsHook _sStatsHook;           // Called after each commit.
+	static void *_sStatsHookArg;            //
 
 	ObjectList *_oList;	 // Object list (used by fastFind option)
+	CrcList *_crcList;	 // Checksums of the objects in the file, if it has them.
 	ClassLists _cList;	 // Class list
 	FreeList _fList;	 // Free list
 	OIStreamFile _in;	 // Input stream to disk file.
+	char *_fileName;	 // Name of the disk file, or 0 if not known.
 
 	OId _uniqueId;		 // First available unique object identity in file.
 	OFilePos_t _fileLength;  // Length of the file in bytes(lazy).
 	OFilePos_t _oFileMark;	 // File position of the OFile object.
 	long _oFileVersion;	 // Version of file
 	long _oFileLength;   // Length of the OFile object
+	OSYS_ULONG32 _oFileCrc; // Checksum of the OFile object
 	unsigned long _fileProcessorId;
+	long _encoding;		 // Encoding of objects and indexes.
 	long _userVersion;	 // User version of file
     ClassList::iterator _currentIndex;
 	OFile *_next;        // Maintain a null terminated linked list of files.
@@ -247,6 +396,22 @@ private:
 	bool _autoCommit;	 // Allow file to automatically commit.
 	bool _retainIdentity;// Retain the identity of objects when detaching from
 						 // the file. Default is false.
+	oulong _growthMin;   // Minimum number of bytes to grow the file by.
+	int _growthPercent;  // Minimum growth as a percentage of the file length.
+	oulong _holeMin;     // Minimum length of free space to punch a hole for.
+	const char *_view;   // Read only mapping of the file, or 0.
+	OFilePos_t _viewLength;
+	OFileStats _stats;   // Counts of this file.
+	OFileStats _statsReset; // Counts taken from _stats by resetting them.
+	// Used by defragment
+	struct DefragEnt{
+		OFilePos_t _mark;
+		OId _id;
+		OClassId_t _cId;
+		bool operator<(const DefragEnt &e)const{return _mark < e._mark;}
+	};
+	vector<DefragEnt> _defragOrder; // Objects by position to be moved
+	size_t _defragNext;  // Number of _defragOrder not yet visited
 
 protected:
 	long _operation;     // Flags that were used when opening this file.
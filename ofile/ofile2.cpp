@@ -96,21 +96,41 @@ OFilePos_t OFile::allocateObject(ClassList::iterator it,long objectLength)
 // Return the position in the file.
 {
 	// Fill in the object entry of the object
-	if((*it).second._length != objectLength){
+	if((long)(*it).second.length() != objectLength){
+		// A small object can stay in its slot if it is still the right size.
+		if((*it).second._mark && _fList.fitsSlot((*it).second._mark,objectLength))
+		{
+			(*it).second.setLength(objectLength,false);
+			return (*it).second._mark;
+		}
 		// Objects size has changed so release its old space
 		if((*it).second._mark)
-			_fList.freeSpace((*it).second._mark,(*it).second._length);
+			_fList.freeSpace((*it).second._mark,(*it).second.length());
 		// and find a new place for it
-		(*it).second._mark = _fList.getSpace(objectLength);
-		(*it).second._length = objectLength;
+		(*it).second._mark = _fList.getObjectSpace(objectLength);
+		(*it).second.setLength(objectLength,false);
 	}
 	return (*it).second._mark;
 }
 
 
+class BlobDataGuard
+// Makes the free list forget the data of the new shared blobs when a
+// commit ends, even by an exception. The data belongs to the blobs, which
+// may change or delete it before they are written by another commit.
+{
+public:
+	BlobDataGuard(FreeList &fList):_fList(fList){}
+	~BlobDataGuard(void){_fList.blobsWritten();}
+
+private:
+	FreeList &_fList;
+};
+
+
 void OFile::commit(bool /* compact */,bool wipeFreeSpace)
 // Commit the file to the disk.
-// Parameters: compact - Obsolete - see OUFile::compact()
+// Parameters: compact - Obsolete - see defragment()
 // wipeFreeSpace - writes a character('\xFE) over the free space. 
 //				   default is false. This should
 //                 improve the compression ratio when zipped.
@@ -120,7 +140,7 @@ void OFile::commit(bool /* compact */,bool wipeFreeSpace)
 // The second actually writes the objects.
 // Exceptions: OFileErr is thrown if the file cannot be written.
 {
-long objectLength;
+long objectLength = -1;
 OFilePos_t mark = 0;
 OClassId_t cId;
 
@@ -130,9 +150,20 @@ OClassId_t cId;
 	// Do not enter in more than one thread.
     OFGuard guard(_mutex);
 
+	// Space freed since the last commit can be used now.
+	_fList.hold(false);
+
+	// The data of new shared blobs is forgotten however the commit ends.
+	BlobDataGuard blobGuard(_fList);
+
 	OOStreamFile out(this);
+	out.setCompact(isCompact());
+	out.setCompress(isCompressed());
+	out.keepPacked(isCompressed());
+	out.setChecksum(hasChecksums());
 
 	// ===================   PASS 1   =====================
+	OSYS_ULONG64 start = OFileStats::now();
 
 	// De-allocate the space for the indexes. This is so that no holes
 	// are left.
@@ -150,7 +181,12 @@ OClassId_t cId;
 				// No need to write an object that has not been read or has not been changed.
 				continue;
 
-			if((objectLength = ob->oSize()) == -1){
+			// A size given by oSize() is for the fixed encoding and
+			// uncompressed. With shared blobs the object is streamed
+			// anyway, because that is when its blobs find their space,
+			// which must be before the index and free list are sized.
+			if(isCompact() || isCompressed() || hasSharedBlobs() ||
+			   (objectLength = ob->oSize()) == -1){
 
 				// Object of unknown size so
 				// calculate the length of the object entry.
@@ -162,8 +198,14 @@ OClassId_t cId;
 
 			// Fill in the object entry of the object
 			mark = allocateObject(it,objectLength);
+			(*it).second.setLength(objectLength,out.compressed());
+			// A compressed object is kept to be written at its mark.
+			out.packedAt(mark);
 		}
 	}
+	OSYS_ULONG64 time = OFileStats::now();
+	count(&OFileStats::commitSizeTime,time - start);
+	start = time;
 
 	// Now allocate space for the indexes and freelist. The problem here is that we must allocate
 	// space before writing the object. This is because the free list must be
@@ -175,15 +217,29 @@ OClassId_t cId;
 	// Calculate size of OFile data
 	long fileSize = size();
 	_oFileLength = 	fileSize + (oulong)_fList.size();
+	// In the compact encoding, getting the space can move a free list entry
+	// to a higher mark, which may take more bytes.
+	if(isCompact())
+		_oFileLength += OUtilityFunction::cMaxVarintLength;
 
 	// and get space for it
 	_oFileMark = _fList.getSpace(_oFileLength);
 
+	// Space reserved for growth is kept at the end of the file until the
+	// growth is turned off.
+	if(!isGrowing())
+		_fList.trimEnd();
+
 	// Now that we know the length of the file we require, try to set it.
 	// We do this here so that if we fail we will not be left with a half
 	// written file.
+	if(isGrowing())
+		out.reserve(_fileLength);
 	if(!out.setLength(_fileLength))
 		throw OFileErr("Failed to allocate space on the disk for the file.");
+	time = OFileStats::now();
+	count(&OFileStats::commitAllocateTime,time - start);
+	start = time;
 
 	// ===================   PASS 2   =====================
 
@@ -203,20 +259,57 @@ OClassId_t cId;
 				continue;
 
 			// Write it to the output stream.
-			out.start((*it).second._mark,(*it).second._length);
+			out.start((*it).second._mark,(*it).second.length());
 			ob->oWrite(&out);
 			out.finish();
+			if(hasChecksums())
+				setCrc((*it).first,out.crc());
 
 			// Object is now safely on file.
 			ob->oSetClean();
 		}
 	}
+	// The data of new shared blobs is now in the file.
+	_fList.blobsWritten();
+
+	time = OFileStats::now();
+	count(&OFileStats::commitWriteTime,time - start);
+	start = time;
 
 	// Update file version
 	_userVersion = _sUserSourceVersion;
-	_oFileVersion = _sOFileSourceVersion;
+	// Files in the fixed encoding are written as version 2, so that they can
+	// still be read by older sources.
+	// Compact files that are not compressed and have no checksums are version 3.
+	_oFileVersion = (_encoding & ~cEncodingCompact) ? _sOFileSourceVersion :
+					isCompact() ? 3 : 2;
+
+	// The index and header are not compressed.
+	out.setCompress(false);
+	out.keepPacked(false);
 
-	// Write the header - size 100 bytes.
+	// Write the index before the header, because the header has its checksum.
+	// We must recalculate the length because the freelist size might
+	// have got smaller. With checksums the index fills the space allocated
+	// for it, because that is what is read.
+	out.start(_oFileMark,hasChecksums() ? _oFileLength : fileSize + _fList.size());
+	write(&out);
+	// Write the free list.
+	OSYS_ULONG64 freeListStart = OFileStats::now();
+	_fList.write(&out,wipeFreeSpace);
+	OSYS_ULONG64 freeListTime = OFileStats::now() - freeListStart;
+	if(hasChecksums())
+	{
+		char zeros[64] = {0};
+		OFilePos_t indexLength = _oFileLength;
+		while(out.length() < indexLength)
+			out.writeBytes(zeros,(size_t)min((OFilePos_t)sizeof(zeros),indexLength - out.length()));
+	}
+	out.finish();
+	_oFileCrc = out.crc();
+
+	// Write the header - size 100 bytes. It always has the fixed encoding.
+	out.setCompact(false);
 	out.start(0,cHeaderLength);
 
 	// Ensure the processorid does not get swapped.
@@ -228,28 +321,178 @@ OClassId_t cId;
 	out.writeObjectId(_rootId);
 	out.writeFilePos(_fileLength);
 	out.writeBytes(_magicNumber,4);
+	out.writeLong(_encoding);
+	out.writeLong((O_LONG)_oFileCrc);
+	// Checksum of the header so far.
+	oFAssert(out.length() == cHeaderCrcOffset);
+	out.writeLong(hasChecksums() ? (O_LONG)out.crc() : 0);
 
-	for(int i = 5*sizeof(long)+ 2*sizeof(OFilePos_t)+sizeof(OId); i < cHeaderLength ; i += sizeof(0L))
+	for(int i = 8*sizeof(long)+ 2*sizeof(OFilePos_t)+sizeof(OId); i < cHeaderLength ; i += sizeof(0L))
 		out.writeLong(0);
 
 	out.finish();
 
-	// We must recalculate the length because the freelist size might
-	// have got smaller.
-	out.start(_oFileMark,fileSize + _fList.size());
-	write(&out);
-	// Write the free list.
-	_fList.write(&out,wipeFreeSpace);
-	out.finish();
+	time = OFileStats::now();
+	count(&OFileStats::commitIndexTime,time - start - freeListTime);
+	count(&OFileStats::commitFreeListTime,freeListTime);
+	start = time;
+
+	// The header no longer refers to anything in the free space, so its disk
+	// space can be given back.
+	if(_holeMin)
+	{
+		_fList.punchHoles(&out,_holeMin);
+		count(&OFileStats::commitHoleTime,OFileStats::now() - start);
+	}
+
+	// Space freed from now on is held until the next commit.
+	_fList.hold(true);
 
 	// File is no longer dirty
 	_dirty = false;
+
+	count(&OFileStats::commits);
+	if(_sStatsHook)
+		(*_sStatsHook)(this,_sStatsHookArg);
+}
+
+
+oulong OFile::defragment(oulong budget)
+// Move objects from the end of the file into free space nearer its start,
+// so that the next commit can shorten the file. Objects are moved until
+// budget bytes have been moved, so it can be done a step at a time between
+// commits, or by a background thread.
+// Objects in size class pages and blobs are not moved. The objects are
+// copied as they are in the file, so those in memory are not affected.
+// Only space that was free at the last commit is written, so the file
+// that was committed is still whole if it is not committed again.
+// The objects are visited from the end of the file in an order that is
+// kept from one call to the next, so each call costs in proportion to its
+// budget. The order is made again when all of it has been visited.
+// Return the number of bytes moved. 0 means that there is nothing left to
+// move.
+// Exceptions: OFileErr is thrown if the file cannot be written.
+{
+	// Should not be changing a readonly file.
+	oFAssert(!isReadOnly());
+
+	// Do not enter in more than one thread.
+    OFGuard guard(_mutex);
+
+	// After a failed commit the free space is not known to be unused.
+	if(!_fList.holding())
+		return 0;
+
+	oulong moved = 0;
+	bool ordered = false;
+
+	while(moved < budget)
+	{
+		OFilePos_t firstFree = _fList.firstFree();
+		if(!firstFree)
+			break;
+
+		if(!_defragNext)
+		{
+			if(ordered)
+				break;
+
+			// Order the objects after the first free space by position.
+			_defragOrder.clear();
+			for(OClassId_t cId = 1; cId <= cOMaxClasses; cId++)
+			{
+				for(ClassList::iterator it = _cList.classList(cId).begin();
+				    it != _cList.classList(cId).end();
+				    ++it)
+				{
+					OEnt &oe = (*it).second;
+					if(oe._mark > firstFree && oe.length() && !_fList.inSlot(oe._mark))
+					{
+						DefragEnt d;
+						d._mark = oe._mark;
+						d._id = (*it).first;
+						d._cId = cId;
+						_defragOrder.push_back(d);
+					}
+				}
+			}
+			sort(_defragOrder.begin(),_defragOrder.end());
+			_defragNext = _defragOrder.size();
+			ordered = true;
+			continue;
+		}
+
+		// Move the last objects first into the first space that they fit.
+		const DefragEnt &d = _defragOrder[--_defragNext];
+		if(d._mark <= firstFree)
+		{
+			// The rest are before the first free space.
+			_defragNext = 0;
+			continue;
+		}
+
+		// The object may have been deleted or moved since it was ordered.
+		ClassList &cl = _cList.classList(d._cId);
+		ClassList::iterator it = cl.find(d._id);
+		if(it == cl.end() || (*it).second._mark != d._mark || !(*it).second.length())
+			continue;
+
+		OEnt &oe = (*it).second;
+		oulong length = oe.length();
+		OFilePos_t mark = _fList.getSpaceBefore(length,oe._mark);
+		if(!mark)
+			continue;
+
+		// The new place ends before the old one, so they do not overlap.
+		copyBlob(oe._mark,mark,length);
+
+		// The old place is held until the next commit.
+		_fList.freeSpace(oe._mark,length);
+		oe._mark = mark;
+		moved += length;
+		// The index must be committed.
+		_dirty = true;
+	}
+
+	return moved;
+}
+
+
+OFilePos_t OFile::getBlobSpace(const void *buf,oulong length,bool &write)
+// Get space for length bytes of blob data at buf. In a file with shared
+// blobs, the space of a blob with the same content is shared and write
+// is set false. Otherwise new space is got and write is set true.
+{
+	if(!hasSharedBlobs())
+	{
+		write = true;
+		return _fList.getSpace(length);
+	}
+	return _fList.getBlobSpace(buf,length,write);
+}
+
+void OFile::copyBlob(OFilePos_t from,OFilePos_t to,oulong size)
+// Copy size bytes of data in the file from one position to another, a
+// piece at a time. The two places must not overlap.
+{
+	OOStreamFile out(this);
+	char buf[4096];
+
+	for(oulong done = 0; done < size; done += sizeof(buf))
+	{
+		unsigned long length = (unsigned long)min((oulong)sizeof(buf),size - done);
+		_in.readBlob(buf,from + done,length);
+		out.writeBlob(buf,to + done,length);
+	}
 }
 
 
 long OFile::size(void)const
 // Return the size of OFile as required in the file.
 {
+	if(isCompact())
+		return compactSize();
+
 	long nObjects = 0;
 	OClassId_t nClasses = 0;
 	for(OClassId_t cId = 1; cId <= cOMaxClasses; cId++){
@@ -261,7 +504,8 @@ long OFile::size(void)const
 	return			 	sizeof(_uniqueId) +
 						nObjects*(sizeof(OId)+ 		// OEnt - Object entries
 								  sizeof(OFilePos_t)+
-								  sizeof(long))+
+								  sizeof(long)+
+								  (hasChecksums() ? sizeof(long) : 0))+
 						nClasses*(sizeof(short) +  	// class id
 								  sizeof(long))+    // Class list headers
 						sizeof(short);              // terminator
@@ -269,6 +513,37 @@ long OFile::size(void)const
 }
 
 
+long OFile::compactSize(void)const
+// Return the size of OFile as required in the file with the compact encoding.
+// This must match what write() writes, or be more if the file has checksums.
+{
+	long len = OUtilityFunction::varintLength(OUtilityFunction::zigzag((O_LONG)_uniqueId));
+	for(OClassId_t cId = 1; cId <= cOMaxClasses; cId++){
+		const ClassList &cl = _cList.classList(cId);
+		if(cl.begin() == cl.end())
+			continue;
+
+		// Class header
+		len += OUtilityFunction::varintLength(OUtilityFunction::zigzag((O_SHORT)cId)) +
+			   OUtilityFunction::varintLength(OUtilityFunction::zigzag((O_LONG)cl.size()));
+
+		// Object entries
+		OId prevId = 0;
+		for(ClassList::const_iterator it = cl.begin(); it != cl.end(); ++it)
+		{
+			len += OUtilityFunction::varintLength((OId)((*it).first - prevId)) +
+				   OUtilityFunction::varintLength((*it).second._mark) +
+				   OUtilityFunction::varintLength(OUtilityFunction::zigzag((O_LONG)(*it).second._length));
+			// Checksums of the objects being written are not known yet, so
+			// allow for the largest.
+			if(hasChecksums())
+				len += OUtilityFunction::varintLength(0xFFFFFFFFUL);
+			prevId = (*it).first;
+		}
+	}
+	return len + 1;		// terminator
+}
+
 void OFile::increaseLengthBy(oulong len)
 // Expand the file length by len bytes.
 // Throw OFileIOErr if the file will exceed the maximum permitted.
@@ -284,3 +559,29 @@ void OFile::increaseLengthBy(oulong len)
 
 	_fileLength += len;
 }
+
+void OFile::setGrowth(oulong minGrowth,int percent)
+// Set how much the file grows by when it runs out of free space. It grows
+// by at least minGrowth bytes and percent of its length. The space that is
+// not needed yet is kept as free space at the end of the file, and its disk
+// space is reserved in one piece where the platform supports it, so that
+// a file that is loaded in many commits is not fragmented on disk.
+// The default of 0 grows the file by exactly what is needed. Commits made
+// with no growth give the unused space at the end of the file back, so call
+// setGrowth(0) before the last commit of a bulk load.
+{
+	oFAssert(percent >= 0);
+
+	_growthMin = minGrowth;
+	_growthPercent = percent;
+}
+
+oulong OFile::growthFor(oulong len)const
+// Return the number of bytes to grow the file by to get len more bytes.
+{
+	oulong growth = max(_growthMin,(oulong)(_fileLength/100)*(oulong)_growthPercent);
+	// Do not let the reserve take the file beyond the maximum.
+	if(growth <= len || _fileLength > (cOFileMaxLength() - 10 - growth))
+		return len;
+	return growth;
+}
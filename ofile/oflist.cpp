@@ -28,8 +28,12 @@ SOFTWARE.
 #include "odefs.h"
 #include "ofile.h"
 #include "oflist.h"
+#include "ox.h"
+#include "ocrc.h"
 #include <string.h>
 
+const oulong FreeList::cClassSize[FreeList::cClasses] = {16,24,32,48,64,96,128,192,256};
+
 OFilePos_t FreeList::getSpace(oulong length)
 // Get space in the file of length - length.
 // Return start position of space.
@@ -40,42 +44,199 @@ OFilePos_t mark;
 		// No space required
 		return 0;
 
+	_oFile->count(&OFileStats::freeListSearches);
 	FList::iterator it = _fList.begin();
+	oulong steps = 0;
 	// Traverse free list
 	while(it != _fList.end()){
 
+		steps++;
 		// Look for first fit
-		if(length <= (*it).second){
-			if((*it).second == length)
-			{
-				//exact fit
-
-				mark = (*it).first;
-				// remove from free list
-				_fList.erase(it);
-				return mark;
-			}
-			else
-			{
-				// inexact fit
-
-				mark = (*it).first;
-				// adjust entry	by adding a new one and removing the old one.
-				_fList.insert(FList::value_type(mark + length,(*it).second - length));
-				_fList.erase(it);
-
-				return mark;
-			}
+		if(length <= (*it).second)
+		{
+			_oFile->count(&OFileStats::freeListSteps,steps);
+			return take(it,length);
 		}
 		it++;
 	} // while
+	_oFile->count(&OFileStats::freeListSteps,steps);
 
-	// No fit, so extend file
+	// No fit, so extend file. Free space at the end of the file, such as
+	// that reserved for growth, is extended rather than left behind.
 	mark = _oFile->getLength();
-	_oFile->increaseLengthBy(length);
+	oulong atEnd = 0;
+	FList::iterator end = _fList.end();
+	if(end != _fList.begin())
+	{
+		--end;
+		if((*end).first + (*end).second == mark)
+			atEnd = (*end).second;
+	}
+
+	oulong growth = _oFile->growthFor(length - atEnd);
+	_oFile->increaseLengthBy(growth);
+	if(atEnd)
+	{
+		mark = (*end).first;
+		_fList.erase(end);
+	}
+	// Keep what is not needed now as free space.
+	if(atEnd + growth > length)
+		_fList.insert(FList::value_type(mark + length,atEnd + growth - length));
+	return mark;
+}
+
+OFilePos_t FreeList::getSpaceBefore(oulong length,OFilePos_t limit)
+// Get space in the file of length - length that ends at or before limit.
+// The file is not extended.
+// Return start position of space or 0 if there is none.
+{
+	_oFile->count(&OFileStats::freeListSearches);
+	oulong steps = 0;
+	for(FList::iterator it = _fList.begin();
+		it != _fList.end() && (*it).first + length <= limit;
+		++it)
+	{
+		steps++;
+		// Look for first fit
+		if(length <= (*it).second)
+		{
+			_oFile->count(&OFileStats::freeListSteps,steps);
+			return take(it,length);
+		}
+	}
+	_oFile->count(&OFileStats::freeListSteps,steps);
+	return 0;
+}
+
+OFilePos_t FreeList::take(FList::iterator it,oulong length)
+// Take length bytes from the start of the free space at it.
+// Return start position of space.
+{
+	OFilePos_t mark = (*it).first;
+	if((*it).second == length)
+	{
+		//exact fit
+
+		// remove from free list
+		_fList.erase(it);
+	}
+	else
+	{
+		// inexact fit
+
+		// adjust entry	by adding a new one and removing the old one.
+		_fList.insert(FList::value_type(mark + length,(*it).second - length));
+		_fList.erase(it);
+	}
 	return mark;
 }
 
+int FreeList::sizeClass(oulong length)
+// Return the smallest size class that holds length bytes or -1 if there
+// is none.
+{
+	for(int c = 0; c < cClasses; c++)
+		if(length <= cClassSize[c])
+			return c;
+	return -1;
+}
+
+OFilePos_t FreeList::getObjectSpace(oulong length)
+// Get space in the file for an object of length - length. If the file has
+// size classes and the object is small it gets a slot in a page of its
+// class, otherwise see getSpace().
+// Return start position of space.
+{
+	int c = sizeClass(length);
+	if(!length || c < 0 || !_oFile->hasSizeClasses())
+		return getSpace(length);
+
+	OFilePos_t pageMark;
+	if(_partial[c].empty())
+	{
+		// Start a new page with the slots beyond the last one marked as used.
+		pageMark = getSpace(cPageSize);
+		Page page;
+		page._class = c;
+		page._used = 0;
+		memset(page._bits,0,sizeof(page._bits));
+		for(int slot = slots(c); slot < cMaxSlots; slot++)
+			page._bits[slot/32] |= (OSYS_ULONG32)1 << (slot % 32);
+		_pages.insert(Pages::value_type(pageMark,page));
+		_partial[c].insert(pageMark);
+	}
+	else
+	{
+		// Fill the lowest page first to keep objects together.
+		pageMark = *_partial[c].begin();
+	}
+
+	Page &page = (*_pages.find(pageMark)).second;
+	int w = 0;
+	while(page._bits[w] == 0xFFFFFFFFUL)
+		w++;
+	int bit = 0;
+	while(page._bits[w] & ((OSYS_ULONG32)1 << bit))
+		bit++;
+	page._bits[w] |= (OSYS_ULONG32)1 << bit;
+
+	if(++page._used == slots(c))
+		_partial[c].erase(pageMark);
+
+	return pageMark + (OFilePos_t)(w*32 + bit)*cClassSize[c];
+}
+
+FreeList::Pages::const_iterator FreeList::findPage(OFilePos_t mark)const
+// Return the size class page that contains mark or _pages.end().
+{
+	Pages::const_iterator it = _pages.upper_bound(mark);
+	if(it == _pages.begin())
+		return _pages.end();
+	--it;
+	return (mark < (*it).first + cPageSize) ? it : _pages.end();
+}
+
+bool FreeList::fitsSlot(OFilePos_t mark,oulong length)const
+// Return true if the space at mark is a slot of the size class of length,
+// so an object of that length can stay there.
+{
+	Pages::const_iterator it = findPage(mark);
+	return it != _pages.end() && length && sizeClass(length) == (*it).second._class;
+}
+
+bool FreeList::freeSlot(OFilePos_t mark)
+// Release the slot at mark. An empty page is returned to the free list.
+// Return false if mark is not in a size class page.
+{
+	Pages::const_iterator found = findPage(mark);
+	if(found == _pages.end())
+		return false;
+	Pages::iterator it = _pages.find((*found).first);
+
+	OFilePos_t pageMark = (*it).first;
+	Page &page = (*it).second;
+	oulong slot = (oulong)(mark - pageMark)/cClassSize[page._class];
+	OSYS_ULONG32 bit = (OSYS_ULONG32)1 << (slot % 32);
+
+	// Check that we are not freeing free space
+	oFAssert((mark - pageMark) % cClassSize[page._class] == 0);
+	oFAssert(page._bits[slot/32] & bit);
+
+	page._bits[slot/32] &= ~bit;
+	if(--page._used == 0)
+	{
+		_partial[page._class].erase(pageMark);
+		_pages.erase(it);
+		freeSpace(pageMark,cPageSize);
+	}
+	else
+	{
+		_partial[page._class].insert(pageMark);
+	}
+	return true;
+}
+
 void FreeList::freeSpace(OFilePos_t mark,oulong length)
 // Release the space at file position mark and of length length.
 // Free space is immediatly combined with its buddy if it has one, so
@@ -83,6 +244,23 @@ void FreeList::freeSpace(OFilePos_t mark,oulong length)
 {
 	oFAssert(length);
 
+	// Slots of size class pages are released to their page at once. They
+	// are not held, because slots are only taken by commit, after it has
+	// stopped holding. A page that becomes empty is freed below, so it is
+	// held like any other space.
+	if(!_pages.empty() && freeSlot(mark))
+		return;
+
+	// The last commit may still refer to the space.
+	if(_hold)
+	{
+		pair<FList::iterator,bool> held = _held.insert(FList::value_type(mark,length));
+		OFILE_UNUSED(held);
+		// Check that we are not freeing held space
+		oFAssert(held.second);
+		return;
+	}
+
 	pair<FList::iterator,bool> p = _fList.insert(FList::value_type(mark,length));
 
 	// Check that we are not freeing free space
@@ -140,7 +318,122 @@ void FreeList::freeSpace(OFilePos_t mark,oulong length)
 		}
 	}
 
-	// Clip any space at the end of the file
+	// Clip any space at the end of the file, unless it is kept for growth.
+	if(!_oFile->isGrowing())
+		trimEnd();
+
+}
+
+OFilePos_t FreeList::getBlobSpace(const void *buf,oulong length,bool &write)
+// Get space for length bytes of blob data at buf. If a blob with the same
+// content is already in the file its space is shared, and write is set
+// false. Otherwise new space is got, and write is set true. Its content
+// is kept by reference until blobsWritten() is called.
+{
+	OSYS_ULONG64 hash = OHash64::compute(buf,length);
+
+	// Different content can have the same hash, so the content is compared.
+	pair<BlobHashes::iterator,BlobHashes::iterator> range = _hashes.equal_range(hash);
+	for(BlobHashes::iterator it = range.first; it != range.second; ++it)
+	{
+		SharedBlobs::iterator s = _shared.find((*it).second);
+		if((*s).second._length == length && sameBlob((*s).first,(*s).second,buf))
+		{
+			(*s).second._refs++;
+			write = false;
+			return (*s).first;
+		}
+	}
+
+	OFilePos_t mark = getSpace(length);
+
+	SharedBlob shared;
+	shared._hash = hash;
+	shared._length = length;
+	shared._refs = 1;
+	shared._data = buf;
+	_shared.insert(SharedBlobs::value_type(mark,shared));
+	_hashes.insert(BlobHashes::value_type(hash,mark));
+	_unwritten.push_back(mark);
+
+	write = true;
+	return mark;
+}
+
+void FreeList::freeBlobSpace(OFilePos_t mark,oulong length)
+// Release the space of a blob. Shared space is only freed when the last
+// blob using it releases it. Other blob space is freed straight away.
+{
+	SharedBlobs::iterator s = _shared.find(mark);
+	if(s != _shared.end())
+	{
+		if(--(*s).second._refs > 0)
+			return;
+
+		pair<BlobHashes::iterator,BlobHashes::iterator> range = _hashes.equal_range((*s).second._hash);
+		for(BlobHashes::iterator it = range.first; it != range.second; ++it)
+		{
+			if((*it).second == mark)
+			{
+				_hashes.erase(it);
+				break;
+			}
+		}
+		_shared.erase(s);
+	}
+	freeSpace(mark,length);
+}
+
+void FreeList::blobsWritten(void)
+// The content of the new shared blobs has been written, so it is compared
+// with what is in the file from now on.
+{
+	for(vector<OFilePos_t>::iterator it = _unwritten.begin(); it != _unwritten.end(); ++it)
+	{
+		SharedBlobs::iterator s = _shared.find(*it);
+		if(s != _shared.end())
+			(*s).second._data = 0;
+	}
+	_unwritten.erase(_unwritten.begin(),_unwritten.end());
+}
+
+bool FreeList::sameBlob(OFilePos_t mark,const SharedBlob &shared,const void *buf)const
+// Return true if the shared blob at mark has the content at buf.
+{
+	if(shared._data)
+		return memcmp(shared._data,buf,shared._length) == 0;
+
+	char data[4096];
+	for(oulong done = 0; done < shared._length; done += sizeof(data))
+	{
+		unsigned long size = (unsigned long)min((oulong)sizeof(data),shared._length - done);
+		_oFile->readBlob(data,mark + done,size);
+		if(memcmp(data,(const char *)buf + done,size) != 0)
+			return false;
+	}
+	return true;
+}
+
+void FreeList::hold(bool h)
+// Start or stop holding back the space that is freed. The space held is
+// released to the free list when holding stops.
+{
+	_hold = h;
+	if(h)
+		return;
+
+	for(FList::iterator it = _held.begin(); it != _held.end(); ++it)
+		freeSpace((*it).first,(*it).second);
+	_held.erase(_held.begin(),_held.end());
+}
+
+void FreeList::trimEnd(void)
+// Remove any free space at the end of the file from the free list and
+// shorten the file.
+{
+	if(_fList.empty())
+		return;
+
 	FList::iterator end = _fList.end();
 	end--;
 	if((*end).first + (*end).second == _oFile->getLength())
@@ -148,7 +441,41 @@ void FreeList::freeSpace(OFilePos_t mark,oulong length)
 		_oFile->setLength((*end).first);
 		_fList.erase(end);
 	}
+}
+
+void FreeList::spaceStats(OSpaceStats &stats)const
+// Fill in the free space and size class page members of stats.
+{
+	addHoles(_fList,stats);
+	// Space held until the next commit is free too.
+	addHoles(_held,stats);
 
+	stats.pages = (oulong)_pages.size();
+	stats.pageSlack = (OFilePos_t)_pages.size()*cPageSize;
+}
+
+void FreeList::addHoles(const FList &list,OSpaceStats &stats)const
+// Add the free spaces of list to stats.
+{
+	for(FList::const_iterator it = list.begin(); it != list.end();++it)
+	{
+		oulong length = (*it).second;
+		if((*it).first + length == _oFile->getLength())
+		{
+			stats.reservedBytes += length;
+			continue;
+		}
+
+		stats.freeBytes += length;
+		stats.holes++;
+		if(length > stats.largestHole)
+			stats.largestHole = length;
+
+		int bucket = 0;
+		while((length >>= 1) && bucket < OSpaceStats::cHoleBuckets - 1)
+			bucket++;
+		stats.holeHistogram[bucket]++;
+	}
 }
 
 /* debugging only
@@ -176,27 +503,122 @@ void FreeList::write(OOStreamFile *out,bool wipeFreeSpace)const
 		out->writeLong((*it).second);
 	}
 
+	if(_oFile->hasSizeClasses())
+	{
+		out->writeLong((long)_pages.size());
+		for(Pages::const_iterator it = _pages.begin(); it != _pages.end();++it)
+		{
+			const Page &page = (*it).second;
+			out->writeFilePos((*it).first);
+			out->writeShort((O_SHORT)page._class);
+			for(int w = 0; w < words(page._class); w++)
+				out->writeLong((O_LONG)page._bits[w]);
+		}
+	}
+
+	if(_oFile->hasSharedBlobs())
+	{
+		out->writeLong((long)_shared.size());
+		for(SharedBlobs::const_iterator it = _shared.begin(); it != _shared.end();++it)
+		{
+			const SharedBlob &shared = (*it).second;
+			out->writeFilePos((*it).first);
+			out->writeLong(shared._length);
+			out->writeLong(shared._refs);
+			// The hash in two halves, so that it fits a long everywhere.
+			out->writeLong((O_LONG)(OSYS_ULONG32)shared._hash);
+			out->writeLong((O_LONG)(OSYS_ULONG32)(shared._hash >> 32));
+		}
+	}
+
 #ifndef WIN16
 	// This can be changed.
 	const char cOF_FreeFillChar = '\xFE';
 
 	if(wipeFreeSpace)
 	{
+		char fill[4096];
+		memset(fill,cOF_FreeFillChar,sizeof(fill));
+
 		// For every free list element write a block of fill characters.
 		for(FList::const_iterator it = _fList.begin(); it != _fList.end();++it)
 		{
-			// This will not work in 16 bit because we are possibly allocating 
-			// arrays larger than 64K.
-			char *bp = new char[(*it).second];
-			memset(bp,cOF_FreeFillChar,(*it).second);
+			// Write as blobs
+			for(oulong done = 0; done < (*it).second; done += sizeof(fill))
+				out->writeBlob(fill,(*it).first + done,
+							   (unsigned long)min((oulong)sizeof(fill),(*it).second - done));
+		}
+	}
+#endif
+}
 
-			// Write as a blob
-			out->writeBlob(bp,(*it).first,(*it).second);
+void FreeList::punchHoles(OOStreamFile *out,oulong minLength)const
+// Release the disk space of free spaces of at least minLength bytes.
+// Only whole blocks of cPageSize bytes are released, so that the file
+// system does not have to write zeros. Space at the end of the file is
+// left, because it is either cut off or reserved for growth.
+{
+	for(FList::const_iterator it = _fList.begin(); it != _fList.end();++it)
+	{
+		OFilePos_t end = (*it).first + (*it).second;
+		if((*it).second < minLength || end == _oFile->getLength())
+			continue;
+
+		OFilePos_t from = ((*it).first + cPageSize - 1)/cPageSize*cPageSize;
+		end = end/cPageSize*cPageSize;
+		if(from < end)
+			out->punchHole(from,end - from);
+	}
+}
 
-			delete []bp;
+long FreeList::size(void)const
+// Return the size of the free list as written by write().
+{
+	long len;
+	if(!_oFile->isCompact())
+	{
+		len = sizeof(long)+ _fList.size()*(sizeof(OFilePos_t)+ sizeof(long));
+		if(_oFile->hasSizeClasses())
+		{
+			len += sizeof(long);
+			for(Pages::const_iterator it = _pages.begin(); it != _pages.end();++it)
+				len += sizeof(OFilePos_t) + sizeof(O_SHORT) + words((*it).second._class)*sizeof(long);
 		}
+		if(_oFile->hasSharedBlobs())
+			len += sizeof(long) + _shared.size()*(sizeof(OFilePos_t) + 4*sizeof(long));
+		return len;
 	}
-#endif
+
+	len = OUtilityFunction::varintLength(OUtilityFunction::zigzag((O_LONG)_fList.size()));
+	for(FList::const_iterator it = _fList.begin(); it != _fList.end();++it)
+		len += OUtilityFunction::varintLength((*it).first) +
+			   OUtilityFunction::varintLength(OUtilityFunction::zigzag((O_LONG)(*it).second));
+	if(_oFile->hasSizeClasses())
+	{
+		len += OUtilityFunction::varintLength(OUtilityFunction::zigzag((O_LONG)_pages.size()));
+		for(Pages::const_iterator it = _pages.begin(); it != _pages.end();++it)
+		{
+			const Page &page = (*it).second;
+			len += OUtilityFunction::varintLength((*it).first) +
+				   OUtilityFunction::varintLength(OUtilityFunction::zigzag((O_SHORT)page._class));
+			for(int w = 0; w < words(page._class); w++)
+				len += OUtilityFunction::varintLength(OUtilityFunction::zigzag((O_LONG)page._bits[w]));
+		}
+	}
+	if(_oFile->hasSharedBlobs())
+	{
+		len += OUtilityFunction::varintLength(OUtilityFunction::zigzag((O_LONG)_shared.size()));
+		for(SharedBlobs::const_iterator it = _shared.begin(); it != _shared.end();++it)
+		{
+			const SharedBlob &shared = (*it).second;
+			len += OUtilityFunction::varintLength((*it).first) +
+				   OUtilityFunction::varintLength(OUtilityFunction::zigzag((O_LONG)shared._length)) +
+				   OUtilityFunction::varintLength(OUtilityFunction::zigzag((O_LONG)shared._refs)) +
+				   OUtilityFunction::varintLength(OUtilityFunction::zigzag((O_LONG)(OSYS_ULONG32)shared._hash)) +
+				   OUtilityFunction::varintLength(OUtilityFunction::zigzag((O_LONG)(OSYS_ULONG32)(shared._hash >> 32)));
+		}
+	}
+	return len;
 }
 
 void FreeList::read(OIStreamFile *in)
@@ -209,5 +631,46 @@ void FreeList::read(OIStreamFile *in)
 		oulong length = in->readLong();
 		_fList.insert(FList::value_type(mark,length));
 	}
+
+	if(_oFile->hasSizeClasses())
+	{
+		long pageCount = in->readLong();
+		for(long i = 0; i < pageCount;i++){
+			OFilePos_t mark = in->readFilePos();
+			Page page;
+			page._class = in->readShort();
+			if(page._class < 0 || page._class >= cClasses)
+				throw OFileIOErr("Invalid file data format");
+
+			// Count the slots in use.
+			memset(page._bits,0xFF,sizeof(page._bits));
+			page._used = 0;
+			for(int w = 0; w < words(page._class); w++)
+				page._bits[w] = (OSYS_ULONG32)in->readLong();
+			for(int slot = 0; slot < slots(page._class); slot++)
+				if(page._bits[slot/32] & ((OSYS_ULONG32)1 << (slot % 32)))
+					page._used++;
+
+			_pages.insert(Pages::value_type(mark,page));
+			if(page._used < slots(page._class))
+				_partial[page._class].insert(mark);
+		}
+	}
+
+	if(_oFile->hasSharedBlobs())
+	{
+		long sharedCount = in->readLong();
+		for(long i = 0; i < sharedCount;i++){
+			OFilePos_t mark = in->readFilePos();
+			SharedBlob shared;
+			shared._length = in->readLong();
+			shared._refs = in->readLong();
+			shared._hash = (OSYS_ULONG32)in->readLong();
+			shared._hash |= (OSYS_ULONG64)(OSYS_ULONG32)in->readLong() << 32;
+			shared._data = 0;
+			_shared.insert(SharedBlobs::value_type(mark,shared));
+			_hashes.insert(BlobHashes::value_type(shared._hash,mark));
+		}
+	}
 }
 	
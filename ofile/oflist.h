@@ -31,13 +31,19 @@ SOFTWARE.
 #endif
 
 #include <map>
+#include <set>
+#include <vector>
 
 #ifdef OFILE_STD_IN_NAMESPACE
 using std::map;
+using std::multimap;
+using std::set;
+using std::vector;
 using std::less;
 #endif
 
 class OFile;
+struct OSpaceStats;
 class OOStreamFile;
 class OIStreamFile;
 
@@ -47,19 +53,86 @@ class FreeList{
 typedef map<OFilePos_t,oulong,less<OFilePos_t> > FList;
 
 public:
-	FreeList(OFile *o):_oFile(o){}
+	// Size classes(see OFILE_SIZE_CLASSES). An object no longer than the
+	// largest class is put in a slot of the smallest class that holds it.
+	// The slots of a class are in pages of cPageSize bytes, which are
+	// allocated from the free list.
+	enum {cPageSize = 4096,cClasses = 9,cMaxSlots = cPageSize/16,cWords = cMaxSlots/32};
+	static const oulong cClassSize[cClasses];
+
+	FreeList(OFile *o):_oFile(o),_hold(true){}
 	OFilePos_t getSpace(oulong length);
+	OFilePos_t getSpaceBefore(oulong length,OFilePos_t limit);
+	OFilePos_t getObjectSpace(oulong length);
+	bool fitsSlot(OFilePos_t mark,oulong length)const;
+	bool inSlot(OFilePos_t mark)const{return findPage(mark) != _pages.end();}
+	// Return the position of the first free space or 0 if there is none.
+	OFilePos_t firstFree(void)const{return _fList.empty() ? 0 : (*_fList.begin()).first;}
 	void freeSpace(OFilePos_t mark,oulong length);
+	// Space freed between commits is held back, so that only space that was
+	// free at the last commit is used before the next one. Commit releases
+	// it with hold(false). Slots are not held(see freeSpace()).
+	void hold(bool h);
+	bool holding(void)const{return _hold;}
+	// Shared blobs(see OFILE_DEDUP). Blobs with the same content use the
+	// same space, which is freed when the last of them frees it.
+	OFilePos_t getBlobSpace(const void *buf,oulong length,bool &write);
+	void freeBlobSpace(OFilePos_t mark,oulong length);
+	void blobsWritten(void);
+	void trimEnd(void);
     void write(OOStreamFile *out,bool wipeFreeSpace)const;
+	void punchHoles(OOStreamFile *out,oulong minLength)const;
+	void spaceStats(OSpaceStats &stats)const;
 	void read(OIStreamFile *in);
-	long size(void)const{return sizeof(long)+ _fList.size()*(sizeof(OFilePos_t)+ sizeof(long));}
+	long size(void)const;
 	void clear(void)
 //    	{_fList.clear();}
-    	{_fList.erase(_fList.begin(),_fList.end());}
+    	{
+			_fList.erase(_fList.begin(),_fList.end());
+			_pages.erase(_pages.begin(),_pages.end());
+			for(int c = 0; c < cClasses; c++)
+				_partial[c].erase(_partial[c].begin(),_partial[c].end());
+			_shared.erase(_shared.begin(),_shared.end());
+			_hashes.erase(_hashes.begin(),_hashes.end());
+			_unwritten.erase(_unwritten.begin(),_unwritten.end());
+			_held.erase(_held.begin(),_held.end());
+		}
 
 private:
+	struct Page{
+		int _class;                // Index into cClassSize
+		int _used;                 // Number of slots in use
+		OSYS_ULONG32 _bits[cWords]; // Slots in use. Bits beyond the last slot are set.
+	};
+	typedef map<OFilePos_t,Page,less<OFilePos_t> > Pages;
+
+	struct SharedBlob{
+		OSYS_ULONG64 _hash;        // Hash of the content
+		oulong _length;
+		long _refs;                // Number of blobs using the space
+		const void *_data;         // The content until it is written, or 0.
+	};
+	typedef map<OFilePos_t,SharedBlob,less<OFilePos_t> > SharedBlobs;
+	typedef multimap<OSYS_ULONG64,OFilePos_t,less<OSYS_ULONG64> > BlobHashes;
+
+	OFilePos_t take(FList::iterator it,oulong length);
+	static int sizeClass(oulong length);
+	static int slots(int c){return (int)(cPageSize/cClassSize[c]);}
+	static int words(int c){return (slots(c) + 31)/32;}
+	Pages::const_iterator findPage(OFilePos_t mark)const;
+	bool freeSlot(OFilePos_t mark);
+	bool sameBlob(OFilePos_t mark,const SharedBlob &shared,const void *buf)const;
+	void addHoles(const FList &list,OSpaceStats &stats)const;
+
 	FList _fList;
+	Pages _pages;                     // Size class pages by position
+	set<OFilePos_t> _partial[cClasses]; // Pages of each class with a free slot
+	SharedBlobs _shared;              // Shared blob spaces by position
+	BlobHashes _hashes;               // Positions of shared blobs by hash
+	vector<OFilePos_t> _unwritten;    // Shared blobs to be written by commit
 	OFile *_oFile;
+	bool _hold;                       // Hold back the space that is freed
+	FList _held;                      // Space freed since the last commit
 // Test code
 public:
 	void print(void);
@@ -26,6 +26,25 @@ public:
 	}
 	~ofile_string(){delete []_data;}
 	const char *c_str(void)const{return _data;}
+	// Copy length characters, which need not be null terminated, such as
+	// an OView from OIStream::readStringView.
+	ofile_string &assign(const char *str,size_t length)
+	{
+		char *data = new char[length + 1];
+		memcpy(data,str,length);
+		data[length] = '\0';
+		delete []_data;
+		_data = data;
+		return *this;
+	}
+	// Take ownership of a string allocated with new[], such as one returned
+	// by OIStream::readCString, without copying it.
+	ofile_string &adopt(char *str)
+	{
+		delete []_data;
+		_data = str;
+		return *this;
+	}
 	ofile_string &operator=(const char *str)
 	{
     	delete []_data;
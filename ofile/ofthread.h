@@ -41,6 +41,14 @@ SOFTWARE.
 	typedef RWSTDMutex OFMutex;
 	typedef RWSTDGuard OFGuard;
 
+// No atomic operations are available, so counters may lose updates.
+inline OSYS_ULONG64 ofAtomicAdd(OSYS_ULONG64 &c,OSYS_ULONG64 n){return c += n;}
+inline OSYS_ULONG64 ofAtomicClear(OSYS_ULONG64 &c){OSYS_ULONG64 old = c;c = 0;return old;}
+
+// No thread class is available, so OFThread runs its function in the
+// calling thread.
+#define OF_THREAD_SYNCHRONOUS 1
+
 #elif defined(__WIN32__) || defined(_WIN32)
 
 // WIN32 implementation of threads
@@ -179,7 +187,206 @@ private:
 };
 
 #endif // OF_THREADS_MUTEX
+
+class OFThread
+// A worker thread. start() runs func(arg) in a new thread. join() waits
+// for it to finish.
+{
+public:
+	typedef void (*Func)(void *);
+
+	OFThread():_handle(0),_func(0),_arg(0){}
+	~OFThread(){join();}
+
+	bool start(Func func,void *arg)
+	// Return false if the thread could not be created.
+	{
+		_func = func;
+		_arg = arg;
+		_handle = CreateThread(NULL,0,run,this,0,NULL);
+		return _handle != 0;
+	}
+
+	void join(void)
+	{
+		if(_handle)
+		{
+			WaitForSingleObject(_handle,INFINITE);
+			CloseHandle(_handle);
+			_handle = 0;
+		}
+	}
+
+	static int hardwareConcurrency(void)
+	// Return the number of processors.
+	{
+		SYSTEM_INFO si;
+		GetSystemInfo(&si);
+		return (int)si.dwNumberOfProcessors;
+	}
+
+private:
+	static DWORD WINAPI run(LPVOID p)
+	{
+		OFThread *t = (OFThread *)p;
+		(*t->_func)(t->_arg);
+		return 0;
+	}
+	OFThread(const OFThread&);
+	OFThread& operator= (const OFThread&);
+
+	HANDLE _handle;
+	Func _func;
+	void *_arg;
+};
+
+inline OSYS_ULONG64 ofAtomicAdd(OSYS_ULONG64 &c,OSYS_ULONG64 n)
+// Add n to c. Return the new value.
+{
+	return (OSYS_ULONG64)InterlockedExchangeAdd64((LONGLONG volatile *)&c,(LONGLONG)n) + n;
+}
+
+inline OSYS_ULONG64 ofAtomicClear(OSYS_ULONG64 &c)
+// Set c to 0. Return the old value.
+{
+	return (OSYS_ULONG64)InterlockedExchange64((LONGLONG volatile *)&c,0);
+}
+
 // End of WIN32
+#else
+
+// POSIX threads implementation
+#include <pthread.h>
+#include <unistd.h>
+
+class OFMutex
+{
+  private:
+
+    pthread_mutex_t mutex;
+
+    //
+    // Disallow copying and assignment.
+    //
+    OFMutex (const OFMutex&);
+    OFMutex& operator= (const OFMutex&);
+
+public:
+
+  OFMutex ()
+  // Construct the mutex. It is recursive, like a WIN32 critical section,
+  // because a thread that holds it can re-enter OFile.
+  {
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr,PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&mutex,&attr);
+	pthread_mutexattr_destroy(&attr);
+  }
+  ~OFMutex ()
+  // Destroy the mutex.
+  {
+    pthread_mutex_destroy(&mutex);
+  }
+
+  void acquire ()
+  // Acquire the mutex.
+  {
+    pthread_mutex_lock(&mutex);
+  }
+
+  void release ()
+  // Release the mutex.
+  {
+    pthread_mutex_unlock(&mutex);
+  }
+};
+
+class OFGuard
+{
+public:
+
+    OFGuard  (OFMutex& m): ofmutex(m)
+    // Acquire the mutex.
+	{
+    	ofmutex.acquire();
+	}
+
+
+    ~OFGuard ()
+    // Release the mutex.
+	{
+		 ofmutex.release(); 
+	}
+
+private:
+    OFMutex& ofmutex;
+};
+
+class OFThread
+// A worker thread. start() runs func(arg) in a new thread. join() waits
+// for it to finish.
+{
+public:
+	typedef void (*Func)(void *);
+
+	OFThread():_started(false),_func(0),_arg(0){}
+	~OFThread(){join();}
+
+	bool start(Func func,void *arg)
+	// Return false if the thread could not be created.
+	{
+		_func = func;
+		_arg = arg;
+		_started = (pthread_create(&_thread,0,run,this) == 0);
+		return _started;
+	}
+
+	void join(void)
+	{
+		if(_started)
+		{
+			pthread_join(_thread,0);
+			_started = false;
+		}
+	}
+
+	static int hardwareConcurrency(void)
+	// Return the number of processors.
+	{
+		long n = sysconf(_SC_NPROCESSORS_ONLN);
+		return n > 0 ? (int)n : 1;
+	}
+
+private:
+	static void *run(void *p)
+	{
+		OFThread *t = (OFThread *)p;
+		(*t->_func)(t->_arg);
+		return 0;
+	}
+	OFThread(const OFThread&);
+	OFThread& operator= (const OFThread&);
+
+	pthread_t _thread;
+	bool _started;
+	Func _func;
+	void *_arg;
+};
+
+inline OSYS_ULONG64 ofAtomicAdd(OSYS_ULONG64 &c,OSYS_ULONG64 n)
+// Add n to c. Return the new value.
+{
+	return __sync_add_and_fetch(&c,n);
+}
+
+inline OSYS_ULONG64 ofAtomicClear(OSYS_ULONG64 &c)
+// Set c to 0. Return the old value.
+{
+	return __sync_fetch_and_and(&c,(OSYS_ULONG64)0);
+}
+
+// End of POSIX
 // #elif <other system>
 
 #endif  
@@ -196,6 +403,25 @@ public:
 //	~OFGuard(){}    // does nothing (declaring causes Borland at least to generate code)
 };
 
+inline OSYS_ULONG64 ofAtomicAdd(OSYS_ULONG64 &c,OSYS_ULONG64 n){return c += n;}
+inline OSYS_ULONG64 ofAtomicClear(OSYS_ULONG64 &c){OSYS_ULONG64 old = c;c = 0;return old;}
+
+#define OF_THREAD_SYNCHRONOUS 1
+
+#endif
+
+#ifdef OF_THREAD_SYNCHRONOUS
+class OFThread
+// Without threads start() runs func(arg) to completion in the calling
+// thread.
+{
+public:
+	typedef void (*Func)(void *);
+
+	bool start(Func func,void *arg){(*func)(arg);return true;}
+	void join(void){}
+	static int hardwareConcurrency(void){return 1;}
+};
 #endif
 
 
@@ -172,6 +172,48 @@ bool oi_setLength(Oi_fd &fd,OFilePos_t size)
 	return SetEndOfFile(fd) != 0;
 }
 
+bool oi_reserve(Oi_fd &fd,OFilePos_t size)
+// Reserve disk space for the file to grow to size bytes.
+// Return true on succes
+{
+	// Not supported. The space is allocated when the length is set.
+	OFILE_UNUSED(fd);
+	OFILE_UNUSED(size);
+	return false;
+}
+
+bool oi_punchHole(Oi_fd &fd,OFilePos_t mark,OFilePos_t length)
+// Release the disk space of length bytes at mark.
+// Return true on succes
+{
+	// Not supported. It needs a sparse file.
+	OFILE_UNUSED(fd);
+	OFILE_UNUSED(mark);
+	OFILE_UNUSED(length);
+	return false;
+}
+
+const char *oi_map(Oi_fd &fd,OFilePos_t length)
+// Map the first length bytes of the file into memory, read only.
+// Return the address of the mapping or 0 if it could not be mapped.
+{
+	HANDLE mapping = CreateFileMapping(fd,NULL,PAGE_READONLY,0,0,NULL);
+	if(!mapping)
+		return 0;
+
+	// The view keeps the mapping open.
+	void *view = MapViewOfFile(mapping,FILE_MAP_READ,0,0,(SIZE_T)length);
+	CloseHandle(mapping);
+	return (const char *)view;
+}
+
+void oi_unmap(const char *view,OFilePos_t length)
+// Release a mapping made by oi_map().
+{
+	OFILE_UNUSED(length);
+	UnmapViewOfFile(view);
+}
+
 int oi_fflush(Oi_fd &fd)
 // Flush the file
 {
@@ -320,6 +362,44 @@ bool oi_setLength(Oi_fd &fd,OFilePos_t size)
 	return !chsize(fd,size);
 }
 
+bool oi_reserve(Oi_fd &fd,OFilePos_t size)
+// Reserve disk space for the file to grow to size bytes.
+// Return true on succes
+{
+	// Not supported.
+	OFILE_UNUSED(fd);
+	OFILE_UNUSED(size);
+	return false;
+}
+
+bool oi_punchHole(Oi_fd &fd,OFilePos_t mark,OFilePos_t length)
+// Release the disk space of length bytes at mark.
+// Return true on succes
+{
+	// Not supported.
+	OFILE_UNUSED(fd);
+	OFILE_UNUSED(mark);
+	OFILE_UNUSED(length);
+	return false;
+}
+
+const char *oi_map(Oi_fd &fd,OFilePos_t length)
+// Map the first length bytes of the file into memory.
+// Return 0 if it could not be mapped.
+{
+	// Not supported.
+	OFILE_UNUSED(fd);
+	OFILE_UNUSED(length);
+	return 0;
+}
+
+void oi_unmap(const char *view,OFilePos_t length)
+// Release a mapping made by oi_map().
+{
+	OFILE_UNUSED(view);
+	OFILE_UNUSED(length);
+}
+
 int oi_fflush(Oi_fd &fd)
 {
 	return 0;
@@ -375,6 +455,11 @@ char *oi_tmpnam(char *nameBuf,unsigned int maxSize)
 //
 #include <string.h>
 #include <errno.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
 
 Oi_fd oi_fopen(const char *fname,long operation)
 {
@@ -432,6 +517,12 @@ bool oi_setLength(Oi_fd &fd,OFilePos_t size)
 // Set the file length
 // Return true on succes
 {
+#if defined(__unix__) || defined(__APPLE__)
+	// Write out anything buffered before the file is cut short.
+	if(fflush(fd))
+		return false;
+	return ftruncate(fileno(fd),size) == 0;
+#else
 	// This cannot be done by stdio.
 	int err = fseek(fd,size+1,SEEK_SET);
 	if(err)
@@ -444,6 +535,67 @@ bool oi_setLength(Oi_fd &fd,OFilePos_t size)
 		return false;
 
 	return true;
+#endif
+}
+
+bool oi_reserve(Oi_fd &fd,OFilePos_t size)
+// Reserve disk space for the file to grow to size bytes, so that the
+// file system can give it in one piece. The file length is not changed.
+// Return true on succes
+{
+#if defined(__linux__)
+	return fallocate(fileno(fd),FALLOC_FL_KEEP_SIZE,0,size) == 0;
+#else
+	OFILE_UNUSED(fd);
+	OFILE_UNUSED(size);
+	return false;
+#endif
+}
+
+bool oi_punchHole(Oi_fd &fd,OFilePos_t mark,OFilePos_t length)
+// Release the disk space of length bytes at mark, so that the file
+// system can use it and an SSD can discard it. They read as zeros.
+// The file length is not changed.
+// Return true on succes
+{
+#if defined(__linux__)
+	// Write out anything buffered first.
+	if(fflush(fd))
+		return false;
+	return fallocate(fileno(fd),FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,mark,length) == 0;
+#else
+	OFILE_UNUSED(fd);
+	OFILE_UNUSED(mark);
+	OFILE_UNUSED(length);
+	return false;
+#endif
+}
+
+const char *oi_map(Oi_fd &fd,OFilePos_t length)
+// Map the first length bytes of the file into memory, read only.
+// Return the address of the mapping or 0 if it could not be mapped.
+{
+#if defined(__unix__) || defined(__APPLE__)
+	if(!length)
+		return 0;
+	void *view = mmap(0,(size_t)length,PROT_READ,MAP_SHARED,fileno(fd),0);
+	return view == MAP_FAILED ? 0 : (const char *)view;
+#else
+	OFILE_UNUSED(fd);
+	OFILE_UNUSED(length);
+	return 0;
+#endif
+}
+
+void oi_unmap(const char *view,OFilePos_t length)
+// Release a mapping made by oi_map().
+{
+#if defined(__unix__) || defined(__APPLE__)
+	munmap((void *)view,(size_t)length);
+#else
+	OFILE_UNUSED(view);
+	OFILE_UNUSED(length);
+#endif
 }
 
 int oi_fflush(Oi_fd &fd)
@@ -708,6 +860,35 @@ bool o_setLength(O_fd &fd,OFilePos_t size)
 	}
 }
 
+bool o_reserve(O_fd &fd,OFilePos_t size)
+{
+	if(!fd.ole)
+		return oi_reserve(fd.fd,size);
+	else
+		return false;
+}
+
+bool o_punchHole(O_fd &fd,OFilePos_t mark,OFilePos_t length)
+{
+	if(!fd.ole)
+		return oi_punchHole(fd.fd,mark,length);
+	else
+		return false;
+}
+
+const char *o_map(O_fd &fd,OFilePos_t length)
+{
+	if(!fd.ole)
+		return oi_map(fd.fd,length);
+	else
+		return 0;
+}
+
+void o_unmap(const char *view,OFilePos_t length)
+{
+	oi_unmap(view,length);
+}
+
 int o_fflush(O_fd &fd)
 {
 	if(!fd.ole)
@@ -88,6 +88,14 @@ long oi_fwrite(const void *ptr,long size,long nobj,Oi_fd &fd);
 
 bool oi_setLength(Oi_fd &fd,OFilePos_t size);
 
+bool oi_reserve(Oi_fd &fd,OFilePos_t size);
+
+bool oi_punchHole(Oi_fd &fd,OFilePos_t mark,OFilePos_t length);
+
+const char *oi_map(Oi_fd &fd,OFilePos_t length);
+
+void oi_unmap(const char *view,OFilePos_t length);
+
 int oi_fflush(Oi_fd &fd);
 
 void oi_lastError(char *messageBuffer,int maxSize);
@@ -139,6 +147,33 @@ inline bool o_setLength(Oi_fd &fd,OFilePos_t size)
 	return oi_setLength(fd,size);
 }
 
+inline bool o_reserve(Oi_fd &fd,OFilePos_t size)
+// Reserve disk space for the file to grow to size bytes.
+// Return true on succes
+{
+	return oi_reserve(fd,size);
+}
+
+inline bool o_punchHole(Oi_fd &fd,OFilePos_t mark,OFilePos_t length)
+// Release the disk space of length bytes at mark. They read as zeros.
+// Return true on succes
+{
+	return oi_punchHole(fd,mark,length);
+}
+
+inline const char *o_map(Oi_fd &fd,OFilePos_t length)
+// Map the first length bytes of the file into memory, read only.
+// Return the address of the mapping or 0 if it could not be mapped.
+{
+	return oi_map(fd,length);
+}
+
+inline void o_unmap(const char *view,OFilePos_t length)
+// Release a mapping made by o_map().
+{
+	oi_unmap(view,length);
+}
+
 inline int o_fflush(Oi_fd &fd)
 {
 	return oi_fflush(fd);
@@ -186,6 +221,14 @@ long o_fwrite(const void *ptr,long size,long nobj,O_fd &fd);
 
 bool o_setLength(O_fd &fd,OFilePos_t size);
 
+bool o_reserve(O_fd &fd,OFilePos_t size);
+
+bool o_punchHole(O_fd &fd,OFilePos_t mark,OFilePos_t length);
+
+const char *o_map(O_fd &fd,OFilePos_t length);
+
+void o_unmap(const char *view,OFilePos_t length);
+
 int o_fflush(O_fd &fd);
 
 void o_lastError(char *messageBuffer,int maxSize);
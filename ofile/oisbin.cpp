@@ -0,0 +1,761 @@
+/*=============================================================================
+MIT License
+
+Copyright(c) 2019 willywood
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+=============================================================================*/
+///////////////////////////////////////////////////////////////////////////
+// OIStreamBinary is a concrete subclass of OIStream. 
+// It is used to read objects in the binary interchange format(see
+// obinfmt.h). The overridden read functions are designed to be called from
+// the constuctors of persistent objects (that are derived from OPersist).
+// A label is checked only if one is provided by the caller and one was
+// written. When the data does not match what is read an OFileErr exception
+// is thrown. Records of an object that its constructor does not read are
+// skipped, so that fields can be added to a class.
+///////////////////////////////////////////////////////////////////////////
+#include "odefs.h"
+#include <stdio.h>
+#include <string.h>
+#include "oisbin.h"
+#include "ofile.h"
+#include "ometa.h"
+#include "ox.h"
+#include "opersist.h"
+
+#ifndef OF_MULTI_THREAD
+// There can never be two readfunctions running simulultaneously,so
+// save space by making all the streams share the same return buffer
+OIStreamBinary::StrBuffT OIStreamBinary::_strBuffer;
+#endif
+
+static const char *invalidData = "Invalid binary interchange data.";
+
+OIStreamBinary::OIStreamBinary(OFile *file, std::istream &in):
+						   OIStreamImport(file),
+						   _in(in),
+						   _pos(0),
+						   _end(0),
+						   _swap(false),
+						   _level(0),
+						   _returnString(0),
+						   _wreturnString(0)
+// Constructor
+// file - OFile into which the objects will be written.
+// in - Stream from which the objects are read.
+{
+}
+
+OIStreamBinary::~OIStreamBinary()
+{
+	delete []_returnString;
+	delete []_wreturnString;
+}
+
+void OIStreamBinary::readObjects(OClassId_t classId,bool deep)
+// Read all the objects of class classId in the document. Also their
+// sub-classes if deep is true(default = true).
+// Exceptions: Throws OFileErr if the data is not valid or ends early. In this
+// case no objects are added to the OFile, unless it is in streaming mode(see
+// OIStreamXML::readObjects()).
+{
+	beginImport(classId,deep);
+
+	OId rootId;
+	try
+	{
+		rootId = readHeader();
+
+		// Read objects untill none is found.
+		OPersist *ob;
+		while((ob = readObject()) != 0)
+			topObjectRead(ob);
+
+	}catch(...){
+		_level = 0;
+		abortImport();
+		throw;
+	}
+
+	endImport(rootId);
+}
+
+OId OIStreamBinary::readHeader(void)
+// Private.
+// Read the start of a document. Return the identity of the root.
+{
+	char magic[4];
+	readData(magic,4);
+	if(memcmp(magic,OBinaryFormat::magic(),4) != 0)
+		throw OFileErr("Not a binary interchange document.");
+
+	if((unsigned char)readByte() > OBinaryFormat::cVersion)
+		throw OFileErr("Unsupported binary interchange version.");
+
+	OSYS_ULONG32 order;
+	readData(&order,4);
+	_swap = (order != OBinaryFormat::cByteOrder);
+	if(_swap)
+	{
+		OUtilityFunction::swap32((char *)&order);
+		if(order != OBinaryFormat::cByteOrder)
+			throw OFileErr(invalidData);
+	}
+
+	OId rootId = (OId)readVarint();
+	// The application name.
+	skip(readLength());
+	return rootId;
+}
+
+OPersist *OIStreamBinary::readObjectOrRef(const char *label,OId *forwardId)
+// Private.
+// Read an object or object reference. 
+// Return value: Pointer to object or 0 if null reference or the end of the
+// document, or if the reference is to an object that has not yet been read.
+// In this case *forwardId is set to its identity, otherwise to 0.
+{
+	*forwardId = 0;
+	OBinaryFormat::Tag tag = readTag(label);
+
+	if(tag == OBinaryFormat::cEnd && !_level)
+	{
+		// End of document
+		return 0;
+	}
+
+	if(tag == OBinaryFormat::cObject)
+	{
+		// Instance
+		OClassId_t classId = (OClassId_t)readVarint();
+		size_t name = (size_t)readVarint();
+		OId id = (OId)readVarint();
+		long version = (long)readVarint();
+		if(name > _table.size())
+			throw OFileErr(invalidData);
+
+		// If the class is not known by its id then try its name.
+		if((classId < 1 || classId > cOMaxClasses || !OMeta::meta(classId)) && name)
+		{
+			OMeta *meta = OMeta::meta(_table[name - 1].c_str());
+			if(meta)
+				classId = meta->id();
+		}
+
+		_level++;
+		OPersist *ob = construct(classId,id,version);
+		_level--;
+		skipToEnd();
+
+		objectRead(id,ob);
+		return ob;
+	}
+
+	if(tag != OBinaryFormat::cRef)
+		throw OFileErr(invalidData);
+
+	OId id = (OId)readVarint();
+	if(!id)
+	{
+		// Null Reference
+		return 0;
+	}
+
+	// Reference
+	OPersist *ob = findObject(id);
+	if(!ob)
+		*forwardId = id;
+	return ob;
+}
+
+OBinaryFormat::Tag OIStreamBinary::readTag(const char *label)
+// Private.
+// Read the start of the next record, after any strings that are defined
+// before it. Return its tag.
+// Exceptions: Throws OFileErr if label is not 0 and the record has another.
+{
+	char tag;
+	while((tag = readByte()) == OBinaryFormat::cDefine)
+	{
+		size_t len = readLength();
+		std::string str(len,' ');
+		if(len)
+			readData(&str[0],len);
+		_table.push_back(str);
+	}
+	if(tag == OBinaryFormat::cEnd)
+		return OBinaryFormat::cEnd;
+	if(tag < OBinaryFormat::cObject || tag > OBinaryFormat::cBlob)
+		throw OFileErr(invalidData);
+
+	size_t index = (size_t)readVarint();
+	if(index > _table.size())
+		throw OFileErr(invalidData);
+
+	// Check for the correct label.
+	if(label && index && strcmp(_table[index - 1].c_str(),label) != 0)
+	{
+		char errorMsg[256];
+		sprintf(errorMsg,"Invalid tag: %.100s, found. Expecting %.100s.",_table[index - 1].c_str(),label);
+		throw OFileErr(errorMsg);
+	}
+	return (OBinaryFormat::Tag)tag;
+}
+
+void OIStreamBinary::expect(OBinaryFormat::Tag tag,const char *label)
+// Private.
+// Read the start of a record of type tag.
+// Exceptions: Throws OFileErr if the next record is of another type.
+{
+	if(readTag(label) != tag)
+	{
+		char errorMsg[256];
+		sprintf(errorMsg,"Unexpected type of data for %.100s.",label ? label : "unnamed_object");
+		throw OFileErr(errorMsg);
+	}
+}
+
+void OIStreamBinary::skipRecord(OBinaryFormat::Tag tag)
+// Private.
+// Skip the rest of a record of type tag.
+{
+	size_t n;
+	switch(tag)
+	{
+	case OBinaryFormat::cObject:
+		readVarint();
+		readVarint();
+		readVarint();
+		readVarint();
+		skipToEnd();
+		break;
+	case OBinaryFormat::cBegin:
+		skipToEnd();
+		break;
+	case OBinaryFormat::cInt:
+	case OBinaryFormat::cWChar:
+	case OBinaryFormat::cRef:
+		readVarint();
+		break;
+	case OBinaryFormat::cChar:
+	case OBinaryFormat::cBool:
+		skip(1);
+		break;
+	case OBinaryFormat::cFloat:
+		skip(4);
+		break;
+	case OBinaryFormat::cDouble:
+		skip(8);
+		break;
+	case OBinaryFormat::cString:
+	case OBinaryFormat::cBytes:
+	case OBinaryFormat::cBits:
+	case OBinaryFormat::cBlob:
+		skip(readLength());
+		break;
+	case OBinaryFormat::cWString:
+	case OBinaryFormat::cIntArray:
+		for(n = readLength(); n; n--)
+			readVarint();
+		break;
+	case OBinaryFormat::cFloatArray:
+		n = readLength();
+		skip(n*4);
+		break;
+	case OBinaryFormat::cDoubleArray:
+		n = readLength();
+		skip(n*8);
+		break;
+	default:
+		throw OFileErr(invalidData);
+	}
+}
+
+void OIStreamBinary::skipToEnd(void)
+// Private.
+// Skip the records up to and including the end of the current object.
+{
+	OBinaryFormat::Tag tag;
+	while((tag = readTag(0)) != OBinaryFormat::cEnd)
+		skipRecord(tag);
+}
+
+OSYS_ULONG64 OIStreamBinary::readVarint(void)
+// Private.
+// Read an unsigned integer written by OOStreamBinary::writeVarint.
+{
+	OSYS_ULONG64 v = 0;
+	unsigned char b;
+	int shift = 0;
+	do
+	{
+		if(shift >= 7*OUtilityFunction::cMaxVarintLength)
+			throw OFileErr(invalidData);
+		b = (unsigned char)readByte();
+		v |= (OSYS_ULONG64)(b & 0x7F) << shift;
+		shift += 7;
+	}while(b & 0x80);
+	return v;
+}
+
+size_t OIStreamBinary::readLength(void)
+// Private.
+// Read the length of a string or an array.
+{
+	OSYS_ULONG64 len = readVarint();
+	if(len != (size_t)len)
+		throw OFileErr(invalidData);
+	return (size_t)len;
+}
+
+void OIStreamBinary::fill(size_t size)
+// Private.
+// Make sure that there are at least size(not more than cBufferSize) bytes
+// in the buffer.
+// Exceptions: Throws OFileErr if the stream ends first.
+{
+	if(_end - _pos >= size)
+		return;
+
+	memmove(_buf,&_buf[_pos],_end - _pos);
+	_end -= _pos;
+	_pos = 0;
+	while(_end < size)
+	{
+		_in.read(&_buf[_end],cBufferSize - _end);
+		size_t got = (size_t)_in.gcount();
+		if(!got)
+			throw OFileErr("Unexpected end of binary data.");
+		_end += got;
+	}
+}
+
+void OIStreamBinary::readData(void *buf,size_t size)
+// Private.
+// Read size bytes. Large data is read straight from the input stream.
+{
+	size_t n = min(size,_end - _pos);
+	memcpy(buf,&_buf[_pos],n);
+	_pos += n;
+	size -= n;
+	if(!size)
+		return;
+
+	if(size >= cBufferSize)
+	{
+		_in.read((char *)buf + n,size);
+		if((size_t)_in.gcount() != size)
+			throw OFileErr("Unexpected end of binary data.");
+		return;
+	}
+	fill(size);
+	memcpy((char *)buf + n,&_buf[_pos],size);
+	_pos += size;
+}
+
+void OIStreamBinary::skip(size_t size)
+// Private.
+// Skip size bytes.
+{
+	while(size)
+	{
+		size_t n = min(size,(size_t)cBufferSize);
+		fill(n);
+		_pos += n;
+		size -= n;
+	}
+}
+
+OSYS_LONG64 OIStreamBinary::readInteger(const char *label)
+// Private.
+// Read an integer of any size.
+// Parameters: label - label describing the element.
+{
+	expect(OBinaryFormat::cInt,label);
+	return OUtilityFunction::unzigzag(readVarint());
+}
+
+double OIStreamBinary::readReal(const char *label)
+// Private.
+// Read a float or a double.
+// Parameters: label - label describing the element.
+{
+	OBinaryFormat::Tag tag = readTag(label);
+	if(tag == OBinaryFormat::cFloat)
+	{
+		float data;
+		readData(&data,4);
+		if(_swap)
+			OUtilityFunction::swap32((char *)&data);
+		return data;
+	}
+	if(tag == OBinaryFormat::cDouble)
+	{
+		double data;
+		readData(&data,8);
+		if(_swap)
+			OUtilityFunction::swap64((char *)&data);
+		return data;
+	}
+
+	char errorMsg[256];
+	sprintf(errorMsg,"Unexpected type of data for %.100s.",label ? label : "unnamed_object");
+	throw OFileErr(errorMsg);
+}
+
+O_LONG OIStreamBinary::readLong(const char *label)
+// Read a long word.
+// Parameters: label - label describing the element.
+{
+	return (O_LONG)readInteger(label);
+}
+
+O_LONG64 OIStreamBinary::readLong64(const char *label)
+// Read a 64 bit long word.
+// Parameters: label - label describing the element.
+{
+	return (O_LONG64)readInteger(label);
+}
+
+O_SHORT OIStreamBinary::readShort(const char *label)
+// Read a two byte word.
+// Parameters: label - label describing the element.
+{
+	return (O_SHORT)readInteger(label);
+}
+
+float OIStreamBinary::readFloat(const char *label)
+// Read a float (4 bytes)
+// Parameters: label - label describing the element.
+{
+	return (float)readReal(label);
+}
+
+double OIStreamBinary::readDouble(const char *label)
+// Read a double (8 bytes)
+// Parameters: label - label describing the element.
+{
+	return readReal(label);
+}
+
+char OIStreamBinary::readChar(const char *label)
+// Read a single byte character.
+// Parameters: label - label describing the element.
+{
+	expect(OBinaryFormat::cChar,label);
+	return readByte();
+}
+
+bool OIStreamBinary::readBool(const char *label)
+// Read a bool.
+// Parameters: label - label describing the element.
+{
+	expect(OBinaryFormat::cBool,label);
+	return readByte() != 0;
+}
+
+O_WCHAR_T OIStreamBinary::readWChar(const char *label)
+// Read a wide character.
+// Parameters: label - label describing the element.
+{
+	expect(OBinaryFormat::cWChar,label);
+	return (O_WCHAR_T)readVarint();
+}
+
+void OIStreamBinary::readCString(char * str,unsigned int maxlen,const char *label)
+// Read a null terminated string.
+// Parameters: str - buffer in which to put string. (Must be long enough)
+//             maxlen - maximum string length. Characters beyond it are skipped.
+//			   label - label describing the element.
+{
+	expect(OBinaryFormat::cString,label);
+	size_t len = readLength();
+	size_t n = min(len,(size_t)maxlen);
+	readData(str,n);
+	skip(len - n);
+	str[n] = 0;
+}
+
+char * OIStreamBinary::readCString256(const char *label)
+// Read a null terminated string. 
+// String is limited to 256 chars including null terminator.
+// Parameters: label - label describing the element.
+{
+	readCString(_strBuffer.str,255,label);
+	return _strBuffer.str;
+}
+
+char *OIStreamBinary::readCString(const char *label)
+// Read a null terminated string.
+// Parameters: label - label describing the element.
+// Return value: char buffer containing string. User must delete it.
+{
+	expect(OBinaryFormat::cString,label);
+	size_t len = readLength();
+	char *ret = new char[len + 1];
+	try
+	{
+		readData(ret,len);
+	}catch(...){
+		delete []ret;
+		throw;
+	}
+	ret[len] = 0;
+	return ret;
+}
+
+char *OIStreamBinary::readCStringD(const char *label)
+// Read a null terminated string.
+// Parameters: label - label describing the element.
+// Return value: char buffer containing string. User must NOT delete it. It
+// is deleted on the next call to this method. i.e. use it immediatly.
+{
+	delete []_returnString;
+	_returnString = 0;
+	_returnString = readCString(label);
+
+	return _returnString;
+}
+
+void OIStreamBinary::readWCString(O_WCHAR_T * str,unsigned int maxlen,const char *label)
+// Read a null terminated wide character string.
+// Parameters: str - buffer in which to put string. (Must be long enough)
+//             maxlen - maximum string length. Characters beyond it are skipped.
+//			   label - label describing the element.
+{
+	expect(OBinaryFormat::cWString,label);
+	size_t len = readLength();
+	for(size_t i = 0; i < len; i++)
+	{
+		O_WCHAR_T c = (O_WCHAR_T)readVarint();
+		if(i < maxlen)
+			str[i] = c;
+	}
+	str[min(len,(size_t)maxlen)] = 0;
+}
+
+O_WCHAR_T * OIStreamBinary::readWCString256(const char *label)
+// Read a null terminated wide character string. 
+// String is limited to 256 chars including null terminator.
+// Parameters: label - label describing the element.
+{
+	readWCString(_strBuffer.wstr,255,label);
+	return _strBuffer.wstr;
+}
+
+O_WCHAR_T *OIStreamBinary::readWCString(const char *label)
+// Read a null terminated wide character string.
+// Parameters: label - label describing the element.
+// Return value: buffer containing string. User must delete it.
+{
+	expect(OBinaryFormat::cWString,label);
+	size_t len = readLength();
+	O_WCHAR_T *ret = new O_WCHAR_T[len + 1];
+	try
+	{
+		for(size_t i = 0; i < len; i++)
+			ret[i] = (O_WCHAR_T)readVarint();
+	}catch(...){
+		delete []ret;
+		throw;
+	}
+	ret[len] = 0;
+	return ret;
+}
+
+O_WCHAR_T *OIStreamBinary::readWCStringD(const char *label)
+// Read a null terminated wide character string.
+// Parameters: label - label describing the element.
+// Return value: buffer containing string. User must NOT delete it. It
+// is deleted on the next call to this method. i.e. use it immediatly.
+{
+	delete []_wreturnString;
+	_wreturnString = 0;
+	_wreturnString = readWCString(label);
+
+	return _wreturnString;
+}
+
+void OIStreamBinary::readBytes(void *buf,int len,const char *label)
+// Read a number of bytes.
+// Parameters: buf - buffer in which to put bytes
+//             len - number of bytes to read.
+//			   label - label describing the element.
+{
+	expect(OBinaryFormat::cBytes,label);
+	size_t n = readLength();
+	if(n > (size_t)len)
+		throw OFileErr("Too many bytes.");
+	readData(buf,n);
+}
+
+void OIStreamBinary::readBits(void *buf,int len,const char *label)
+// Read a number of bits.
+// Parameters: buf - buffer in which to put bytes
+//             len - number of bytes to read.
+//			   label - label describing the element.
+{
+	expect(OBinaryFormat::cBits,label);
+	size_t n = readLength();
+	if(n > (size_t)len)
+		throw OFileErr("Too many bits.");
+	readData(buf,n);
+}
+
+OView OIStreamBinary::readStringView(const char *label)
+// Read a string.
+// Parameters: label - label describing the element.
+// Return value: A view of the string, which is valid until the read
+// constructor returns.
+{
+	expect(OBinaryFormat::cString,label);
+	size_t len = readLength();
+	char *str = new char[len ? len : 1];
+	addView(str);
+	readData(str,len);
+	return OView(str,len);
+}
+
+OView OIStreamBinary::readBytesView(size_t len,const char *label)
+// Read a number of bytes.
+// Parameters: len - number of bytes to read.
+//			   label - label describing the element.
+// Return value: A view of the bytes, which is valid until the read
+// constructor returns.
+{
+	char *buf = new char[len ? len : 1];
+	addView(buf);
+	readBytes(buf,(int)len,label);
+	return OView(buf,len);
+}
+
+size_t OIStreamBinary::readArrayLength(OBinaryFormat::Tag tag,size_t n,const char *label)
+// Private.
+// Read the start of an array of type tag, that should have n values.
+{
+	expect(tag,label);
+	size_t len = readLength();
+	if(len < n)
+		throw OFileErr("Too few values in array.");
+	if(len > n)
+		throw OFileErr("Too many values in array.");
+	return len;
+}
+
+void OIStreamBinary::readShortArray(O_SHORT *buf,size_t n,const char *label)
+// Read an array of two byte words written as one record.
+// Parameters: label - label describing the element.
+{
+	readArrayLength(OBinaryFormat::cIntArray,n,label);
+	for(size_t i = 0; i < n; i++)
+	{
+		buf[i] = (O_SHORT)OUtilityFunction::unzigzag(readVarint());
+	}
+}
+
+void OIStreamBinary::readLongArray(O_LONG *buf,size_t n,const char *label)
+// Read an array of long words written as one record.
+// Parameters: label - label describing the element.
+{
+	readArrayLength(OBinaryFormat::cIntArray,n,label);
+	for(size_t i = 0; i < n; i++)
+	{
+		buf[i] = (O_LONG)OUtilityFunction::unzigzag(readVarint());
+	}
+}
+
+void OIStreamBinary::readLong64Array(O_LONG64 *buf,size_t n,const char *label)
+// Read an array of 64 bit long words written as one record.
+// Parameters: label - label describing the element.
+{
+	readArrayLength(OBinaryFormat::cIntArray,n,label);
+	for(size_t i = 0; i < n; i++)
+	{
+		buf[i] = (O_LONG64)OUtilityFunction::unzigzag(readVarint());
+	}
+}
+
+void OIStreamBinary::readFloatArray(float *buf,size_t n,const char *label)
+// Read an array of floats written as one record.
+// Parameters: label - label describing the element.
+{
+	readArrayLength(OBinaryFormat::cFloatArray,n,label);
+	readData(buf,n*4);
+	if(_swap)
+		OUtilityFunction::swapArray32(buf,buf,n);
+}
+
+void OIStreamBinary::readDoubleArray(double *buf,size_t n,const char *label)
+// Read an array of doubles written as one record.
+// Parameters: label - label describing the element.
+{
+	readArrayLength(OBinaryFormat::cDoubleArray,n,label);
+	readData(buf,n*8);
+	if(_swap)
+		OUtilityFunction::swapArray64(buf,buf,n);
+}
+
+void OIStreamBinary::beginObject(const char *label)
+// Indicate the start of a containing object
+{
+	expect(OBinaryFormat::cBegin,label);
+}
+
+void OIStreamBinary::endObject(void)
+// End of a containing object. Anything in it that was not read is skipped.
+{
+	skipToEnd();
+}
+
+OId OIStreamBinary::readObjectId(const char * /*label*/)
+// Read an object identity.
+{
+	// Should not be called because there is no Ofile to resolve Id's against.
+	oFAssert(0);
+	return 0;
+}
+
+OFile *OIStreamBinary::readBlobHeader(OFilePos_t *mark,oulong *blobLength,
+								oulong *fileLength,const char *label)
+// Read a blob header
+// Return 0 because the blob is not located in an OFile. It is read by the
+// next call to readBlob().
+// Parameters:
+// *mark - return 0 because the file is not attached to a OFile.
+// *blobLength - return 0 because blob has not yet been read. It will be set
+// by the caller to the fileLength that is returned.
+// *fileLength - return the length in bytes of the blob.
+// label - label describing the element.
+{
+	expect(OBinaryFormat::cBlob,label);
+	*mark = 0;
+	*fileLength = (oulong)readLength();
+	*blobLength = 0;
+	// Blob not attached
+	return 0;
+}
+
+void OIStreamBinary::readBlob(void *buf,OFilePos_t /*mark*/,unsigned long size)
+// Read blob data.
+// Parameters: buf - buffer in which to put blob data
+//             size - number of bytes to read.
+{
+	readData(buf,size);
+}
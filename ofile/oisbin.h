@@ -0,0 +1,130 @@
+#ifndef OISBIN_H
+#define OISBIN_H
+/*=============================================================================
+MIT License
+
+Copyright(c) 2019 willywood
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+=============================================================================*/
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "oisimport.h"
+#include "obinfmt.h"
+
+// OIStreamBinary is a concrete subclass of OIStream. It reads objects in the
+// binary interchange format(see obinfmt.h) from a standard input stream and
+// adds them to a file.
+
+class OIStreamBinary: public OIStreamImport {
+
+
+public:
+	enum {cBufferSize = 0x4000}; // Bytes read from the stream at a time.
+
+	OIStreamBinary(OFile *f, std::istream &in);
+	~OIStreamBinary();
+
+
+	void readObjects(OClassId_t classId = cOPersist,bool deep = true);
+
+private:
+	O_LONG readLong(const char *label = 0);
+	O_LONG64 readLong64(const char *label = 0);
+	float readFloat(const char *label = 0);
+	double readDouble(const char *label = 0);
+	O_SHORT readShort(const char *label = 0);
+	char readChar(const char *label = 0);
+	bool readBool(const char *label = 0);
+	void readCString(char * str,unsigned int maxlen,const char *label = 0);
+	char *readCString256(const char *label = 0);
+	char * readCString(const char *label = 0);
+	char * readCStringD(const char *label = 0);
+	// wchar support  can be removed if not used.
+	O_WCHAR_T readWChar(const char *label = 0);
+	void readWCString(O_WCHAR_T * str,unsigned int maxlen,const char *label = 0);
+	O_WCHAR_T *readWCString256(const char *label = 0);
+	O_WCHAR_T * readWCString(const char *label = 0);
+	O_WCHAR_T * readWCStringD(const char *label = 0);
+	//
+	void readBytes(void *buf,int nBytes,const char *label = 0);
+	void readBits(void *buf,int nBytes,const char *label = 0);
+	OView readStringView(const char *label = 0);
+	OView readBytesView(size_t nBytes,const char *label = 0);
+	void readShortArray(O_SHORT *buf,size_t n,const char *label = 0);
+	void readLongArray(O_LONG *buf,size_t n,const char *label = 0);
+	void readLong64Array(O_LONG64 *buf,size_t n,const char *label = 0);
+	void readFloatArray(float *buf,size_t n,const char *label = 0);
+	void readDoubleArray(double *buf,size_t n,const char *label = 0);
+	OId readObjectId(const char *label = 0);
+	void readBlob(void *buf,OFilePos_t mark,unsigned long size);
+	OFile *readBlobHeader(OFilePos_t *mark,oulong *blobLength,
+								oulong *fileLength,const char *label = 0);
+
+	void beginObject(const char *label);
+	void endObject(void);
+
+private:
+	OPersist *readObjectOrRef(const char *label,OId *forwardId);
+	OId readHeader(void);
+	OBinaryFormat::Tag readTag(const char *label);
+	void expect(OBinaryFormat::Tag tag,const char *label);
+	void skipRecord(OBinaryFormat::Tag tag);
+	void skipToEnd(void);
+	size_t readArrayLength(OBinaryFormat::Tag tag,size_t n,const char *label);
+	double readReal(const char *label);
+	OSYS_LONG64 readInteger(const char *label);
+	OSYS_ULONG64 readVarint(void);
+	size_t readLength(void);
+	char readByte(void)
+	{
+		if(_pos == _end)
+			fill(1);
+		return _buf[_pos++];
+	}
+	void readData(void *buf,size_t size);
+	void skip(size_t size);
+	void fill(size_t size);
+
+private:
+	std::istream &_in;			  // Input stream
+	char _buf[cBufferSize];       // Data read from _in
+	size_t _pos;                  // Position of the next byte in _buf
+	size_t _end;                  // End of the data in _buf
+	bool _swap;                   // Reals have the other byte order
+	int _level;                   // Objects being read
+	std::vector<std::string> _table; // Strings by index - 1
+	char *_returnString;
+	O_WCHAR_T *_wreturnString;
+#ifndef OF_MULTI_THREAD
+	// There can never be two readfunctions running simulultaneously,so
+	// save space by making all the streams share the same return buffer
+	static 
+#endif
+	union StrBuffT			  // Return buffer for reading strings
+	{
+		O_WCHAR_T wstr[256];
+		char str[256];
+	}_strBuffer;      
+
+};
+
+#endif  // OISBIN_H
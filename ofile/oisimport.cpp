@@ -0,0 +1,331 @@
+/*=============================================================================
+MIT License
+
+Copyright(c) 2019 willywood
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+=============================================================================*/
+///////////////////////////////////////////////////////////////////////////
+// OIStreamImport is the part of the streams that import objects from an
+// interchange format, that does not depend on the format. The derived
+// stream reads the objects in readObjects() and the references to them in
+// readObjectOrRef().
+///////////////////////////////////////////////////////////////////////////
+#include "odefs.h"
+#include <stdio.h>
+#include "oisimport.h"
+#include "ofile.h"
+#include "ometa.h"
+#include "ox.h"
+#include "opersist.h"
+
+OIStreamImport::OIStreamImport(OFile *file):
+						   _file(file),
+						   _classId(cOPersist),
+						   _deep(true),
+						   _streaming(false),
+						   _owner(0),
+						   _top(0),
+						   _topPinned(false),
+						   _currentOId(0),
+						   _userVersion(0),
+						   _uniqueId(0)
+// Constructor
+// file - OFile into which the objects will be written.
+{
+}
+
+OIStreamImport::~OIStreamImport()
+{
+	deleteViews(0);
+}
+
+void OIStreamImport::beginImport(OClassId_t classId,bool deep)
+// Start importing the objects of class classId. Also their sub-classes if
+// deep is true.
+{
+	oFAssert(_file);
+
+	_classId = classId;
+	_deep = deep;
+}
+
+void OIStreamImport::abortImport(void)
+// Called when readObjects() fails. Delete all objects that were read so far.
+{
+	for(ObjectList::const_iterator it = _readObjects.begin(); it != _readObjects.end();++it)
+	{
+		delete (*it).second;
+	}
+	// Clear list.
+	_readObjects.erase(_readObjects.begin(),_readObjects.end());
+	_forwardRefs.clear();
+	_waiting.clear();
+	_top = _owner = 0;
+}
+
+void OIStreamImport::endImport(OId rootId)
+// Called when readObjects() has read all the objects. Attach them to the
+// file and set the root to the object with identity rootId, if it was read.
+{
+	// References to objects that were never read stay 0.
+	_forwardRefs.clear();
+	for(WaitingList::const_iterator wit = _waiting.begin(); wit != _waiting.end();++wit)
+	{
+		if(!(*wit).second)
+			(*wit).first->oSetPurgeable(true,_file);
+	}
+	_waiting.clear();
+
+		// Attach objects to file
+	for(ObjectList::const_iterator it = _readObjects.begin(); it != _readObjects.end();++it)
+	{
+		// If deep then check if the class is in the hierarchy otherwise check
+		// for an exact match.
+		if (wanted((*it).second))
+		{
+			_file->attach((*it).second, false);
+		}
+		else
+		{
+			delete (*it).second;
+		}
+	}
+
+	// Find and set the root if there is one.
+	ObjectList::iterator oret = _readObjects.find(rootId);
+	IdList::iterator iret = _fileIds.find(rootId);
+	if (_readObjects.end() != oret && wanted((*oret).second))
+	{
+		_file->setRoot((*oret).second);
+	}
+	else if(_fileIds.end() != iret)
+	{
+		OPersist *root = _file->getObject((*iret).second);
+		_file->setRoot(root);
+		root->oSetPurgeable(false,_file);
+	}
+	_fileIds.clear();
+}
+
+bool OIStreamImport::wanted(const OPersist *ob)const
+// Private.
+// Return true if ob is of a class that readObjects() attaches to the file.
+{
+	return (_deep && ob->meta()->isA(_classId)) || (!_deep && ob->meta()->id() == _classId);
+}
+
+OPersist *OIStreamImport::findObject(OId id)
+// Return the object that was read with the identity id, or 0 if it has not
+// yet been read.
+{
+	ObjectList::iterator ret = _readObjects.find(id);
+	if(_readObjects.end() != ret)
+		return (*ret).second;
+
+	IdList::iterator fret = _fileIds.find(id);
+	if(_fileIds.end() != fret)
+		return _file->getObject((*fret).second);
+
+	return 0;
+}
+
+bool OIStreamImport::isWaiting(const OPersist *top)const
+// Private.
+// Return true if there is an unresolved forward reference in top.
+{
+	for(ForwardRefList::const_iterator it = _forwardRefs.begin(); it != _forwardRefs.end();++it)
+	{
+		if((*it).second._top == top)
+			return true;
+	}
+	return false;
+}
+
+OPersist *OIStreamImport::construct(OClassId_t classId,OId id,long version)
+// Construct an object of class classId with the identity id in the document,
+// from the stream.
+// Exceptions: Throws OFileErr if the class is not known.
+{
+	OMeta *meta = (classId > 0 && classId <= cOMaxClasses) ? OMeta::meta(classId) : 0;
+	if(!meta)
+	{
+		char errorMsg[256];
+		sprintf(errorMsg,"Unknown class %d.",(int)classId);
+		throw OFileErr(errorMsg);
+	}
+
+	_currentOId = id;
+	_userVersion = version;
+	size_t views = _views.size();
+	OPersist *saveOwner = _owner;
+	OPersist *ob;
+	try
+	{
+		ob =  meta->construct(*this);
+	}catch(...){
+		deleteViews(views);
+		_owner = saveOwner;
+		// Abort reading of this object.
+		_readObjects.erase(id);
+		// clean the index, because the object was not constructed.
+		throw;
+	}
+	_owner = saveOwner;
+	// Views are only valid during the read constructor.
+	deleteViews(views);
+	return ob;
+}
+
+void OIStreamImport::objectRead(OId id,OPersist *ob)
+// Called when the object ob with identity id has been read. Resolves forward
+// references to it and, in streaming mode, attaches it to the file.
+{
+	std::pair<ForwardRefList::iterator,ForwardRefList::iterator> refs = _forwardRefs.equal_range(id);
+	if(refs.first != refs.second)
+	{
+		// The references keep a pointer to ob, so it may not be purged.
+		_topPinned = true;
+
+		std::vector<OPersist *> tops;
+		for(ForwardRefList::iterator it = refs.first; it != refs.second;++it)
+		{
+			*(*it).second._obp = ob;
+			// The owner may already have been written without the reference.
+			(*it).second._owner->oSetDirty();
+			if((*it).second._top != _top)
+				tops.push_back((*it).second._top);
+		}
+		_forwardRefs.erase(refs.first,refs.second);
+
+		// Release outermost objects that no longer wait for a reference.
+		for(size_t i = 0; i < tops.size(); i++)
+		{
+			WaitingList::iterator wit = _waiting.find(tops[i]);
+			if(_waiting.end() != wit && !isWaiting(tops[i]))
+			{
+				if(!(*wit).second)
+					tops[i]->oSetPurgeable(true,_file);
+				_waiting.erase(wit);
+			}
+		}
+	}
+
+	if(_streaming && wanted(ob))
+	{
+		_file->attach(ob,false);
+		_readObjects.erase(id);
+		_fileIds.insert(IdList::value_type(id,ob->oId()));
+	}
+}
+
+void OIStreamImport::topObjectRead(OPersist *ob)
+// Called when an outermost object has been read, or referenced. In streaming
+// mode make it purgeable unless it is still needed.
+{
+	if(_streaming)
+	{
+		if(ob == _top)
+		{
+			if(isWaiting(ob))
+				_waiting.insert(WaitingList::value_type(ob,_topPinned));
+			else if(!_topPinned && ob->oAttached())
+				ob->oSetPurgeable(true,_file);
+		}
+		else if(ob->oAttached())
+		{
+			// Balance the getObject() of a reference.
+			ob->oSetPurgeable(false,_file);
+		}
+	}
+	_top = 0;
+	_topPinned = false;
+}
+
+// Return the version of this file.
+long OIStreamImport::userVersion(void)const
+{
+	return _userVersion;
+}
+
+// Return the version of the source code.
+long OIStreamImport::userSourceVersion(void)const
+{
+	return _file->userSourceVersion();
+}
+
+void OIStreamImport::setCurrentObject(OPersist *ob)
+// Set the currently being read object to ob. This allows any references
+// to the object to be resolved even though it is still being read.
+// Called before any of the object is read.
+{
+	// If there is no object if then invent one;
+	if(!_currentOId)
+	{
+		while(_readObjects.count(++_uniqueId) || _fileIds.count(_uniqueId));
+
+		_currentOId = _uniqueId;
+	}	
+	_readObjects.insert(ObjectList::value_type(_currentOId,ob));
+	_owner = ob;
+	if(!_top)
+		_top = ob;
+}
+
+void OIStreamImport::readObject(OPersist **obp,const char *label)
+// Read an object deferred until finish()
+// Parameter: Address of a pointer in which to place the reference to the
+//            object. Reference is only written when finish() is called.
+// A reference to an object that has not yet been read is set when the
+// object is read.
+{
+	OId forwardId;
+	*obp = readObjectOrRef(label,&forwardId);
+	if(forwardId)
+	{
+		ForwardRef ref = {obp,_owner,_top};
+		_forwardRefs.insert(ForwardRefList::value_type(forwardId,ref));
+	}
+}
+
+OPersist *OIStreamImport::readObject(const char *label)
+// Read an object or object reference. 
+// Return value: Pointer to object or 0 if null reference.
+// Exceptions: Throws OFileErr if the reference is to an object that has not
+// yet been read.
+{
+	OId forwardId;
+	OPersist *ob = readObjectOrRef(label,&forwardId);
+	if(forwardId)
+	{
+		char errorMsg[256];
+		sprintf(errorMsg,"Reference to id%ld, which has not been read.",(long)forwardId);
+		throw OFileErr(errorMsg);
+	}
+	return ob;
+}
+
+void OIStreamImport::deleteViews(size_t from)
+// Private.
+// Delete the data of the views read since there were from views.
+{
+	for(size_t i = from; i < _views.size(); i++)
+		delete []_views[i];
+	_views.resize(from);
+}
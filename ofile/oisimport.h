@@ -0,0 +1,128 @@
+#ifndef OISIMPORT_H
+#define OISIMPORT_H
+/*=============================================================================
+MIT License
+
+Copyright(c) 2019 willywood
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+=============================================================================*/
+
+#include <map>
+#include <vector>
+#include "oistrm.h"
+
+// OIStreamImport is an abstract subclass of OIStream for streams that import
+// objects from an interchange format (see OIStreamXML and OIStreamBinary).
+// It keeps the objects that have been read by their identity in the
+// document, resolves references to them, and attaches them to the file.
+
+#ifdef OFILE_STD_IN_NAMESPACE
+using std::map;
+using std::multimap;
+using std::less;
+#endif
+
+class OIStreamImport: public OIStream {
+
+
+typedef map<OId,OPersist *,less<OId > > ObjectList;
+typedef map<OId,OId,less<OId > > IdList;
+// A reference to an object that has not yet been read. It is resolved when
+// the object is read.
+struct ForwardRef
+{
+	OPersist **_obp;	// Where to put the reference.
+	OPersist *_owner;	// Object containing the reference.
+	OPersist *_top;		// Outermost object containing the reference.
+};
+typedef multimap<OId,ForwardRef,less<OId > > ForwardRefList;
+typedef map<OPersist *,bool,less<OPersist *> > WaitingList;
+
+
+public:
+	OIStreamImport(OFile *f);
+	~OIStreamImport();
+
+	// In streaming mode readObjects() attaches objects to the file as soon as
+	// they are read, so that they can be purged and committed in batches
+	// (see OFile::setObjectThreshold() and OFile::setAutoCommit()).
+	void setStreaming(bool streaming = true){_streaming = streaming;}
+	bool isStreaming(void)const{return _streaming;}
+
+protected:
+	void readObject(OPersist **obp,const char *label = 0);
+	OPersist *readObject(const char *label = 0);
+
+	// Return the version of this file.
+	long userVersion(void)const;
+	// Return the version of the source code.
+	long userSourceVersion(void)const;
+
+	void setCurrentObject(OPersist *p);
+
+	// This stream does not read directly into a file.
+	OFile *file(void)const{return 0;}
+
+	// Read an object or a reference to one. Return 0 for a null reference or
+	// the end of the objects, or if the reference is to an object that has not
+	// yet been read. In that case set *forwardId to its identity, otherwise to 0.
+	virtual OPersist *readObjectOrRef(const char *label,OId *forwardId) = 0;
+
+	// Used by readObjects() of the derived stream.
+	void beginImport(OClassId_t classId,bool deep);
+	void abortImport(void);
+	void endImport(OId rootId);
+	void topObjectRead(OPersist *ob);
+	// Used by readObjectOrRef().
+	OPersist *construct(OClassId_t classId,OId id,long version);
+	void objectRead(OId id,OPersist *ob);
+	OPersist *findObject(OId id);
+	// Keep the data of a view, allocated with new[], until the object that
+	// read it has been constructed.
+	void addView(char *data){_views.push_back(data);}
+
+protected:
+	OFile *_file;			 // File to which objects are added.
+
+private:
+	void deleteViews(size_t from);
+	bool wanted(const OPersist *ob)const;
+	bool isWaiting(const OPersist *top)const;
+
+private:
+	ObjectList _readObjects;  // List of objects that have been read.
+	IdList _fileIds;          // Identities in the file of objects attached while streaming.
+	ForwardRefList _forwardRefs; // References waiting for an object to be read.
+	WaitingList _waiting;     // Outermost objects with unresolved forward references,
+	                          // and whether they must stay in memory.
+	OClassId_t _classId;      // Class of objects to attach.
+	bool _deep;               // Also attach sub-classes of _classId.
+	bool _streaming;          // Attach objects as soon as they are read.
+	OPersist *_owner;         // Innermost object being read.
+	OPersist *_top;           // Outermost object being read.
+	bool _topPinned;          // _top has been the target of a forward reference.
+	OId _currentOId;
+	long _userVersion;        // The version of the currently read object.
+	OId _uniqueId;			  // Used to generate OId's for objects that do not have them.
+	std::vector<char *> _views; // Data of views. Deleted when the object that
+	                            // read them is constructed.
+};
+
+#endif  // OISIMPORT_H
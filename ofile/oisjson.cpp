@@ -0,0 +1,1036 @@
+/*=============================================================================
+MIT License
+
+Copyright(c) 2019 willywood
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+=============================================================================*/
+///////////////////////////////////////////////////////////////////////////
+// OIStreamJSON is a concrete subclass of OIStream. 
+// It is used to read objects written as JSON Lines by OOStreamJSON(see
+// oosjson.h). The overridden read functions are designed to be called from
+// the constuctors of persistent objects (that are derived from OPersist).
+// The text is scanned directly from a buffer. The scanner accepts the JSON
+// that OOStreamJSON writes and is lenient about the rest: it does not
+// validate what it skips. A label is checked only if one is provided by the
+// caller. When the data does not match what is read an OFileErr exception is
+// thrown. Fields of an object that its constructor does not read are skipped,
+// so that fields can be added to a class, and the document may have been
+// written by other tools as long as each object is on a line of its own.
+///////////////////////////////////////////////////////////////////////////
+#include "odefs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <locale.h>
+#include <limits>
+#include "oisjson.h"
+#include "ofile.h"
+#include "ometa.h"
+#include "ox.h"
+#include "opersist.h"
+
+#ifndef OF_MULTI_THREAD
+// There can never be two readfunctions running simulultaneously,so
+// save space by making all the streams share the same return buffer
+OIStreamJSON::StrBuffT OIStreamJSON::_strBuffer;
+#endif
+
+static const char *invalidData = "Invalid JSON data.";
+
+static void appendUTF8(std::string &str,OSYS_ULONG32 c)
+// Append the character c to str in UTF-8.
+{
+	if(c < 0x80)
+	{
+		str += (char)c;
+	}
+	else if(c < 0x800)
+	{
+		str += (char)(0xC0 | (c >> 6));
+		str += (char)(0x80 | (c & 0x3F));
+	}
+	else if(c < 0x10000)
+	{
+		str += (char)(0xE0 | (c >> 12));
+		str += (char)(0x80 | ((c >> 6) & 0x3F));
+		str += (char)(0x80 | (c & 0x3F));
+	}
+	else
+	{
+		str += (char)(0xF0 | (c >> 18));
+		str += (char)(0x80 | ((c >> 12) & 0x3F));
+		str += (char)(0x80 | ((c >> 6) & 0x3F));
+		str += (char)(0x80 | (c & 0x3F));
+	}
+}
+
+static OSYS_ULONG32 decodeUTF8(const std::string &str,size_t &i)
+// Return the character at position i of the UTF-8 string str, and move i to
+// the next one. A byte that does not start a valid sequence is returned as
+// it is.
+{
+	unsigned char b = (unsigned char)str[i++];
+	int n;
+	if((b & 0xE0) == 0xC0)
+		n = 1;
+	else if((b & 0xF0) == 0xE0)
+		n = 2;
+	else if((b & 0xF8) == 0xF0)
+		n = 3;
+	else
+		return b;
+
+	if(i + n > str.size())
+		return b;
+	OSYS_ULONG32 c = b & (0x3F >> n);
+	for(int j = 0; j < n; j++)
+	{
+		unsigned char cb = (unsigned char)str[i + j];
+		if((cb & 0xC0) != 0x80)
+			return b;
+		c = (c << 6) | (cb & 0x3F);
+	}
+	i += n;
+	return c;
+}
+
+static double toDouble(char *buf)
+// Return the number in buf, which has a '.' for its decimal point, whatever
+// the locale of the C library.
+{
+	char point = *localeconv()->decimal_point;
+	if(point != '.')
+	{
+		char *p = strchr(buf,'.');
+		if(p)
+			*p = point;
+	}
+	return strtod(buf,0);
+}
+
+static int hexValue(char c)
+// Return the value of a hex digit, or -1 if c is not one.
+{
+	if(c >= '0' && c <= '9')
+		return c - '0';
+	if(c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if(c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+OIStreamJSON::OIStreamJSON(OFile *file, std::istream &in):
+						   OIStreamImport(file),
+						   _in(in),
+						   _pos(0),
+						   _end(0),
+						   _level(0),
+						   _returnString(0),
+						   _wreturnString(0)
+// Constructor
+// file - OFile into which the objects will be written.
+// in - Stream from which the objects are read.
+{
+}
+
+OIStreamJSON::~OIStreamJSON()
+{
+	delete []_returnString;
+	delete []_wreturnString;
+}
+
+void OIStreamJSON::readObjects(OClassId_t classId,bool deep)
+// Read all the objects of class classId in the document. Also their
+// sub-classes if deep is true(default = true).
+// Exceptions: Throws OFileErr if the data is not valid or ends early. In this
+// case no objects are added to the OFile, unless it is in streaming mode(see
+// OIStreamXML::readObjects()).
+{
+	beginImport(classId,deep);
+
+	OId rootId;
+	try
+	{
+		rootId = readHeader();
+
+		// Read objects untill none is found.
+		OPersist *ob;
+		while((ob = readObject()) != 0)
+			topObjectRead(ob);
+
+	}catch(...){
+		_level = 0;
+		abortImport();
+		throw;
+	}
+
+	endImport(rootId);
+}
+
+OId OIStreamJSON::readHeader(void)
+// Private.
+// Read the line that describes the document. Return the identity of the root.
+{
+	skipSpace();
+	if(next() != '{')
+		throw OFileErr("Not a JSON Lines document.");
+
+	bool document = false;
+	OId rootId = 0;
+	while(nextKey())
+	{
+		if(_key == "document")
+		{
+			document = true;
+			skipValue();
+		}
+		else if(_key == "root")
+			rootId = (OId)readInteger("root");
+		else
+			skipValue();
+	}
+	_pos++;
+	if(!document)
+		throw OFileErr("Not a JSON Lines document.");
+	return rootId;
+}
+
+OPersist *OIStreamJSON::readObjectOrRef(const char *label,OId *forwardId)
+// Private.
+// Read an object or object reference. An object is read from the next line
+// when no object is being read, and a reference otherwise.
+// Return value: Pointer to object or 0 if null reference or the end of the
+// document, or if the reference is to an object that has not yet been read.
+// In this case *forwardId is set to its identity, otherwise to 0.
+{
+	*forwardId = 0;
+
+	if(!_level)
+	{
+		skipSpace();
+		if(_pos == _end && !fill())
+		{
+			// End of document
+			return 0;
+		}
+		if(next() != '{')
+			throw OFileErr(invalidData);
+
+		// Instance
+		OClassId_t classId = 0;
+		OId id = 0;
+		long version = 0;
+		std::string className;
+		bool data = false;
+		while(!data && nextKey())
+		{
+			if(_key == "data")
+				data = true;
+			else if(_key == "type")
+				classId = (OClassId_t)readInteger("type");
+			else if(_key == "class")
+				readString(className,"class");
+			else if(_key == "id")
+				id = (OId)readInteger("id");
+			else if(_key == "ver")
+				version = (long)readInteger("ver");
+			else
+				skipValue();
+		}
+		if(!data || next() != '{')
+			throw OFileErr(invalidData);
+
+		// If the class is not known by its id then try its name.
+		if((classId < 1 || classId > cOMaxClasses || !OMeta::meta(classId)) && !className.empty())
+		{
+			OMeta *meta = OMeta::meta(className.c_str());
+			if(meta)
+				classId = meta->id();
+		}
+
+		_level++;
+		OPersist *ob = construct(classId,id,version);
+		_level--;
+		// The rest of the data and of the line.
+		skipFields();
+		skipFields();
+
+		objectRead(id,ob);
+		return ob;
+	}
+
+	readField(label);
+	if(peek() != '{')
+	{
+		char word[8];
+		readWord(word,sizeof(word),label);
+		if(strcmp(word,"null") != 0)
+			typeError(label);
+
+		// Null Reference
+		return 0;
+	}
+
+	_pos++;
+	if(!nextKey() || _key != "ref")
+		throw OFileErr(invalidData);
+	OId id = (OId)readInteger(label);
+	skipFields();
+	if(!id)
+	{
+		// Null Reference
+		return 0;
+	}
+
+	// Reference
+	OPersist *ob = findObject(id);
+	if(!ob)
+		*forwardId = id;
+	return ob;
+}
+
+bool OIStreamJSON::fill(void)
+// Private.
+// Read more text into the empty buffer. Return false at the end of the stream.
+{
+	_in.read(_buf,cBufferSize);
+	_pos = 0;
+	_end = (size_t)_in.gcount();
+	return _end != 0;
+}
+
+bool OIStreamJSON::nextKey(void)
+// Private.
+// Read the name of the next field of the current object into _key, and the
+// colon that follows it. Return false if there are no more fields, leaving
+// the closing brace to be read.
+{
+	skipSpace();
+	char c = peek();
+	if(c == ',')
+	{
+		_pos++;
+		skipSpace();
+		c = peek();
+	}
+	if(c == '}')
+		return false;
+
+	if(c != '"')
+		throw OFileErr(invalidData);
+	readString(_key,0);
+	skipSpace();
+	if(next() != ':')
+		throw OFileErr(invalidData);
+	skipSpace();
+	return true;
+}
+
+void OIStreamJSON::readField(const char *label)
+// Private.
+// Read up to the value of the next field.
+// Exceptions: Throws OFileErr if there is no next field or if label is not 0
+// and the field has another name.
+{
+	if(!nextKey())
+	{
+		char errorMsg[256];
+		sprintf(errorMsg,"Missing field %.100s.",label ? label : "unnamed_object");
+		throw OFileErr(errorMsg);
+	}
+
+	// Check for the correct label.
+	if(label && _key != label)
+	{
+		char errorMsg[256];
+		sprintf(errorMsg,"Invalid tag: %.100s, found. Expecting %.100s.",_key.c_str(),label);
+		throw OFileErr(errorMsg);
+	}
+}
+
+void OIStreamJSON::skipValue(void)
+// Private.
+// Skip a value of any type.
+{
+	skipSpace();
+	char c = peek();
+	if(c == '{')
+	{
+		_pos++;
+		skipFields();
+	}
+	else if(c == '[')
+	{
+		_pos++;
+		for(;;)
+		{
+			skipSpace();
+			c = peek();
+			if(c == ']')
+			{
+				_pos++;
+				break;
+			}
+			if(c == ',')
+				_pos++;
+			else
+				skipValue();
+		}
+	}
+	else if(c == '"')
+	{
+		readString(_str,0);
+	}
+	else
+	{
+		// A number or a literal.
+		size_t n = 0;
+		while((_pos != _end || fill()) && !strchr(",}] \t\r\n",_buf[_pos]))
+		{
+			_pos++;
+			n++;
+		}
+		if(!n)
+			throw OFileErr(invalidData);
+	}
+}
+
+void OIStreamJSON::skipFields(void)
+// Private.
+// Skip the fields up to and including the end of the current object.
+{
+	while(nextKey())
+		skipValue();
+	_pos++;
+}
+
+void OIStreamJSON::typeError(const char *label)
+// Private.
+// Throw an exception for a value of the wrong type.
+{
+	char errorMsg[256];
+	sprintf(errorMsg,"Unexpected type of data for %.100s.",label ? label : "unnamed_object");
+	throw OFileErr(errorMsg);
+}
+
+size_t OIStreamJSON::readNumber(char *buf,size_t size,const char *label)
+// Private.
+// Read the characters of a number into buf and return how many there are.
+{
+	skipSpace();
+	size_t n = 0;
+	while(_pos != _end || fill())
+	{
+		char c = _buf[_pos];
+		if(!((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E'))
+			break;
+		if(n == size - 1)
+			throw OFileErr(invalidData);
+		buf[n++] = c;
+		_pos++;
+	}
+	if(!n)
+		typeError(label);
+	buf[n] = 0;
+	return n;
+}
+
+void OIStreamJSON::readWord(char *buf,size_t size,const char *label)
+// Private.
+// Read a literal such as true, false or null into buf.
+{
+	skipSpace();
+	size_t n = 0;
+	while((_pos != _end || fill()) && _buf[_pos] >= 'a' && _buf[_pos] <= 'z')
+	{
+		if(n == size - 1)
+			typeError(label);
+		buf[n++] = _buf[_pos++];
+	}
+	buf[n] = 0;
+}
+
+OSYS_LONG64 OIStreamJSON::readInteger(const char *label)
+// Private.
+// Read an integer of any size.
+// Parameters: label - label describing the element.
+{
+	char buf[64];
+	readNumber(buf,sizeof(buf),label);
+
+	const char *p = buf;
+	bool negative = (*p == '-');
+	if(negative)
+		p++;
+	OSYS_ULONG64 v = 0;
+	while(*p >= '0' && *p <= '9')
+		v = v*10 + (*p++ - '0');
+	if(*p)
+	{
+		// Written as a real by some other tool.
+		return (OSYS_LONG64)toDouble(buf);
+	}
+	return negative ? (OSYS_LONG64)((OSYS_ULONG64)0 - v) : (OSYS_LONG64)v;
+}
+
+double OIStreamJSON::readReal(const char *label)
+// Private.
+// Read a float or a double.
+// Parameters: label - label describing the element.
+{
+	skipSpace();
+	if(peek() == '"')
+	{
+		// Not a number
+		readString(_str,label);
+		if(_str == "NaN")
+			return std::numeric_limits<double>::quiet_NaN();
+		if(_str == "Infinity")
+			return HUGE_VAL;
+		if(_str == "-Infinity")
+			return -HUGE_VAL;
+		typeError(label);
+	}
+
+	char buf[64];
+	readNumber(buf,sizeof(buf),label);
+	return toDouble(buf);
+}
+
+void OIStreamJSON::readString(std::string &str,const char *label)
+// Private.
+// Read a quoted string into str as UTF-8. A lone low surrogate \udc80 to
+// \udcff is read as the byte that OOStreamJSON escaped with it.
+// Parameters: label - label describing the element.
+{
+	skipSpace();
+	if(peek() != '"')
+		typeError(label);
+	_pos++;
+
+	str.erase();
+	for(;;)
+	{
+		if(_pos == _end && !fill())
+			throw OFileErr("Unexpected end of JSON data.");
+
+		// Take a run of characters that are not escaped in one go.
+		const char *p = &_buf[_pos];
+		const char *end = &_buf[_end];
+		const char *q = p;
+		while(q != end && *q != '"' && *q != '\\')
+			q++;
+		str.append(p,q - p);
+		_pos += q - p;
+		if(q == end)
+			continue;
+
+		_pos++;
+		if(*q == '"')
+			break;
+
+		OSYS_ULONG32 c = readEscape();
+		if(c >= 0xD800 && c < 0xDC00 && peek() == '\\')
+		{
+			// A surrogate pair
+			_pos++;
+			OSYS_ULONG32 low = readEscape();
+			if(low >= 0xDC00 && low < 0xE000)
+			{
+				c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+			}
+			else
+			{
+				appendUTF8(str,c);
+				c = low;
+			}
+		}
+		if(c >= 0xDC80 && c <= 0xDCFF)
+			str += (char)(c & 0xFF);
+		else
+			appendUTF8(str,c);
+	}
+}
+
+OSYS_ULONG32 OIStreamJSON::readEscape(void)
+// Private.
+// Read the character of an escape sequence after the backslash.
+{
+	char c = next();
+	switch(c)
+	{
+	case '"':
+	case '\\':
+	case '/':
+		return c;
+	case 'b': return '\b';
+	case 'f': return '\f';
+	case 'n': return '\n';
+	case 'r': return '\r';
+	case 't': return '\t';
+	case 'u':
+		{
+			OSYS_ULONG32 u = 0;
+			for(int i = 0; i < 4; i++)
+			{
+				int h = hexValue(next());
+				if(h < 0)
+					throw OFileErr(invalidData);
+				u = (u << 4) | h;
+			}
+			return u;
+		}
+	}
+	throw OFileErr(invalidData);
+}
+
+void OIStreamJSON::readWString(const char *label)
+// Private.
+// Read a quoted string into _wstr. Characters beyond 0xFFFF are split into
+// surrogate pairs if O_WCHAR_T has two bytes.
+// Parameters: label - label describing the element.
+{
+	readString(_str,label);
+	_wstr.clear();
+	size_t i = 0;
+	while(i < _str.size())
+	{
+		OSYS_ULONG32 c = decodeUTF8(_str,i);
+		if(c > 0xFFFF && sizeof(O_WCHAR_T) < 4)
+		{
+			c -= 0x10000;
+			_wstr.push_back((O_WCHAR_T)(0xD800 + (c >> 10)));
+			_wstr.push_back((O_WCHAR_T)(0xDC00 + (c & 0x3FF)));
+		}
+		else
+		{
+			_wstr.push_back((O_WCHAR_T)c);
+		}
+	}
+}
+
+size_t OIStreamJSON::readHex(const char *label)
+// Private.
+// Read a string of hex digits into _str as bytes. Return the number of bytes.
+// Parameters: label - label describing the element.
+{
+	readString(_str,label);
+	size_t n = _str.size() / 2;
+	if(_str.size() % 2)
+		throw OFileErr(invalidData);
+	for(size_t i = 0; i < n; i++)
+	{
+		int hi = hexValue(_str[2*i]);
+		int lo = hexValue(_str[2*i + 1]);
+		if(hi < 0 || lo < 0)
+			throw OFileErr(invalidData);
+		_str[i] = (char)((hi << 4) | lo);
+	}
+	_str.resize(n);
+	return n;
+}
+
+O_LONG OIStreamJSON::readLong(const char *label)
+// Read a long word.
+// Parameters: label - label describing the element.
+{
+	readField(label);
+	return (O_LONG)readInteger(label);
+}
+
+O_LONG64 OIStreamJSON::readLong64(const char *label)
+// Read a 64 bit long word.
+// Parameters: label - label describing the element.
+{
+	readField(label);
+	return (O_LONG64)readInteger(label);
+}
+
+O_SHORT OIStreamJSON::readShort(const char *label)
+// Read a two byte word.
+// Parameters: label - label describing the element.
+{
+	readField(label);
+	return (O_SHORT)readInteger(label);
+}
+
+float OIStreamJSON::readFloat(const char *label)
+// Read a float (4 bytes)
+// Parameters: label - label describing the element.
+{
+	readField(label);
+	return (float)readReal(label);
+}
+
+double OIStreamJSON::readDouble(const char *label)
+// Read a double (8 bytes)
+// Parameters: label - label describing the element.
+{
+	readField(label);
+	return readReal(label);
+}
+
+char OIStreamJSON::readChar(const char *label)
+// Read a single byte character, written as a string of one character.
+// Parameters: label - label describing the element.
+{
+	readField(label);
+	readString(_str,label);
+	size_t i = 0;
+	return _str.empty() ? 0 : (char)decodeUTF8(_str,i);
+}
+
+bool OIStreamJSON::readBool(const char *label)
+// Read a bool.
+// Parameters: label - label describing the element.
+{
+	readField(label);
+	char word[8];
+	readWord(word,sizeof(word),label);
+	if(strcmp(word,"true") == 0)
+		return true;
+	if(strcmp(word,"false") != 0)
+		typeError(label);
+	return false;
+}
+
+O_WCHAR_T OIStreamJSON::readWChar(const char *label)
+// Read a wide character.
+// Parameters: label - label describing the element.
+{
+	readField(label);
+	return (O_WCHAR_T)readInteger(label);
+}
+
+void OIStreamJSON::readCString(char * str,unsigned int maxlen,const char *label)
+// Read a null terminated string.
+// Parameters: str - buffer in which to put string. (Must be long enough)
+//             maxlen - maximum string length. Characters beyond it are skipped.
+//			   label - label describing the element.
+{
+	readField(label);
+	readString(_str,label);
+	size_t n = min(_str.size(),(size_t)maxlen);
+	memcpy(str,_str.data(),n);
+	str[n] = 0;
+}
+
+char * OIStreamJSON::readCString256(const char *label)
+// Read a null terminated string. 
+// String is limited to 256 chars including null terminator.
+// Parameters: label - label describing the element.
+{
+	readCString(_strBuffer.str,255,label);
+	return _strBuffer.str;
+}
+
+char *OIStreamJSON::readCString(const char *label)
+// Read a null terminated string.
+// Parameters: label - label describing the element.
+// Return value: char buffer containing string. User must delete it.
+{
+	readField(label);
+	readString(_str,label);
+	char *ret = new char[_str.size() + 1];
+	memcpy(ret,_str.data(),_str.size());
+	ret[_str.size()] = 0;
+	return ret;
+}
+
+char *OIStreamJSON::readCStringD(const char *label)
+// Read a null terminated string.
+// Parameters: label - label describing the element.
+// Return value: char buffer containing string. User must NOT delete it. It
+// is deleted on the next call to this method. i.e. use it immediatly.
+{
+	delete []_returnString;
+	_returnString = 0;
+	_returnString = readCString(label);
+
+	return _returnString;
+}
+
+void OIStreamJSON::readWCString(O_WCHAR_T * str,unsigned int maxlen,const char *label)
+// Read a null terminated wide character string.
+// Parameters: str - buffer in which to put string. (Must be long enough)
+//             maxlen - maximum string length. Characters beyond it are skipped.
+//			   label - label describing the element.
+{
+	readField(label);
+	readWString(label);
+	size_t n = min(_wstr.size(),(size_t)maxlen);
+	for(size_t i = 0; i < n; i++)
+		str[i] = _wstr[i];
+	str[n] = 0;
+}
+
+O_WCHAR_T * OIStreamJSON::readWCString256(const char *label)
+// Read a null terminated wide character string. 
+// String is limited to 256 chars including null terminator.
+// Parameters: label - label describing the element.
+{
+	readWCString(_strBuffer.wstr,255,label);
+	return _strBuffer.wstr;
+}
+
+O_WCHAR_T *OIStreamJSON::readWCString(const char *label)
+// Read a null terminated wide character string.
+// Parameters: label - label describing the element.
+// Return value: buffer containing string. User must delete it.
+{
+	readField(label);
+	readWString(label);
+	O_WCHAR_T *ret = new O_WCHAR_T[_wstr.size() + 1];
+	for(size_t i = 0; i < _wstr.size(); i++)
+		ret[i] = _wstr[i];
+	ret[_wstr.size()] = 0;
+	return ret;
+}
+
+O_WCHAR_T *OIStreamJSON::readWCStringD(const char *label)
+// Read a null terminated wide character string.
+// Parameters: label - label describing the element.
+// Return value: buffer containing string. User must NOT delete it. It
+// is deleted on the next call to this method. i.e. use it immediatly.
+{
+	delete []_wreturnString;
+	_wreturnString = 0;
+	_wreturnString = readWCString(label);
+
+	return _wreturnString;
+}
+
+void OIStreamJSON::readBytes(void *buf,int len,const char *label)
+// Read a number of bytes written as a hex string.
+// Parameters: buf - buffer in which to put bytes
+//             len - number of bytes to read.
+//			   label - label describing the element.
+{
+	readField(label);
+	size_t n = readHex(label);
+	if(n > (size_t)len)
+		throw OFileErr("Too many bytes.");
+	memcpy(buf,_str.data(),n);
+}
+
+void OIStreamJSON::readBits(void *buf,int len,const char *label)
+// Read a number of bits written as a string of 0's and 1's, lowest bit first.
+// Parameters: buf - buffer in which to put bytes
+//             len - number of bytes to read.
+//			   label - label describing the element.
+{
+	readField(label);
+	readString(_str,label);
+	if(_str.size() > (size_t)len*8)
+		throw OFileErr("Too many bits.");
+
+	unsigned char *bufp = (unsigned char *)buf;
+	memset(bufp,0,(_str.size() + 7) / 8);
+	for(size_t i = 0; i < _str.size(); i++)
+	{
+		if(_str[i] == '1')
+			bufp[i / 8] |= (unsigned char)(1 << (i % 8));
+		else if(_str[i] != '0')
+			throw OFileErr(invalidData);
+	}
+}
+
+OView OIStreamJSON::readStringView(const char *label)
+// Read a string.
+// Parameters: label - label describing the element.
+// Return value: A view of the string, which is valid until the read
+// constructor returns.
+{
+	readField(label);
+	readString(_str,label);
+	char *str = new char[_str.size() ? _str.size() : 1];
+	addView(str);
+	memcpy(str,_str.data(),_str.size());
+	return OView(str,_str.size());
+}
+
+OView OIStreamJSON::readBytesView(size_t len,const char *label)
+// Read a number of bytes.
+// Parameters: len - number of bytes to read.
+//			   label - label describing the element.
+// Return value: A view of the bytes, which is valid until the read
+// constructor returns.
+{
+	char *buf = new char[len ? len : 1];
+	addView(buf);
+	readBytes(buf,(int)len,label);
+	return OView(buf,len);
+}
+
+void OIStreamJSON::beginArray(const char *label)
+// Private.
+// Read the start of an array.
+{
+	readField(label);
+	if(next() != '[')
+		typeError(label);
+}
+
+void OIStreamJSON::nextElement(size_t i)
+// Private.
+// Read up to element i of an array.
+{
+	skipSpace();
+	char c = peek();
+	if(i)
+	{
+		if(c != ',' && c != ']')
+			throw OFileErr(invalidData);
+		if(c == ',')
+		{
+			_pos++;
+			skipSpace();
+			c = peek();
+		}
+	}
+	if(c == ']')
+		throw OFileErr("Too few values in array.");
+}
+
+void OIStreamJSON::endArray(void)
+// Private.
+// Read the end of an array.
+{
+	skipSpace();
+	if(next() != ']')
+		throw OFileErr("Too many values in array.");
+}
+
+void OIStreamJSON::readShortArray(O_SHORT *buf,size_t n,const char *label)
+// Read an array of two byte words written as a JSON array.
+// Parameters: label - label describing the element.
+{
+	beginArray(label);
+	for(size_t i = 0; i < n; i++)
+	{
+		nextElement(i);
+		buf[i] = (O_SHORT)readInteger(label);
+	}
+	endArray();
+}
+
+void OIStreamJSON::readLongArray(O_LONG *buf,size_t n,const char *label)
+// Read an array of long words written as a JSON array.
+// Parameters: label - label describing the element.
+{
+	beginArray(label);
+	for(size_t i = 0; i < n; i++)
+	{
+		nextElement(i);
+		buf[i] = (O_LONG)readInteger(label);
+	}
+	endArray();
+}
+
+void OIStreamJSON::readLong64Array(O_LONG64 *buf,size_t n,const char *label)
+// Read an array of 64 bit long words written as a JSON array.
+// Parameters: label - label describing the element.
+{
+	beginArray(label);
+	for(size_t i = 0; i < n; i++)
+	{
+		nextElement(i);
+		buf[i] = (O_LONG64)readInteger(label);
+	}
+	endArray();
+}
+
+void OIStreamJSON::readFloatArray(float *buf,size_t n,const char *label)
+// Read an array of floats written as a JSON array.
+// Parameters: label - label describing the element.
+{
+	beginArray(label);
+	for(size_t i = 0; i < n; i++)
+	{
+		nextElement(i);
+		buf[i] = (float)readReal(label);
+	}
+	endArray();
+}
+
+void OIStreamJSON::readDoubleArray(double *buf,size_t n,const char *label)
+// Read an array of doubles written as a JSON array.
+// Parameters: label - label describing the element.
+{
+	beginArray(label);
+	for(size_t i = 0; i < n; i++)
+	{
+		nextElement(i);
+		buf[i] = readReal(label);
+	}
+	endArray();
+}
+
+void OIStreamJSON::beginObject(const char *label)
+// Indicate the start of a containing object
+{
+	readField(label);
+	if(next() != '{')
+		typeError(label);
+}
+
+void OIStreamJSON::endObject(void)
+// End of a containing object. Any fields in it that were not read are skipped.
+{
+	skipFields();
+}
+
+OId OIStreamJSON::readObjectId(const char * /*label*/)
+// Read an object identity.
+{
+	// Should not be called because there is no Ofile to resolve Id's against.
+	oFAssert(0);
+	return 0;
+}
+
+OFile *OIStreamJSON::readBlobHeader(OFilePos_t *mark,oulong *blobLength,
+								oulong *fileLength,const char *label)
+// Read a blob header
+// Return 0 because the blob is not located in an OFile. Its data is read
+// here and copied by the next call to readBlob().
+// Parameters:
+// *mark - return 0 because the file is not attached to a OFile.
+// *blobLength - return 0 because blob has not yet been read. It will be set
+// by the caller to the fileLength that is returned.
+// *fileLength - return the length in bytes of the blob.
+// label - label describing the element.
+{
+	readField(label);
+	*mark = 0;
+	*fileLength = (oulong)readHex(label);
+	*blobLength = 0;
+	// Blob not attached
+	return 0;
+}
+
+void OIStreamJSON::readBlob(void *buf,OFilePos_t /*mark*/,unsigned long size)
+// Read blob data.
+// Parameters: buf - buffer in which to put blob data
+//             size - number of bytes to read.
+{
+	memcpy(buf,_str.data(),min((size_t)size,_str.size()));
+}
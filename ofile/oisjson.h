@@ -0,0 +1,147 @@
+#ifndef OISJSON_H
+#define OISJSON_H
+/*=============================================================================
+MIT License
+
+Copyright(c) 2019 willywood
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+=============================================================================*/
+
+#include <iostream>
+#include <string>
+#include "oisimport.h"
+#include "ox.h"
+
+// OIStreamJSON is a concrete subclass of OIStream. It reads objects written
+// as JSON Lines by OOStreamJSON(see oosjson.h) from a standard input stream
+// and adds them to a file.
+
+class OIStreamJSON: public OIStreamImport {
+
+
+public:
+	enum {cBufferSize = 0x4000}; // Bytes read from the stream at a time.
+
+	OIStreamJSON(OFile *f, std::istream &in);
+	~OIStreamJSON();
+
+
+	void readObjects(OClassId_t classId = cOPersist,bool deep = true);
+
+private:
+	O_LONG readLong(const char *label = 0);
+	O_LONG64 readLong64(const char *label = 0);
+	float readFloat(const char *label = 0);
+	double readDouble(const char *label = 0);
+	O_SHORT readShort(const char *label = 0);
+	char readChar(const char *label = 0);
+	bool readBool(const char *label = 0);
+	void readCString(char * str,unsigned int maxlen,const char *label = 0);
+	char *readCString256(const char *label = 0);
+	char * readCString(const char *label = 0);
+	char * readCStringD(const char *label = 0);
+	// wchar support  can be removed if not used.
+	O_WCHAR_T readWChar(const char *label = 0);
+	void readWCString(O_WCHAR_T * str,unsigned int maxlen,const char *label = 0);
+	O_WCHAR_T *readWCString256(const char *label = 0);
+	O_WCHAR_T * readWCString(const char *label = 0);
+	O_WCHAR_T * readWCStringD(const char *label = 0);
+	//
+	void readBytes(void *buf,int nBytes,const char *label = 0);
+	void readBits(void *buf,int nBytes,const char *label = 0);
+	OView readStringView(const char *label = 0);
+	OView readBytesView(size_t nBytes,const char *label = 0);
+	void readShortArray(O_SHORT *buf,size_t n,const char *label = 0);
+	void readLongArray(O_LONG *buf,size_t n,const char *label = 0);
+	void readLong64Array(O_LONG64 *buf,size_t n,const char *label = 0);
+	void readFloatArray(float *buf,size_t n,const char *label = 0);
+	void readDoubleArray(double *buf,size_t n,const char *label = 0);
+	OId readObjectId(const char *label = 0);
+	void readBlob(void *buf,OFilePos_t mark,unsigned long size);
+	OFile *readBlobHeader(OFilePos_t *mark,oulong *blobLength,
+								oulong *fileLength,const char *label = 0);
+
+	void beginObject(const char *label);
+	void endObject(void);
+
+private:
+	OPersist *readObjectOrRef(const char *label,OId *forwardId);
+	OId readHeader(void);
+	bool nextKey(void);
+	void readField(const char *label);
+	void skipValue(void);
+	void skipFields(void);
+	void beginArray(const char *label);
+	void nextElement(size_t i);
+	void endArray(void);
+	OSYS_LONG64 readInteger(const char *label);
+	double readReal(const char *label);
+	size_t readNumber(char *buf,size_t size,const char *label);
+	void readWord(char *buf,size_t size,const char *label);
+	void readString(std::string &str,const char *label);
+	OSYS_ULONG32 readEscape(void);
+	void readWString(const char *label);
+	size_t readHex(const char *label);
+	void typeError(const char *label);
+	void skipSpace(void)
+	{
+		while((_pos != _end || fill()) &&
+			  (_buf[_pos] == ' ' || _buf[_pos] == '\n' || _buf[_pos] == '\r' || _buf[_pos] == '\t'))
+			_pos++;
+	}
+	char peek(void)
+	{
+		if(_pos == _end && !fill())
+			throw OFileErr("Unexpected end of JSON data.");
+		return _buf[_pos];
+	}
+	char next(void)
+	{
+		char c = peek();
+		_pos++;
+		return c;
+	}
+	bool fill(void);
+
+private:
+	std::istream &_in;			  // Input stream
+	char _buf[cBufferSize];       // Text read from _in
+	size_t _pos;                  // Position of the next character in _buf
+	size_t _end;                  // End of the text in _buf
+	int _level;                   // Objects being read
+	std::string _key;             // Name of the current field
+	std::string _str;             // The last string read, as UTF-8
+	std::vector<O_WCHAR_T> _wstr; // The last wide string read
+	char *_returnString;
+	O_WCHAR_T *_wreturnString;
+#ifndef OF_MULTI_THREAD
+	// There can never be two readfunctions running simulultaneously,so
+	// save space by making all the streams share the same return buffer
+	static 
+#endif
+	union StrBuffT			  // Return buffer for reading strings
+	{
+		O_WCHAR_T wstr[256];
+		char str[256];
+	}_strBuffer;      
+
+};
+
+#endif  // OISJSON_H
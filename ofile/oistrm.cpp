@@ -48,6 +48,10 @@ at the same time.
 #include "oistrm.h"
 #include "ofile.h"
 #include "ox.h"
+#include "olz.h"
+#include "ocrc.h"
+
+static const char *cChecksumMessage = "Object checksum does not match.";
 
 #ifndef OF_MULTI_THREAD
 // There can never be two readfunctions running simulultaneously,so
@@ -71,9 +75,20 @@ void OIStreamFile::setCurrentObject(OPersist *ob)
 	_file->setCurrentIndex(ob);
 }
 
+ORawOrder OIStreamFile::rawOrder(void)const
+// Fixed width values are raw bytes unless the file is compact.
+{
+	if(_compact)
+		return cRawNone;
+	return _file->needSwap() ? cRawSwapped : cRawNative;
+}
+
 O_LONG OIStreamFile::readLong(const char * /*label */)
 // Read a long word (4 bytes)
 {
+	if(_compact)
+		return (O_LONG)OUtilityFunction::unzigzag(readVarint());
+
 	O_LONG data;
 	readData(&data,sizeof(O_LONG));
 	if(file()->needSwap())
@@ -84,6 +99,9 @@ O_LONG OIStreamFile::readLong(const char * /*label */)
 O_LONG64 OIStreamFile::readLong64(const char * /*label */)
 // Read a long word (8 bytes)
 {
+	if(_compact)
+		return (O_LONG64)OUtilityFunction::unzigzag(readVarint());
+
 	O_LONG64 data;
 	readData(&data,sizeof(O_LONG64));
 	if(file()->needSwap())
@@ -94,6 +112,9 @@ O_LONG64 OIStreamFile::readLong64(const char * /*label */)
 OFilePos_t OIStreamFile::readFilePos(const char * /*label */)
 // Read a long word (4 bytes)
 {
+	if(_compact)
+		return (OFilePos_t)readVarint();
+
 	OFilePos_t data;
 	readData(&data,sizeof(OFilePos_t));
 	if(file()->needSwap())
@@ -124,6 +145,9 @@ double OIStreamFile::readDouble(const char * /*label */)
 O_SHORT OIStreamFile::readShort(const char * /*label */)
 // Read a two byte word.
 {
+	if(_compact)
+		return (O_SHORT)OUtilityFunction::unzigzag(readVarint());
+
 	O_SHORT data;
 	readData(&data,sizeof(O_SHORT));
 	if(file()->needSwap())
@@ -244,13 +268,15 @@ char *OIStreamFile::readCStringD(const char * /*label */)
 // Parameters: str - buffer in which to put string
 //             maxlen - buffer length.
 // Return value: char buffer containing string. User must NOT delete it. It
-// is deleted on the next call to this method or whne finish is called. i.e.
-// use it immediatly.
+// is deleted when the outermost object being read is finished. i.e. use it
+// in the read constructor.
 {
-	delete []_returnString;
-	_returnString =  readCString();
-
-	return _returnString;
+	unsigned short len = readShort();
+	char *ret = (char *)_arena.allocate(len + 1);
+	if(len)
+		readData((void *)ret,len);
+	ret[len] = '\0';
+	return ret;
 }
 
 O_WCHAR_T *OIStreamFile::readWCStringD(const char * /*label */)
@@ -258,13 +284,15 @@ O_WCHAR_T *OIStreamFile::readWCStringD(const char * /*label */)
 // Parameters: str - buffer in which to put string
 //             maxlen - buffer length.
 // Return value: char buffer containing string. User must NOT delete it. It
-// is deleted on the next call to this method or whne finish is called. i.e.
-// use it immediatly.
+// is deleted when the outermost object being read is finished. i.e. use it
+// in the read constructor.
 {
-	delete []_wreturnString;
-	_wreturnString =  readWCString();
-
-	return _wreturnString;
+	unsigned short len = readShort();
+	O_WCHAR_T *ret = (O_WCHAR_T *)_arena.allocate((len + 1)*sizeof(O_WCHAR_T));
+	for(int i = 0;i < len;i++)
+		ret[i] = readWChar();
+	ret[len] = 0;
+	return ret;
 }
 
 void OIStreamFile::readBytes(void *buf,int len,const char * /*label */)
@@ -295,6 +323,83 @@ void OIStreamFile::readBits(void *buf,int len,const char * /*label */)
 	}
 }
 
+OView OIStreamFile::readStringView(const char * /*label */)
+// Read a string written by writeCString without copying it.
+// Return value: A view of the string, which is valid until the read
+// constructor returns. It is not null terminated.
+{
+	unsigned short len = readShort();
+	return OView(readView(len),len);
+}
+
+OView OIStreamFile::readBytesView(size_t len,const char * /*label */)
+// Read a number of bytes without copying them.
+// Parameters: len - number of bytes to read.
+// Return value: A view of the bytes, which is valid until the read
+// constructor returns.
+{
+	return OView(readView(len),len);
+}
+
+void OIStreamFile::readShortArray(O_SHORT *buf,size_t n,const char *label)
+// Read an array of n two byte words in one go.
+// Parameters: label - label describing the element.
+{
+	if(_compact)
+		OIStream::readShortArray(buf,n,label);
+	else
+		readSwapped(buf,n,sizeof(O_SHORT));
+}
+
+void OIStreamFile::readLongArray(O_LONG *buf,size_t n,const char *label)
+// Read an array of n long words in one go.
+// Parameters: label - label describing the element.
+{
+	// A long that is not 4 bytes is swapped by readLong as if it were.
+	if(_compact || (sizeof(O_LONG) != 4 && file()->needSwap()))
+		OIStream::readLongArray(buf,n,label);
+	else
+		readSwapped(buf,n,sizeof(O_LONG));
+}
+
+void OIStreamFile::readLong64Array(O_LONG64 *buf,size_t n,const char *label)
+// Read an array of n 64 bit long words in one go.
+// Parameters: label - label describing the element.
+{
+	if(_compact)
+		OIStream::readLong64Array(buf,n,label);
+	else
+		readSwapped(buf,n,sizeof(O_LONG64));
+}
+
+void OIStreamFile::readFloatArray(float *buf,size_t n,const char * /* label */)
+// Read an array of n floats in one go.
+{
+	readSwapped(buf,n,sizeof(float));
+}
+
+void OIStreamFile::readDoubleArray(double *buf,size_t n,const char * /* label */)
+// Read an array of n doubles in one go.
+{
+	readSwapped(buf,n,sizeof(double));
+}
+
+void OIStreamFile::readSwapped(void *buf,size_t n,int size)
+// Read n values of size bytes, swapping them if the file needs it.
+{
+	readData(buf,n*size);
+
+	if(file()->needSwap())
+	{
+		if(size == 2)
+			OUtilityFunction::swapArray16(buf,buf,n);
+		else if(size == 4)
+			OUtilityFunction::swapArray32(buf,buf,n);
+		else
+			OUtilityFunction::swapArray64(buf,buf,n);
+	}
+}
+
 
 void OIStreamFile::readObject(OPersist **obp,const char * /*label */)
 // Read an object deferred until finish()
@@ -303,8 +408,7 @@ void OIStreamFile::readObject(OPersist **obp,const char * /*label */)
 {
 	OId id = readObjectId();
 	OSmartPtr sp = {id,obp};
-	OSmartPtrs &smartPtrs = _readObjects.top()._sp;
-	smartPtrs.push_back(sp);
+	_smartPtrs.push_back(sp);
 }
 
 OPersist *OIStreamFile::readObject(const char * /*label */)
@@ -322,6 +426,9 @@ OId OIStreamFile::readObjectId(const char * /*label */)
 // Read an object identity.
 // Note: Assumes OId is defined as long.
 {
+	if(_compact)
+		return (OId)readVarint();
+
 	return readLong();
 }
 
@@ -353,8 +460,8 @@ OFile *OIStreamFile::readBlobHeader(OFilePos_t *mark,oulong *blobLength,
 // ========================= P R I V A T E =======================================
 OIStreamFile::OIStreamFile(OFile *f,const char* fname,long operation):
 								_file(f),
-								_toRead(0),_ownsFile(true),
-								_returnString(0),_wreturnString(0)
+								_toRead(0),_ownsFile(true),_compact(false),
+								_image(0),_imageLength(0),_imagePos(0)
 // Constructor giving ownership of the file to this stream.
 {
 	_fd = o_fopen(fname,operation);
@@ -365,8 +472,8 @@ OIStreamFile::OIStreamFile(OFile *f,const char* fname,long operation):
 OIStreamFile::OIStreamFile(OFile *f,IStorage *istorage,const char* fname,
 							unsigned long istorage_mode):
 								_file(f),
-								_toRead(0),_ownsFile(true),
-								_returnString(0),_wreturnString(0)
+								_toRead(0),_ownsFile(true),_compact(false),
+								_image(0),_imageLength(0),_imagePos(0)
 // Constructor giving ownership of the file to this stream.
 {
 	_fd = o_fopen(istorage,fname,istorage_mode);
@@ -375,8 +482,8 @@ OIStreamFile::OIStreamFile(OFile *f,IStorage *istorage,const char* fname,
 #endif
 
 OIStreamFile::OIStreamFile(OFile *f):_file(f),_fd(*f->fd()),
-									_toRead(0),_ownsFile(false),
-									_returnString(0),_wreturnString(0)
+									_toRead(0),_ownsFile(false),_compact(false),
+									_image(0),_imageLength(0),_imagePos(0)
 // Constructor without ownership of the file.
 {
 	_fileOpen = true;
@@ -388,8 +495,7 @@ OIStreamFile::~OIStreamFile()
 		// Close the file.
 		close();
 
-	delete []_returnString;
-	delete []_wreturnString;
+	delete []_image;
 }
 
 void OIStreamFile::open(const char *fname,long operation)
@@ -424,22 +530,56 @@ const char *message = "Invalid file data format";
 	if(!_fileOpen)
 		_file->reopen();
 
+	// A stream that owns its file reads from it. Otherwise it reads from
+	// the file's stream.
+	O_fd &fd = _ownsFile ? _fd : *_file->fd();
+
 	// Set the file position
-	int ierr = o_fseek(*_file->fd(),mark,SEEK_SET);
+	int ierr = o_fseek(fd,mark,SEEK_SET);
 	if(ierr)
 		throw OFileIOErr(message);
 
 	// Read the data.
-	long err = o_fread(buf,size,1,*_file->fd());
+	long err = o_fread(buf,size,1,fd);
+	_file->count(&OFileStats::reads);
 	// Trying to read more data from an object than was written to it.
 	if(1 != err)
 		throw OFileIOErr(message);
+	_file->count(&OFileStats::bytesRead,size);
+}
+
+OSYS_ULONG64 OIStreamFile::readVarint(void)
+// Read an unsigned integer written by OOStreamFile::writeVarint.
+{
+	OSYS_ULONG64 v = 0;
+	unsigned char b;
+	int shift = 0;
+	do
+	{
+		if(shift >= 7*OUtilityFunction::cMaxVarintLength)
+			throw OFileIOErr("Invalid file data format");
+		readData(&b,1);
+		v |= (OSYS_ULONG64)(b & 0x7F) << shift;
+		shift += 7;
+	}while(b & 0x80);
+	return v;
 }
 
 void OIStreamFile::readData(void *buf,size_t size)
 // Read data from the buffer. If the buffer is empty, fill it up again from
 // the file.
 {
+	// A compressed object is read from its decompressed image.
+	if(_image)
+	{
+		// Trying to read more data from an object than was written to it.
+		if((long)size > _imageLength - _imagePos)
+			throw OFileIOErr("Invalid file data format");
+		memcpy(buf,_image + _imagePos,size);
+		_imagePos += (long)size;
+		return;
+	}
+
 	long dread;
 	char* bufp = (char *)buf;
 	while((dread = _ostr.read(bufp,size)) != size)
@@ -458,17 +598,126 @@ void OIStreamFile::readData(void *buf,size_t size)
 	}
 }
 
-void OIStreamFile::start(OFilePos_t mark,long size)
+const char *OIStreamFile::readView(size_t size)
+// Return a pointer to the next size bytes of the object and skip them.
+// The buffer is refilled as the object is read, and by the reading of any
+// object that this one refers to, so the rest of the object is first read
+// into an image, which is not deleted until finish(). A compressed object
+// is already an image.
+{
+	if(!_image)
+	{
+		long buffered = _ostr.toRead();
+		long length = buffered + _toRead;
+		char *image = new char[length ? length : 1];
+		_ostr.read(image,buffered);
+		if(_toRead)
+		{
+			try
+			{
+				readDataAt(_mark,image + buffered,_toRead);
+			}catch(...){
+				delete []image;
+				throw;
+			}
+			_mark += _toRead;
+			_toRead = 0;
+		}
+		_image = image;
+		_imageLength = length;
+		_imagePos = 0;
+	}
+
+	// Trying to read more data from an object than was written to it.
+	if((long)size > _imageLength - _imagePos)
+		throw OFileIOErr("Invalid file data format");
+	const char *data = _image + _imagePos;
+	_imagePos += (long)size;
+	return data;
+}
+
+char *OIStreamFile::readImage(OFilePos_t mark,long size,bool compressed,
+							  const OSYS_ULONG32 *crc,long *length)
+// Read the whole of an object into memory, check it against its checksum
+// and decompress it(see OOStreamFile::finishCompressed).
+// Parameters: crc - the checksum to check against or 0.
+// Return - The object, which the caller must delete.
+//          length is set to its length.
+{
+const char *message = "Invalid file data format";
+
+	char *packed = new char[size];
+	char *image = 0;
+	try
+	{
+		readDataAt(mark,packed,size);
+
+		if(crc && OCRC32C::compute(packed,size) != *crc)
+			throw OFileIOErr(cChecksumMessage);
+
+		if(!compressed)
+		{
+			*length = size;
+			return packed;
+		}
+
+		if(size < 4)
+			throw OFileIOErr(message);
+
+		*length = 0;
+		for(int i = 0; i < 4; i++)
+			*length |= (long)(unsigned char)packed[i] << (8*i);
+
+		if(*length < 0)
+			throw OFileIOErr(message);
+		image = new char[*length];
+		if(!OLZ::decompress(packed + 4,size - 4,image,*length))
+			throw OFileIOErr(message);
+	}catch(...){
+		delete []packed;
+		delete []image;
+		throw;
+	}
+	delete []packed;
+	return image;
+}
+
+void OIStreamFile::start(OFilePos_t mark,long size,bool compressed,const OSYS_ULONG32 *crc)
 // Start reading an object.
 // Parameters: mark - Poisition of object in file or 0 if the object has no data.
 //             size - size in bytes of the objects data.
+//             compressed - the object is compressed. It is decompressed
+//                          here and then read from memory.
+//             crc - if not 0, the checksum of the object in the file. The object
+//                   is checked before anything is read from it. OFileIOErr is
+//                   thrown if it does not match.
 {
+	long imageLength = 0;
+	char *image = 0;
+
+	// An object that does not fit in the buffer must be read completely to
+	// check it. It is then read from memory.
+	if(size && (compressed || (crc && size > _ostr.bufferSize())))
+		image = readImage(mark,size,compressed,crc,&imageLength);
+
 	// Save the stream state on a stack, in case we are in the middle of reading
 	// an existing object.
-	_readObjects.push(StrmInfo(_mark - _ostr.toRead(),_ostr.toRead() + _toRead));
+	_readObjects.push(StrmInfo(_mark - _ostr.toRead(),_ostr.toRead() + _toRead,
+							   _image,_imageLength,_imagePos,_smartPtrs.size()));
 
 	// Set the file position
 	_mark = mark;
+	_image = image;
+	_imageLength = imageLength;
+	_imagePos = 0;
+
+	if(image)
+	{
+		// Nothing is read from the file.
+		_toRead = 0;
+		_ostr.set(0);
+		return;
+	}
 
 	// Objects can have a size of 0
 	if(size){
@@ -477,10 +726,19 @@ void OIStreamFile::start(OFilePos_t mark,long size)
 
 		long canRead = min(_toRead,_ostr.bufferSize());
 
-		readDataAt(_mark,_ostr.set(canRead),canRead);
+		void *buf = _ostr.set(canRead);
+		readDataAt(_mark,buf,canRead);
 
 		_toRead -= canRead;
 		_mark += canRead;
+
+		// The whole object is in the buffer.
+		if(crc && OCRC32C::compute(buf,canRead) != *crc)
+		{
+			_ostr.set(0);
+			abort();
+			throw OFileIOErr(cChecksumMessage);
+		}
 	}
 }
 
@@ -493,13 +751,15 @@ void OIStreamFile::finish(void)
 	StrmInfo info(_readObjects.top()); 
 	_readObjects.pop();
 
-	// Resolve all the read objects
-	OSmartPtrs &smartPtrs = info._sp;
-	for(OSmartPtrs::iterator it = smartPtrs.begin();it != smartPtrs.end();++it)
+	// Resolve all the read objects. Reading them adds to _smartPtrs, so it
+	// is indexed rather than iterated.
+	size_t end = _smartPtrs.size();
+	for(size_t i = info._sp; i < end; i++)
 	{
-		OSmartPtr &sp = *it;
+		OSmartPtr sp = _smartPtrs[i];
 		*sp._obp = sp._id ? _file->getObject(sp._id) : 0;
 	}
+	_smartPtrs.resize(info._sp);
 
 	// Check that we have read all of the object.
 //	oFAssert(_toRead == 0);
@@ -510,12 +770,11 @@ void OIStreamFile::finish(void)
 
 	// Restore the stream state from the stack so that we can carry on reading the
 	// object that was interrupted by another start.
-	_mark = info._mark;
-	_toRead = info._toRead;
+	restore(info);
 
-	// Remove the return string.
-	delete []_returnString;
-	_returnString = 0;
+	// Remove the return strings.
+	if(_readObjects.empty())
+		_arena.reset();
 }
 
 void OIStreamFile::abort(void)
@@ -524,9 +783,24 @@ void OIStreamFile::abort(void)
 {
 	// Restore the stream state from the stack so that we can carry on reading the
 	// object that was interrupted by another start.
-	_mark = _readObjects.top()._mark;
-	_toRead = _readObjects.top()._toRead;
+	restore(_readObjects.top());
+	_smartPtrs.resize(_readObjects.top()._sp);
 	_readObjects.pop();
+
+	if(_readObjects.empty())
+		_arena.reset();
+}
+
+void OIStreamFile::restore(const StrmInfo &info)
+// Restore the state of the stream saved by start().
+{
+	_mark = info._mark;
+	_toRead = info._toRead;
+
+	delete []_image;
+	_image = info._image;
+	_imageLength = info._imageLength;
+	_imagePos = info._imagePos;
 }
 
 
@@ -536,6 +810,34 @@ void OIStreamFile::abort(void)
 // If anyone tests them please let me know if they work.
 //
 
+int OUtilityFunction::varintLength(OSYS_ULONG64 v)
+// Return the number of bytes needed to encode v as a variable length integer.
+{
+	int len = 1;
+	while(v >= 0x80)
+	{
+		v >>= 7;
+		len++;
+	}
+	return len;
+}
+
+int OUtilityFunction::encodeVarint(OSYS_ULONG64 v,unsigned char *buf)
+// Encode v as a variable length integer(LEB128) into buf, which must have
+// space for cMaxVarintLength bytes. Seven bits are stored per byte, least
+// significant first. The top bit is set on all but the last byte.
+// Return the number of bytes used.
+{
+	int len = 0;
+	while(v >= 0x80)
+	{
+		buf[len++] = (unsigned char)(v | 0x80);
+		v >>= 7;
+	}
+	buf[len++] = (unsigned char)v;
+	return len;
+}
+
 // This is a lookup table used to invert bits of a bytes.
 const unsigned char	OUtilityFunction::cInvertedBits[256]	= 
 {
@@ -622,6 +924,248 @@ void OUtilityFunction::swapFilePos(char *val)
 		swap32(val);
 }
 
+// Bulk swapping. Vectors of 16 or 32 bytes are swapped with a byte shuffle
+// where the processor has one(SSSE3 or AVX2 on x86, chosen at run time, or
+// NEON on ARM). The rest is swapped one value at a time.
+
+static void swapScalar(char *dst,const char *src,size_t nBytes,int size)
+{
+	for(size_t i = 0; i < nBytes; i += size)
+		for(int j = 0; j < size/2; j++)
+		{
+			char temp = src[i + j];
+			dst[i + j] = src[i + size - 1 - j];
+			dst[i + size - 1 - j] = temp;
+		}
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define OSWAP_X86 1
+#include <immintrin.h>
+#define OSWAP_TARGET(t) __attribute__((target(t)))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define OSWAP_X86 1
+#include <immintrin.h>
+#include <intrin.h>
+#define OSWAP_TARGET(t)
+#elif defined(__ARM_NEON)
+#define OSWAP_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(OSWAP_X86)
+// Shuffle masks that reverse each value of 2, 4 or 8 bytes.
+static const char cSwapMask16[16] = {1,0,3,2,5,4,7,6,9,8,11,10,13,12,15,14};
+static const char cSwapMask32[16] = {3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12};
+static const char cSwapMask64[16] = {7,6,5,4,3,2,1,0,15,14,13,12,11,10,9,8};
+
+static const char *swapMask(int size)
+{
+	return size == 2 ? cSwapMask16 : size == 4 ? cSwapMask32 : cSwapMask64;
+}
+
+OSWAP_TARGET("ssse3")
+static size_t swapSSSE3(char *dst,const char *src,size_t nBytes,int size)
+// Return the number of bytes swapped.
+{
+	__m128i mask = _mm_loadu_si128((const __m128i *)swapMask(size));
+	size_t i = 0;
+	for(; i + 16 <= nBytes; i += 16)
+		_mm_storeu_si128((__m128i *)(dst + i),
+						 _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(src + i)),mask));
+	return i;
+}
+
+OSWAP_TARGET("avx2")
+static size_t swapAVX2(char *dst,const char *src,size_t nBytes,int size)
+// Return the number of bytes swapped.
+{
+	__m128i mask128 = _mm_loadu_si128((const __m128i *)swapMask(size));
+	__m256i mask = _mm256_broadcastsi128_si256(mask128);
+	size_t i = 0;
+	for(; i + 32 <= nBytes; i += 32)
+		_mm256_storeu_si256((__m256i *)(dst + i),
+							_mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i *)(src + i)),mask));
+	return i;
+}
+
+// Instruction set available: 0 - none, 1 - SSSE3, 2 - AVX2
+static int swapInstructions(void)
+{
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info,0);
+	int nIds = info[0];
+	__cpuid(info,1);
+	if(!(info[2] & (1 << 9)))
+		return 0;
+	if(nIds >= 7)
+	{
+		// AVX2 also needs the operating system to save the registers.
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		__cpuidex(info,7,0);
+		if(osxsave && (info[1] & (1 << 5)) && (_xgetbv(0) & 6) == 6)
+			return 2;
+	}
+	return 1;
+#else
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2"))
+		return 2;
+	return __builtin_cpu_supports("ssse3") ? 1 : 0;
+#endif
+}
+
+// Found before main, so that threads do not race to do it.
+static const int sSwapInstructions = swapInstructions();
+#endif
+
+static void swapArray(void *dstv,const void *srcv,size_t n,int size)
+{
+	char *dst = (char *)dstv;
+	const char *src = (const char *)srcv;
+	size_t nBytes = n*size;
+	size_t done = 0;
+
+#if defined(OSWAP_X86)
+	if(sSwapInstructions == 2)
+		done = swapAVX2(dst,src,nBytes,size);
+	else if(sSwapInstructions == 1)
+		done = swapSSSE3(dst,src,nBytes,size);
+#elif defined(OSWAP_NEON)
+	for(; done + 16 <= nBytes; done += 16)
+	{
+		uint8x16_t v = vld1q_u8((const uint8_t *)(src + done));
+		v = size == 2 ? vrev16q_u8(v) : size == 4 ? vrev32q_u8(v) : vrev64q_u8(v);
+		vst1q_u8((uint8_t *)(dst + done),v);
+	}
+#endif
+	swapScalar(dst + done,src + done,nBytes - done,size);
+}
+
+void OUtilityFunction::swapArray16(void *dst,const void *src,size_t n)
+{
+	swapArray(dst,src,n,2);
+}
+
+void OUtilityFunction::swapArray32(void *dst,const void *src,size_t n)
+{
+	swapArray(dst,src,n,4);
+}
+
+void OUtilityFunction::swapArray64(void *dst,const void *src,size_t n)
+{
+	swapArray(dst,src,n,8);
+}
+
+
+OView OIStream::readStringView(const char *label)
+// Read a string written by writeCString into the arena.
+// Return value: A view of the string, which is valid until the read
+// constructor returns. It is not null terminated.
+{
+	char *str = readCString(label);
+	size_t len = strlen(str);
+	char *buf = (char *)_arena.allocate(len);
+	memcpy(buf,str,len);
+	delete []str;
+	return OView(buf,len);
+}
+
+OView OIStream::readBytesView(size_t len,const char *label)
+// Read a number of bytes into the arena.
+// Parameters: len - number of bytes to read.
+// Return value: A view of the bytes, which is valid until the read
+// constructor returns.
+{
+	char *buf = (char *)_arena.allocate(len);
+	if(len)
+		readBytes(buf,(int)len,label);
+	return OView(buf,len);
+}
+
+void OIStream::readShortArray(O_SHORT *buf,size_t n,const char *label)
+// Read an array of n two byte words.
+// Parameters: label - label describing the element.
+{
+	for(size_t i = 0; i < n; i++)
+		buf[i] = readShort(label);
+}
+
+void OIStream::readLongArray(O_LONG *buf,size_t n,const char *label)
+// Read an array of n long words.
+// Parameters: label - label describing the element.
+{
+	for(size_t i = 0; i < n; i++)
+		buf[i] = readLong(label);
+}
+
+void OIStream::readLong64Array(O_LONG64 *buf,size_t n,const char *label)
+// Read an array of n 64 bit long words.
+// Parameters: label - label describing the element.
+{
+	for(size_t i = 0; i < n; i++)
+		buf[i] = readLong64(label);
+}
+
+void OIStream::readFloatArray(float *buf,size_t n,const char *label)
+// Read an array of n floats.
+// Parameters: label - label describing the element.
+{
+	for(size_t i = 0; i < n; i++)
+		buf[i] = readFloat(label);
+}
+
+void OIStream::readDoubleArray(double *buf,size_t n,const char *label)
+// Read an array of n doubles.
+// Parameters: label - label describing the element.
+{
+	for(size_t i = 0; i < n; i++)
+		buf[i] = readDouble(label);
+}
+
+OIStream::OArena::~OArena(void)
+{
+	reset();
+	delete []_block;
+}
+
+void *OIStream::OArena::allocate(size_t size)
+// Return memory for size bytes aligned for any type.
+{
+	size = (size + 7) & ~(size_t)7;
+	if(_used + size <= _blockSize)
+	{
+		void *p = _block + _used;
+		_used += size;
+		return p;
+	}
+	char *p = new char[size];
+	_overflow.push_back(p);
+	_overflowSize += size;
+	return p;
+}
+
+void OIStream::OArena::reset(void)
+// Release all the memory. If the block was not big enough it is replaced
+// by one that is.
+{
+	if(!_overflow.empty())
+	{
+		for(size_t i = 0; i < _overflow.size(); i++)
+			delete []_overflow[i];
+		_overflow.clear();
+
+		size_t size = _blockSize + _overflowSize;
+		delete []_block;
+		_block = 0;
+		_blockSize = 0;
+		_block = new char[size];
+		_blockSize = size;
+		_overflowSize = 0;
+	}
+	_used = 0;
+}
 
 void *OIStream::OIBuffer::set(long dataLength)
 {
@@ -47,6 +47,21 @@ using std::deque;
 
 class OFile;
 
+// A read only view of data in an input stream: a pointer and a length. The
+// data is not null terminated. It belongs to the stream and is valid until
+// the read constructor that read it returns.
+class OView{
+public:
+	OView(void):_data(0),_length(0){}
+	OView(const char *data,size_t length):_data(data),_length(length){}
+	const char *data(void)const{return _data;}
+	size_t length(void)const{return _length;}
+	bool empty(void)const{return _length == 0;}
+private:
+	const char *_data;
+	size_t _length;
+};
+
 //typedef long O_LONG;   // Four bytes
 //typedef short O_SHORT; // Two bytes
 
@@ -87,8 +102,26 @@ public:
 		long _dataLength;
 	};
 
+	// Memory for return strings and views. It is allocated by bumping a
+	// pointer and is all released when the outermost object has been read.
+	// The block grows to the most that was needed, so that in the steady
+	// state nothing is allocated.
+	class OArena{
+	public:
+		OArena(void):_block(0),_blockSize(0),_used(0),_overflowSize(0){}
+		~OArena(void);
+		void *allocate(size_t size);
+		void reset(void);
+	private:
+		char *_block;
+		size_t _blockSize;
+		size_t _used;
+		vector<char *> _overflow; // Allocated when the block was full
+		size_t _overflowSize;
+	};
+
 	OIStream(){}
-	~OIStream(void){}
+	virtual ~OIStream(void){}
 
 	// These methods have to be public because any class that is streamed (not just decendants
 	// of OPersist) can call them. However derived streams can make them private.
@@ -112,6 +145,18 @@ public:
 	//
 	virtual void readBytes(void *buf,int nBytes,const char *label = 0) = 0;
 	virtual void readBits(void *buf,int nBytes,const char *label = 0) = 0;
+	// Views of a string written by writeCString and of bytes written by
+	// writeBytes. By default they are read into memory of the stream, which
+	// streams that read the data in place do not need.
+	virtual OView readStringView(const char *label = 0);
+	virtual OView readBytesView(size_t nBytes,const char *label = 0);
+	// Arrays of n values, written by the matching OOStream methods.
+	// By default the values are read one at a time.
+	virtual void readShortArray(O_SHORT *buf,size_t n,const char *label = 0);
+	virtual void readLongArray(O_LONG *buf,size_t n,const char *label = 0);
+	virtual void readLong64Array(O_LONG64 *buf,size_t n,const char *label = 0);
+	virtual void readFloatArray(float *buf,size_t n,const char *label = 0);
+	virtual void readDoubleArray(double *buf,size_t n,const char *label = 0);
 	virtual OId readObjectId(const char *label = 0) = 0;
 	virtual void readObject(OPersist **obp,const char *label = 0) = 0;
 	virtual OPersist *readObject(const char *label = 0) = 0;
@@ -135,6 +180,14 @@ public:
 	// Do not need to override. Return 0 indicates not reading from an OFile.
 	// Used by ODemandT
 	virtual OFile *file(void)const{return 0;}
+	// Do not need to override. The byte order of fixed width values if they
+	// are stored as raw bytes. Used by OFastRead.
+	virtual ORawOrder rawOrder(void)const{return cRawNone;}
+
+protected:
+	// The views read by default. A stream that uses it resets it when the
+	// outermost object has been read.
+	OArena _arena;
 };
 
 ///////////////////////////////////////////////////////////////////////////
@@ -153,16 +206,24 @@ struct OSmartPtr
 	OPersist **_obp;
 };
 
-typedef deque<OSmartPtr> OSmartPtrs;
+// The smart pointers of all the objects being read. Each object's pointers
+// follow those of the object whose reading it interrupted.
+typedef vector<OSmartPtr> OSmartPtrs;
 
 class StrmInfo{
 public:
 	StrmInfo(){}
 	~StrmInfo(){}
-	StrmInfo(OFilePos_t mark,long toRead):_mark(mark),_toRead(toRead){}
-	OSmartPtrs _sp;
+	StrmInfo(OFilePos_t mark,long toRead,char *image,long imageLength,long imagePos,
+			 size_t sp):
+		_mark(mark),_toRead(toRead),
+		_image(image),_imageLength(imageLength),_imagePos(imagePos),_sp(sp){}
 	OFilePos_t    _mark;
 	long      _toRead;
+	char     *_image;
+	long      _imageLength;
+	long      _imagePos;
+	size_t    _sp;        // Index of the object's first smart pointer
 
 	// These are needed for some STL vector implementations
     int operator < (const StrmInfo &si) const {
@@ -210,6 +271,13 @@ public:
 	//
 	void readBytes(void *buf,int nBytes,const char *label = 0);
 	void readBits(void *buf,int nBytes,const char *label = 0);
+	OView readStringView(const char *label = 0);
+	OView readBytesView(size_t nBytes,const char *label = 0);
+	void readShortArray(O_SHORT *buf,size_t n,const char *label = 0);
+	void readLongArray(O_LONG *buf,size_t n,const char *label = 0);
+	void readLong64Array(O_LONG64 *buf,size_t n,const char *label = 0);
+	void readFloatArray(float *buf,size_t n,const char *label = 0);
+	void readDoubleArray(double *buf,size_t n,const char *label = 0);
 	OId readObjectId(const char *label = 0);
 	void readObject(OPersist **obp,const char *label = 0);
 	OPersist *readObject(const char *label = 0);
@@ -223,7 +291,7 @@ public:
 	void open(const char *fname,long operation);
 	OFilePos_t fileLength(){ return o_fileLength(_fd);}
 
-	void start(OFilePos_t mark,long size);
+	void start(OFilePos_t mark,long size,bool compressed = false,const OSYS_ULONG32 *crc = 0);
 	void finish(void);
 	void abort(void);
 
@@ -242,20 +310,33 @@ public:
 	void endObject(void){}
 
 	OFile *file(void)const{return _file;}
+	ORawOrder rawOrder(void)const;
+
+	// Read integers in the compact encoding.
+	void setCompact(bool compact){_compact = compact;}
 
 protected:
 	OFile *_file;
 
 private:
+	OSYS_ULONG64 readVarint(void);
+	void readSwapped(void *buf,size_t n,int size);
+	const char *readView(size_t size);
+	char *readImage(OFilePos_t mark,long size,bool compressed,const OSYS_ULONG32 *crc,long *length);
+	void restore(const StrmInfo &info);
+
 	OSPtrStack _readObjects;
+	OSmartPtrs _smartPtrs;
 	OIBuffer _ostr;
 	O_fd _fd;
 	OFilePos_t _mark;
 	long _toRead;
 	bool _ownsFile;	  // Stream owns the file stream
 	bool _fileOpen;   // State of file stream
-	char *_returnString;
-	O_WCHAR_T *_wreturnString;
+	bool _compact;    // Integers are variable length
+	char *_image;     // Decompressed object being read. 0 if none
+	long _imageLength;
+	long _imagePos;
 #ifndef OF_MULTI_THREAD
 	// There can never be two readfunctions running simulultaneously,so
 	// save space by making all the streams share the same return buffer
@@ -279,7 +360,21 @@ public:
 	static void swap32(char *);
 	static void swap64(char *);
 	static void swapFilePos(char *);
+	// Swap n values from src to dst, which may be the same.
+	static void swapArray16(void *dst,const void *src,size_t n);
+	static void swapArray32(void *dst,const void *src,size_t n);
+	static void swapArray64(void *dst,const void *src,size_t n);
 	static const unsigned char	cInvertedBits[256];
+
+	// Variable length integers(LEB128) of the compact encoding. Signed
+	// values are zigzag encoded so that small negative numbers stay short.
+	enum {cMaxVarintLength = 10};
+	static int varintLength(OSYS_ULONG64 v);
+	static int encodeVarint(OSYS_ULONG64 v,unsigned char *buf);
+	static OSYS_ULONG64 zigzag(OSYS_LONG64 v)
+		{return ((OSYS_ULONG64)v << 1) ^ (OSYS_ULONG64)(v >> 63);}
+	static OSYS_LONG64 unzigzag(OSYS_ULONG64 v)
+		{return (OSYS_LONG64)(v >> 1) ^ -(OSYS_LONG64)(v & 1);}
 };
 
 #endif
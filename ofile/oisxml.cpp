@@ -39,6 +39,7 @@ SOFTWARE.
 #include <string.h>
 #include <stdlib.h>
 #include <ctype.h>
+#include <string>
 #include "oisxml.h"
 #include "ofile.h"
 #include "ometa.h"
@@ -52,11 +53,9 @@ OIStreamXML::StrBuffT OIStreamXML::_strBuffer;
 #endif
 
 OIStreamXML::OIStreamXML(OFile *file, std::istream &in):
-						   _file(file),
+						   OIStreamImport(file),
 						   _in(in),
 						   _blobHandler(0),
-						   _currentOId(0),
-						   _uniqueId(0),
 						   _returnString(0),
 						   _wreturnString(0)
 // Constructor
@@ -307,17 +306,6 @@ void ByteHandler::characters(const XMLCh *characters,int len)
 { 
 	for(int i = 0;i<len; i++)
 	{
-		// Check that we have not exceded the expected number of bytes.
-		if (_len > _maxLen)
-		{
-			throw OFileErr("Too many bytes.");
-		}
-
-		// Initialize the byte
-		if (_first)
-		{
-			_bufp[_len] = 0;
-		}
         // Ignore case
 		XMLCh hex = (unsigned char)tolower(characters[i]);
 		if(hex >= '0' && hex <= '9')
@@ -347,7 +335,17 @@ void ByteHandler::characters(const XMLCh *characters,int len)
 		}
 		if(_hexFound)
 		{
-			if (!_first)
+			if (_first)
+			{
+				// Check that we have not exceded the expected number of bytes.
+				if (_len >= _maxLen)
+				{
+					throw OFileErr("Too many bytes.");
+				}
+				// Initialize the byte
+				_bufp[_len] = 0;
+			}
+			else
 			{
 				// Shift the lower nibble up.
 				_bufp[_len] <<= 4;
@@ -359,6 +357,66 @@ void ByteHandler::characters(const XMLCh *characters,int len)
 
 	}
 }
+
+class ArrayHandler: public PrimitiveHandler
+// Handles arrays of values separated by whitespace.
+{
+public:
+	ArrayHandler(const char *label):PrimitiveHandler(label,0),_pos(0){}
+	void characters(const XMLCh *characters,int len);
+	const char *next(void);
+	void end(void);
+	std::string _text; // Text of the element
+	size_t _pos;       // Position of the next value in _text
+	char _value[64];   // The current value
+};
+
+void ArrayHandler::characters(const XMLCh *characters,int len)
+{
+	for (int i = 0; i < len; i++)
+	{
+		_text += (char)characters[i];
+	}
+}
+
+const char *ArrayHandler::next(void)
+// Return the next value.
+{
+	while(_pos < _text.size() && isspace((unsigned char)_text[_pos]))
+	{
+		_pos++;
+	}
+	if(_pos == _text.size())
+	{
+		throw OFileErr("Too few values in array.");
+	}
+
+	size_t len = 0;
+	while(_pos < _text.size() && !isspace((unsigned char)_text[_pos]))
+	{
+		if(len == sizeof(_value) - 1)
+		{
+			throw OFileErr("Invalid value in array.");
+		}
+		_value[len++] = _text[_pos++];
+	}
+	_value[len] = 0;
+	return _value;
+}
+
+void ArrayHandler::end(void)
+// Check that there are no more values.
+{
+	while(_pos < _text.size() && isspace((unsigned char)_text[_pos]))
+	{
+		_pos++;
+	}
+	if(_pos != _text.size())
+	{
+		throw OFileErr("Too many values in array.");
+	}
+}
+
 class WPrimitiveHandler: public BasicHandler
 // Handles wide character strings.
 {
@@ -415,7 +473,7 @@ void WPrimitiveHandler::characters(const XMLCh *characters,int len)
 class DocumentHandler: public BasicHandler
 {
 public:
-	DocumentHandler():BasicHandler(0),_start(false){}
+	DocumentHandler():BasicHandler(0),_start(false),_rootId(0){}
 	void startElement(const XMLCh *localName,OAttributes *_attributes);
 	void endElement(const XMLCh *localName){OFILE_UNUSED(localName);}
 	void characters(const XMLCh *characters,int len){OFILE_UNUSED(characters);OFILE_UNUSED(len);}
@@ -476,82 +534,38 @@ void OIStreamXML::readObjects(OClassId_t classId,bool deep)
 // When a parser error is encountered an OFileErr exception is thrown. The stream
 // position of the error is obtained by the methods get getLine() and getColumn().
 // The column position treats tabs as a single character.
+// In streaming mode each object is attached as soon as it has been read, and
+// each outermost object is then made purgeable. Objects that have been attached
+// before an error stay in the file. References to objects that are already in
+// the file are resolved by OFile::getObject(), so a referenced object stays in
+// memory until the application makes it purgeable.
+// A reference to an object further on in the document can only be resolved if
+// it is read by readObject(OPersist **). It is set when the object is read.
 {
-	oFAssert(_file);
-
 	DocumentHandler h;
 	_reader.setContentHandler(&h);
+	beginImport(classId,deep);
 
 	try
 	{
 		// Find the start of the document.
-		while (!h._start)
+		bool more = _reader.parseFirst(&_in);
+		while (!h._start && more)
 		{
-			_reader.parseFirst(&_in);
+			more = _reader.parseNext();
 		}
 
 		// Read objects untill none is found.
-		while(readObject());
+		OPersist *ob;
+		while((ob = readObject()) != 0)
+			topObjectRead(ob);
 
 	}catch(...){
-		// Delete all objects that were read so far.
-		for(ObjectList::const_iterator it = _readObjects.begin(); it != _readObjects.end();++it)
-		{
-			delete (*it).second;
-		}
-		// Clear list.
-    	_readObjects.erase(_readObjects.begin(),_readObjects.end());
+		abortImport();
 		throw;
 	}
 
-		// Attach objects to file
-	for(ObjectList::const_iterator it = _readObjects.begin(); it != _readObjects.end();++it)
-	{
-		// If deep then check if the class is in the hierarchy otherwise check
-		// for an exact match.
-		if ((deep && (*it).second->meta()->isA(classId)) || (!deep && (*it).second->meta()->id() == classId))
-		{
-			_file->attach((*it).second, false);
-		}
-		else
-		{
-			delete (*it).second;
-		}
-	}
-
-	// Find and set the root if there is one.
-	ObjectList::iterator oret = _readObjects.find(h._rootId);
-	if (_readObjects.end() != oret)
-	{
-		_file->setRoot((*oret).second);
-	}
-}
-
-// Return the version of this file.
-long OIStreamXML::userVersion(void)const
-{
-	return _userVersion;
-}
-
-// Return the version of the source code.
-long OIStreamXML::userSourceVersion(void)const
-{
-	return _file->userSourceVersion();
-}
-
-void OIStreamXML::setCurrentObject(OPersist *ob)
-// Set the currently being read object to ob. This allows any references
-// to the object to be resolved even though it is still being read.
-// Called before any of the object is read.
-{
-	// If there is no object if then invent one;
-	if(!_currentOId)
-	{
-		while(!_readObjects.count(++_uniqueId));
-
-		_currentOId = _uniqueId;
-	}	
-	_readObjects.insert(ObjectList::value_type(_currentOId,ob));
+	endImport(h._rootId);
 }
 
 O_LONG OIStreamXML::readLong(const char *label)
@@ -846,6 +860,132 @@ void OIStreamXML::readBits(void *buf,int len,const char *label)
 	}
 }
 
+OView OIStreamXML::readStringView(const char *label)
+// Read a string.
+// Parameters: label - label describing the element.
+// Return value: A view of the string, which is valid until the read
+// constructor returns.
+{
+	char *str = readCString(label);
+	addView(str);
+	return OView(str,strlen(str));
+}
+
+OView OIStreamXML::readBytesView(size_t len,const char *label)
+// Read a number of bytes.
+// Parameters: len - number of bytes to read.
+//			   label - label describing the element.
+// Return value: A view of the bytes, which is valid until the read
+// constructor returns.
+{
+	char *buf = new char[len ? len : 1];
+	addView(buf);
+	readBytes(buf,(int)len,label);
+	return OView(buf,len);
+}
+
+void OIStreamXML::readShortArray(O_SHORT *buf,size_t n,const char *label)
+// Read an array of two byte words written as one element.
+// Parameters: label - label describing the element.
+{
+	ArrayHandler h(label);
+	_reader.setContentHandler(&h);
+
+	while (h._got != h.cFinished)
+	{
+		parseNext();
+	}
+	for(size_t i = 0; i < n; i++)
+	{
+		buf[i] = (O_SHORT)atoi(h.next());
+	}
+	h.end();
+}
+
+void OIStreamXML::readLongArray(O_LONG *buf,size_t n,const char *label)
+// Read an array of long words written as one element.
+// Parameters: label - label describing the element.
+{
+	ArrayHandler h(label);
+	_reader.setContentHandler(&h);
+
+	while (h._got != h.cFinished)
+	{
+		parseNext();
+	}
+	for(size_t i = 0; i < n; i++)
+	{
+		buf[i] = strtol(h.next(),0,10);
+	}
+	h.end();
+}
+
+void OIStreamXML::readLong64Array(O_LONG64 *buf,size_t n,const char *label)
+// Read an array of 64 bit long words written as one element.
+// Parameters: label - label describing the element.
+{
+	ArrayHandler h(label);
+	_reader.setContentHandler(&h);
+
+	while (h._got != h.cFinished)
+	{
+		parseNext();
+	}
+	for(size_t i = 0; i < n; i++)
+	{
+		// Convert here, as not every library has a 64 bit strtol.
+		const char *p = h.next();
+		bool negative = (*p == '-');
+		if(negative || *p == '+')
+		{
+			p++;
+		}
+		OSYS_ULONG64 v = 0;
+		for(; isdigit((unsigned char)*p); p++)
+		{
+			v = v*10 + (*p - '0');
+		}
+		buf[i] = negative ? -(O_LONG64)v : (O_LONG64)v;
+	}
+	h.end();
+}
+
+void OIStreamXML::readFloatArray(float *buf,size_t n,const char *label)
+// Read an array of floats written as one element.
+// Parameters: label - label describing the element.
+{
+	ArrayHandler h(label);
+	_reader.setContentHandler(&h);
+
+	while (h._got != h.cFinished)
+	{
+		parseNext();
+	}
+	for(size_t i = 0; i < n; i++)
+	{
+		buf[i] = (float)atof(h.next());
+	}
+	h.end();
+}
+
+void OIStreamXML::readDoubleArray(double *buf,size_t n,const char *label)
+// Read an array of doubles written as one element.
+// Parameters: label - label describing the element.
+{
+	ArrayHandler h(label);
+	_reader.setContentHandler(&h);
+
+	while (h._got != h.cFinished)
+	{
+		parseNext();
+	}
+	for(size_t i = 0; i < n; i++)
+	{
+		buf[i] = atof(h.next());
+	}
+	h.end();
+}
+
 void OIStreamXML::beginObject(const char *label)
 // Indicate the start of a containing object
 {
@@ -866,22 +1006,17 @@ void OIStreamXML::endObject(void)
     parseNext();
 }
 
-void OIStreamXML::readObject(OPersist **obp,const char *label)
-// Read an object deferred until finish()
-// Parameter: Address of a pointer in which to place the reference to the
-//            object. Reference is only written when finish() is called.
-{
-	// No reason to defer as it is next in the stream.
-	*obp = readObject(label);
-}
-
-OPersist *OIStreamXML::readObject(const char *label)
+OPersist *OIStreamXML::readObjectOrRef(const char *label,OId *forwardId)
+// Private.
 // Read an object or object reference. 
-// Return value: Pointer to object or 0 if null reference.
+// Return value: Pointer to object or 0 if null reference, or if the reference
+// is to an object that has not yet been read. In this case *forwardId is set to
+// its identity, otherwise to 0.
 {
 	OPersist *ob = 0;
 	ObjectHandler h(label);
 	_reader.setContentHandler(&h);
+	*forwardId = 0;
 
 	do
 	{
@@ -895,32 +1030,23 @@ OPersist *OIStreamXML::readObject(const char *label)
 	if(h._obj && h._objType)
 	{
 		// Instance
-
-		OMeta *meta = OMeta::meta(h._objType);
-		_currentOId = h._objOId;
-		_userVersion = h._objVersion;
-		try
-		{
-			ob =  meta->construct(*this);
-		}catch(...){
-			// Abort reading of this object.
-			_readObjects.erase(h._objOId);
-			// clean the index, because the object was not constructed.
-			throw;
-		}
+		ob = construct(h._objType,h._objOId,h._objVersion);
 		// Parse the end tag.  Must set a new handler because contructing the object
 		// caused other handlers to be set.
 		ObjectHandler h1(label);
 		_reader.setContentHandler(&h1);
 		parseNext();
+
+		objectRead(h._objOId,ob);
 	}
 	else
 	{
 		if(h._objOId)
 		{
 			// Reference
-			ObjectList::iterator ret= _readObjects.find(h._objOId);
-			ob = (*ret).second;
+			ob = findObject(h._objOId);
+			if(!ob)
+				*forwardId = h._objOId;
 		}
 		else
 		{
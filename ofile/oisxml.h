@@ -25,23 +25,14 @@ SOFTWARE.
 =============================================================================*/
 
 
-#include <map>
-#include "oistrm.h"
+#include "oisimport.h"
 #include "oxmlreader.h"
 
 // OIStreamXML is a concrete subclass of OIStream. 
 
-#ifdef OFILE_STD_IN_NAMESPACE
-using std::map;
-using std::less;
-#endif
-
 class BLOBHandler;
 
-class OIStreamXML: public OIStream {
-
-
-typedef map<OId,OPersist *,less<OId > > ObjectList;
+class OIStreamXML: public OIStreamImport {
 
 
 public:
@@ -77,41 +68,32 @@ private:
 	//
 	void readBytes(void *buf,int nBytes,const char *label = 0);
 	void readBits(void *buf,int nBytes,const char *label = 0);
+	OView readStringView(const char *label = 0);
+	OView readBytesView(size_t nBytes,const char *label = 0);
+	void readShortArray(O_SHORT *buf,size_t n,const char *label = 0);
+	void readLongArray(O_LONG *buf,size_t n,const char *label = 0);
+	void readLong64Array(O_LONG64 *buf,size_t n,const char *label = 0);
+	void readFloatArray(float *buf,size_t n,const char *label = 0);
+	void readDoubleArray(double *buf,size_t n,const char *label = 0);
 	OId readObjectId(const char *label = 0);
-	void readObject(OPersist **obp,const char *label = 0);
-	OPersist *readObject(const char *label = 0);
 	void readBlob(void *buf,OFilePos_t mark,unsigned long size);
 	OFile *readBlobHeader(OFilePos_t *mark,oulong *blobLength,
 								oulong *fileLength,const char *label = 0);
 
 	void finish(void);
 
-	// Return the version of this file.
-	long userVersion(void)const;
-	// Return the version of the source code.
-	long userSourceVersion(void)const;
-
-	void setCurrentObject(OPersist *p);
-
 	void beginObject(const char *label);
 	void endObject(void);
 
-	// This stream does not read directly into a file.
-	OFile *file(void)const{return 0;}
-
 private:
 	void parseNext();
+	OPersist *readObjectOrRef(const char *label,OId *forwardId);
 
 private:
-	OFile *_file;			 // File to which objects are added.
 	OXMLReader _reader;
 	std::istream &_in;			  // Input stream
 
 	BLOBHandler *_blobHandler;
-	ObjectList _readObjects;  // List of objects that have been read.
-	OId _currentOId;
-	long _userVersion;        // The version of the currently read object.
-	OId _uniqueId;			  // Used to generate OId's for objects that do not have them.
 	char *_returnString;
 	O_WCHAR_T *_wreturnString;
 #ifndef OF_MULTI_THREAD
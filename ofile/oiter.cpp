@@ -25,8 +25,13 @@ SOFTWARE.
 // The iterator can be beyond the last object. In this case 0 is returned.
 
 #include "odefs.h"
+#include <algorithm>
 #include "oiter.h"
 
+#ifdef OFILE_STD_IN_NAMESPACE
+using std::stable_sort;
+#endif
+
 OIterator::OIterator(OFile *oFile,OClassId_t classId,bool deep):
 									_classes(OMeta::meta(classId)->classes(deep)),
 									_oFile(oFile)
@@ -159,3 +164,87 @@ OPersist* OIterator::operator++(int)  // postfix a++
 
 	return p;
 }
+
+
+OScanIterator::OScanIterator(OFile *oFile,OClassId_t classId,bool deep):
+									_classes(OMeta::meta(classId)->classes(deep)),
+									_oFile(oFile),
+									_pos(0)
+// Constructor sets iterator to the object of class id classId, or its
+// subclasses, that is first in the file.
+{
+	reset();
+}
+
+
+bool OScanIterator::ScanEnt::operator<(const ScanEnt &s)const
+// Order by position in file. Objects not yet written(mark 0) go last.
+{
+	if(_mark == 0)
+		return false;
+	if(s._mark == 0)
+		return true;
+	return _mark < s._mark;
+}
+
+
+void OScanIterator::reset(void)
+// Collect the objects of the requested classes and sort them into file order.
+// Set to first object.
+{
+	_order.clear();
+	_pos = 0;
+
+	OMeta::Classes::const_iterator cSetIt;
+	for(cSetIt = _classes.begin();cSetIt != _classes.end();cSetIt++)
+	{
+		OFile::ClassList &cl = _oFile->_cList.classList(*cSetIt);
+		for(OFile::ClassList::iterator it = cl.begin();it != cl.end();it++)
+			_order.push_back(ScanEnt((*it).second._mark,*cSetIt,it));
+	}
+	// Stable so that unwritten objects keep their class and id order.
+	stable_sort(_order.begin(),_order.end());
+}
+
+
+OPersist* OScanIterator::begin(void)
+// Return the first object in file order, without moving the iterator.
+// Adds a reference to the object.
+{
+	if(_order.empty())
+		return 0;
+	return _oFile->getObject(_order[0]._it,_order[0]._cId);
+}
+
+
+OPersist* OScanIterator::operator*()
+// Return the object at the current position.
+// Adds a reference to the object.
+{
+	if(_pos < _order.size())
+		return _oFile->getObject(_order[_pos]._it,_order[_pos]._cId);
+	else
+		return 0;
+}
+
+
+OPersist* OScanIterator::operator++()     // prefix ++a
+// Increment the iterator and return the object at the new position.
+// Adds a reference to the object.
+{
+	if(_pos < _order.size())
+		_pos++;
+	return operator*();
+}
+
+
+OPersist* OScanIterator::operator++(int)  // postfix a++
+// Return the object at the current position and increment the iterator.
+// Adds a reference to the object.
+{
+	OPersist *p = operator*();
+
+	if(_pos < _order.size())
+		_pos++;
+	return p;
+}
@@ -26,9 +26,14 @@ SOFTWARE.
 
 
 
+#include <vector>
 #include "ofile.h"
 #include "ometa.h"
 
+#ifdef OFILE_STD_IN_NAMESPACE
+using std::vector;
+#endif
+
 class OIterator{
 public:
 
@@ -75,6 +80,63 @@ public:
 
 };
 
+
+class OScanIterator{
+// Iterates over the same objects as OIterator, but yields them in ascending
+// order of their position in the file. Reading a whole file in this order
+// turns a full scan into a sequential read of the file. Objects that have not
+// yet been written to the file are yielded last.
+// The order is taken when the iterator is constructed or reset. Objects
+// attached afterwards are not seen, and objects must not be detached while
+// the iterator is in use.
+public:
+
+	OScanIterator(OFile *ofile,OClassId_t classId = cOPersist,bool deep = true);
+	void reset(void);
+	OPersist *begin(void);
+
+	OPersist* operator*();
+	OPersist* operator++();     // prefix  ++a
+	OPersist* operator++(int);  // postfix  a++
+
+private:
+	class ScanEnt{
+	public:
+		ScanEnt(OFilePos_t mark,OClassId_t cId,OFile::ClassList::iterator it):
+						_mark(mark),_cId(cId),_it(it){}
+		bool operator<(const ScanEnt &s)const;
+
+		OFilePos_t _mark;
+		OClassId_t _cId;
+		OFile::ClassList::iterator _it;
+	};
+
+	const OMeta::Classes &_classes;
+	OFile *_oFile;
+	vector<ScanEnt> _order;
+	size_t _pos;
+};
+
+
+// Template to allow typesafe access to the scan iterator.
+template <class T,OClassId_t TcId>
+class OScanIteratorT: public OScanIterator{
+public:
+
+	OScanIteratorT(OFile *ofile,bool deep = true):
+		OScanIterator(ofile,TcId,deep){}
+
+	void reset(void){OScanIterator::reset();}
+
+	// dynamic_cast is required to cast to a sub-class of a virtual base.
+	T *begin(void){return dynamic_cast<T *>(OScanIterator::begin());}
+
+	T* operator*(){return dynamic_cast<T *>(OScanIterator::operator*());}
+	T* operator++(){return dynamic_cast<T *>(OScanIterator::operator++());}     // prefix  ++a
+	T* operator++(int i){return dynamic_cast<T *>(OScanIterator::operator++(i));}  // postfix  a++
+
+};
+
 #endif
 
 
@@ -0,0 +1,219 @@
+/*=============================================================================
+MIT License
+
+Copyright(c) 2019 willywood
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+=============================================================================*/
+
+// The compressor is greedy. It finds matches with a hash table of the
+// last position of each 4 byte sequence. It is fast rather than thorough,
+// because it is used on each object as it is written.
+
+#include "odefs.h"
+#include <string.h>
+#include "olz.h"
+
+// Minimum length of a match.
+const long cMinMatch = 4;
+// The last bytes are always literals.
+const long cLastLiterals = 5;
+// Largest offset of a match.
+const long cMaxOffset = 65535;
+// Hash table size is 2 to the power of cHashLog.
+const int cHashLog = 12;
+// The table is cleared when the base would pass this.
+const long cMaxBase = 0x3FFFFFFFL;
+
+static inline unsigned long read32(const unsigned char *p)
+{
+	uint32_t v;
+	memcpy(&v,p,4);
+	return v;
+}
+
+static inline unsigned int hash(const unsigned char *p)
+{
+	return (unsigned int)((read32(p)*2654435761U) & 0xFFFFFFFFU) >> (32 - cHashLog);
+}
+
+static bool writeCount(unsigned char *&op,const unsigned char *oend,long count)
+// Write the continuation bytes of a count of 15 or more.
+{
+	for(count -= 15; count >= 255; count -= 255)
+	{
+		if(op >= oend)
+			return false;
+		*op++ = 255;
+	}
+	if(op >= oend)
+		return false;
+	*op++ = (unsigned char)count;
+	return true;
+}
+
+static bool writeSequence(unsigned char *&op,const unsigned char *oend,
+						  const unsigned char *literals,long nLiterals,
+						  long offset,long matchLength)
+// Write a sequence. A matchLength of 0 is the last sequence.
+{
+	if(op >= oend)
+		return false;
+	unsigned char *token = op++;
+	*token = (unsigned char)((nLiterals < 15 ? nLiterals : 15) << 4);
+	if(nLiterals >= 15 && !writeCount(op,oend,nLiterals))
+		return false;
+
+	if(oend - op < nLiterals)
+		return false;
+	memcpy(op,literals,nLiterals);
+	op += nLiterals;
+
+	if(matchLength)
+	{
+		if(oend - op < 2)
+			return false;
+		*op++ = (unsigned char)offset;
+		*op++ = (unsigned char)(offset >> 8);
+
+		long m = matchLength - cMinMatch;
+		*token |= (unsigned char)(m < 15 ? m : 15);
+		if(m >= 15 && !writeCount(op,oend,m))
+			return false;
+	}
+	return true;
+}
+
+long OLZ::compress(const char *srcc,long n,char *dstc,long dstCapacity)
+// Compress srcLength bytes from src into dst.
+// Return the compressed length, or 0 if it does not fit in dstCapacity bytes.
+{
+	const unsigned char *src = (const unsigned char *)srcc;
+	unsigned char *op = (unsigned char *)dstc;
+	const unsigned char *oend = op + dstCapacity;
+
+	// Entries at or below the base are from earlier calls, so the table
+	// only has to be cleared when the base gets too big.
+	if(!_table || _base > cMaxBase - n)
+	{
+		if(!_table)
+			_table = new long[1 << cHashLog];
+		memset(_table,0,sizeof(long) << cHashLog);
+		_base = 0;
+	}
+	long *table = _table;
+	const long base = _base;
+	_base += n;
+
+	long anchor = 0;   // Start of pending literals
+	long ip = 0;
+	const long limit = n - cLastLiterals;
+
+	while(ip + cMinMatch <= limit)
+	{
+		unsigned int h = hash(src + ip);
+		long ref = table[h] - 1 - base;
+		table[h] = ip + 1 + base;
+
+		if(ref >= 0 && ip - ref <= cMaxOffset && read32(src + ref) == read32(src + ip))
+		{
+			long length = cMinMatch;
+			while(ip + length < limit && src[ref + length] == src[ip + length])
+				length++;
+
+			if(!writeSequence(op,oend,src + anchor,ip - anchor,ip - ref,length))
+				return 0;
+			ip += length;
+			anchor = ip;
+		}
+		else
+			ip++;
+	}
+
+	if(!writeSequence(op,oend,src + anchor,n - anchor,0,0))
+		return 0;
+
+	return (long)(op - (unsigned char *)dstc);
+}
+
+static bool readCount(const unsigned char *&ip,const unsigned char *iend,long &count)
+// Add the continuation bytes of a count to count.
+{
+	unsigned char b;
+	do
+	{
+		if(ip >= iend)
+			return false;
+		b = *ip++;
+		count += b;
+	}while(b == 255);
+	return true;
+}
+
+bool OLZ::decompress(const char *srcc,long srcLength,char *dstc,long dstLength)
+// Decompress srcLength bytes from src into dst, which must be exactly
+// dstLength bytes long when decompressed.
+// Return false if the data is not valid.
+{
+	const unsigned char *ip = (const unsigned char *)srcc;
+	const unsigned char *iend = ip + srcLength;
+	unsigned char *dst = (unsigned char *)dstc;
+	unsigned char *op = dst;
+	unsigned char *oend = dst + dstLength;
+
+	while(ip < iend)
+	{
+		unsigned char token = *ip++;
+
+		// Literals
+		long count = token >> 4;
+		if(count == 15 && !readCount(ip,iend,count))
+			return false;
+		if(iend - ip < count || oend - op < count)
+			return false;
+		memcpy(op,ip,count);
+		ip += count;
+		op += count;
+
+		// The last sequence has no match.
+		if(ip == iend)
+			break;
+
+		// Match
+		if(iend - ip < 2)
+			return false;
+		long offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if(offset == 0 || offset > op - dst)
+			return false;
+
+		count = token & 15;
+		if(count == 15 && !readCount(ip,iend,count))
+			return false;
+		count += cMinMatch;
+		if(oend - op < count)
+			return false;
+
+		// Copy byte by byte because the match may overlap the output.
+		const unsigned char *m = op - offset;
+		while(count--)
+			*op++ = *m++;
+	}
+	return op == oend;
+}
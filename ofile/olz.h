@@ -0,0 +1,53 @@
+#ifndef OLZ_H
+#define OLZ_H
+/*=============================================================================
+MIT License
+
+Copyright(c) 2019 willywood
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+=============================================================================*/
+
+
+
+class OLZ
+// A small LZ77 compressor. The format is that of an LZ4 block. A sequence
+// is a token byte(literal count in the high nibble, match length - 4 in
+// the low nibble), extra literal count bytes, the literals, a two byte
+// offset and extra match length bytes. A count of 15 in a nibble is
+// continued by bytes of 255 ending with one below 255.
+// The last sequence has only literals.
+// A compressor keeps its hash table from one call to the next, so that it
+// is not allocated and cleared for each object.
+{
+public:
+	OLZ(void):_table(0),_base(0){}
+	~OLZ(void){delete []_table;}
+	long compress(const char *src,long srcLength,char *dst,long dstCapacity);
+	static bool decompress(const char *src,long srcLength,char *dst,long dstLength);
+
+private:
+	OLZ(const OLZ &);
+	OLZ &operator=(const OLZ &);
+
+	long *_table; // Positions + 1 + _base of the last occurence of each hash
+	long _base;   // Positions from earlier calls are at or below _base
+};
+
+#endif
@@ -0,0 +1,428 @@
+/*=============================================================================
+MIT License
+
+Copyright(c) 2019 willywood
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+=============================================================================*/
+///////////////////////////////////////////////////////////////////////////
+// OOStreamBinary is a concrete subclass of OOStream. 
+// It writes objects in the binary interchange format(see obinfmt.h).
+// The overridden write functions are designed to be called from the oWrite()
+// methods of persistent objects (that are derived from OPersist). Each one
+// writes a tagged record with the index of its label in the string table.
+// The data is collected in a buffer and written to the output stream when it
+// is full.
+///////////////////////////////////////////////////////////////////////////
+#include "odefs.h"
+#include <string.h>
+#include "oosbin.h"
+#include "ofile.h"
+#include "opersist.h"
+#include "ometa.h"
+#include "ox.h"
+#include "oiter.h"
+
+OOStreamBinary::OOStreamBinary(OFile *file,std::ostream &out):
+							OOStream(0),
+							_out(out),
+							_fromFile(file),
+							_used(0)
+// Constructor
+// file - OFile from which to take the objects to be written.
+// out - stream to which to write the objects.
+{
+}
+
+OOStreamBinary::~OOStreamBinary(void)
+{
+}
+
+void OOStreamBinary::beginDocument(const char *appName)
+// Write the start of a document of name appName(may be 0).
+// The document should be terminated by calling endDocument().
+{
+	writeData(OBinaryFormat::magic(),4);
+	writeByte(OBinaryFormat::cVersion);
+	OSYS_ULONG32 order = OBinaryFormat::cByteOrder;
+	writeData(&order,4);
+	writeVarint(_fromFile && _fromFile->getRoot() ? _fromFile->getRoot()->oId() : 0);
+	writeString(appName ? appName : "",appName ? strlen(appName) : 0);
+}
+
+void OOStreamBinary::endDocument(void)
+// Terminate a document that was begun with beginDocument, and write it to
+// the output stream.
+{
+	writeByte(OBinaryFormat::cEnd);
+	flush();
+}
+
+void OOStreamBinary::writeObjectAsBinary(OPersist *ob)
+// Write the given object.
+// Exceptions: Throws OFileError if there is an output stream error.
+{
+	const char *className = ob->meta()->className(ob);
+	unsigned long name = className ? stringIndex(className) : 0;
+
+	writeTag(OBinaryFormat::cObject,0);
+	writeVarint(ob->meta()->id());
+	writeVarint(name);
+	writeVarint(ob->oId());
+	writeVarint(OFile::userSourceVersion());
+
+	// virtual base has not been written
+	_VBWritten = false;
+
+	ob->oWrite(this);
+	writeByte(OBinaryFormat::cEnd);
+}
+
+void OOStreamBinary::writeObjects(const char *appName,
+								OClassId_t classId,
+								bool deep)
+// Write all the objects in file of class classId. Also their sub-classes
+// if deep is true(default = true), as a document of name appName(may be 0).
+// Exceptions: Throws OFileError if there is an output stream error.
+{
+	oFAssert(_fromFile);
+
+	try
+	{
+		beginDocument(appName);
+
+		// Read in file order so that the file is read sequentially.
+		OScanIterator it(_fromFile,classId,deep);
+		OPersist *ob;
+
+		while((ob = it++))
+		{
+			writeObjectAsBinary(ob);
+		}
+		endDocument();
+	}catch(...)
+	{
+		// Discard what has not been written.
+		_used = 0;
+		throw;
+	}
+}
+
+void OOStreamBinary::flush(void)
+// Write the buffered data to the output stream.
+// Exceptions: Throws OFileError if there is an output stream error.
+{
+	if(_used)
+	{
+		_out.write(_buf,_used);
+		_used = 0;
+	}
+	if(_out.fail())
+		throw OFileIOErr("Output stream error.");
+}
+
+void OOStreamBinary::writeData(const void *buf,size_t size)
+// Private.
+// Write size bytes. Large data goes straight to the output stream.
+{
+	if(_used + size > cBufferSize)
+	{
+		flush();
+		if(size >= cBufferSize)
+		{
+			_out.write((const char *)buf,size);
+			return;
+		}
+	}
+	memcpy(&_buf[_used],buf,size);
+	_used += size;
+}
+
+void OOStreamBinary::writeVarint(OSYS_ULONG64 v)
+// Private.
+// Write an unsigned integer in as few bytes as possible(LEB128).
+{
+	if(_used + OUtilityFunction::cMaxVarintLength > cBufferSize)
+		flush();
+	_used += OUtilityFunction::encodeVarint(v,(unsigned char *)&_buf[_used]);
+}
+
+void OOStreamBinary::writeString(const char *str,size_t len)
+// Private.
+// Write the length of a string followed by its characters.
+{
+	writeVarint(len);
+	writeData(str,len);
+}
+
+unsigned long OOStreamBinary::stringIndex(const char *str)
+// Private.
+// Return the index of str in the string table. If it is not yet in the
+// table then add it and write its definition.
+{
+	// Labels are nearly always literals, so first look for the address.
+	LabelCache::iterator lit = _labels.find(str);
+	if(_labels.end() != lit && strcmp(_table[(*lit).second - 1],str) == 0)
+		return (*lit).second;
+
+	ofile_string s(str);
+	Dictionary::iterator it = _strings.find(s);
+	unsigned long index;
+	if(_strings.end() == it)
+	{
+		index = (unsigned long)_table.size() + 1;
+		it = _strings.insert(Dictionary::value_type(s,index)).first;
+		_table.push_back((*it).first.c_str());
+
+		writeByte(OBinaryFormat::cDefine);
+		writeString(str,strlen(str));
+	}
+	else
+	{
+		index = (*it).second;
+	}
+	_labels[str] = index;
+	return index;
+}
+
+void OOStreamBinary::writeTag(OBinaryFormat::Tag tag,const char *label)
+// Private.
+// Start a record.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	unsigned long index = label ? stringIndex(label) : 0;
+	writeByte((char)tag);
+	writeVarint(index);
+}
+
+void OOStreamBinary::beginObject(const char *label)
+// Indicate the start of a containing object
+{
+	writeTag(OBinaryFormat::cBegin,label);
+}
+
+void OOStreamBinary::endObject(void)
+// End of a containing object
+{
+	writeByte(OBinaryFormat::cEnd);
+}
+
+void OOStreamBinary::writeLong(O_LONG data, const char *label)
+// Write a long word.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeTag(OBinaryFormat::cInt,label);
+	writeInteger(data);
+}
+
+void OOStreamBinary::writeLong64(O_LONG64 data, const char *label)
+// Write a 64 bit long word.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeTag(OBinaryFormat::cInt,label);
+	writeInteger(data);
+}
+
+void OOStreamBinary::writeShort(O_SHORT data, const char *label)
+// Write a two byte word.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeTag(OBinaryFormat::cInt,label);
+	writeInteger(data);
+}
+
+void OOStreamBinary::writeFloat(float data, const char *label)
+// Write a float (4 bytes)
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeTag(OBinaryFormat::cFloat,label);
+	writeData(&data,4);
+}
+
+void OOStreamBinary::writeDouble(double data, const char *label)
+// Write a double (8 bytes)
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeTag(OBinaryFormat::cDouble,label);
+	writeData(&data,8);
+}
+
+void OOStreamBinary::writeChar(char data, const char *label)
+// Write a single byte character.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeTag(OBinaryFormat::cChar,label);
+	writeByte(data);
+}
+
+void OOStreamBinary::writeBool(bool data, const char *label)
+// Write a bool.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeTag(OBinaryFormat::cBool,label);
+	writeByte(data ? 1 : 0);
+}
+
+void OOStreamBinary::writeCString(const char * str, const char *label)
+// Write a null terminated string.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeTag(OBinaryFormat::cString,label);
+	writeString(str,strlen(str));
+}
+
+void OOStreamBinary::writeCString256(const char * str, const char *label)
+// Write a null terminated string of up to 255 characters.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeCString(str,label);
+}
+
+void OOStreamBinary::writeWChar(O_WCHAR_T data, const char *label)
+// Write a wide character.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeTag(OBinaryFormat::cWChar,label);
+	writeVarint((OSYS_ULONG32)data);
+}
+
+void OOStreamBinary::writeWCString(const O_WCHAR_T * str, const char *label)
+// Write a null terminated wide character string.
+// Each character is written as an integer, so that the string can be read
+// where O_WCHAR_T has another size.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	size_t len = 0;
+	while(str[len])
+		len++;
+	writeTag(OBinaryFormat::cWString,label);
+	writeVarint(len);
+	for(size_t i = 0; i < len; i++)
+	{
+		writeVarint((OSYS_ULONG32)str[i]);
+	}
+}
+
+void OOStreamBinary::writeWCString256(const O_WCHAR_T * str, const char *label)
+// Write a null terminated wide character string of up to 255 characters.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeWCString(str,label);
+}
+
+void OOStreamBinary::writeBytes(const void *buf, size_t nBytes, const char *label)
+// Write an array of bytes.
+// buf is a pointer to the array. nBytes is the number of bytes to be written.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeTag(OBinaryFormat::cBytes,label);
+	writeVarint(nBytes);
+	writeData(buf,nBytes);
+}
+
+void OOStreamBinary::writeBits(const void *buf, size_t nBytes, const char *label)
+// Write an array of bits.
+// buf is a pointer to the array. nBytes is the number of bytes to be written.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeTag(OBinaryFormat::cBits,label);
+	writeVarint(nBytes);
+	writeData(buf,nBytes);
+}
+
+void OOStreamBinary::writeShortArray(const O_SHORT *data,size_t n,const char *label)
+// Write an array of n two byte words as one record.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeTag(OBinaryFormat::cIntArray,label);
+	writeVarint(n);
+	for(size_t i = 0; i < n; i++)
+	{
+		writeInteger(data[i]);
+	}
+}
+
+void OOStreamBinary::writeLongArray(const O_LONG *data,size_t n,const char *label)
+// Write an array of n long words as one record.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeTag(OBinaryFormat::cIntArray,label);
+	writeVarint(n);
+	for(size_t i = 0; i < n; i++)
+	{
+		writeInteger(data[i]);
+	}
+}
+
+void OOStreamBinary::writeLong64Array(const O_LONG64 *data,size_t n,const char *label)
+// Write an array of n 64 bit long words as one record.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeTag(OBinaryFormat::cIntArray,label);
+	writeVarint(n);
+	for(size_t i = 0; i < n; i++)
+	{
+		writeInteger(data[i]);
+	}
+}
+
+void OOStreamBinary::writeFloatArray(const float *data,size_t n,const char *label)
+// Write an array of n floats as one record.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeTag(OBinaryFormat::cFloatArray,label);
+	writeVarint(n);
+	writeData(data,n*4);
+}
+
+void OOStreamBinary::writeDoubleArray(const double *data,size_t n,const char *label)
+// Write an array of n doubles as one record.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeTag(OBinaryFormat::cDoubleArray,label);
+	writeVarint(n);
+	writeData(data,n*8);
+}
+
+void OOStreamBinary::writeObjectId(OId id,const char *label)
+// Write a reference to the object with identity id, or 0 for no object.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeTag(OBinaryFormat::cRef,label);
+	writeVarint(id);
+}
+
+void OOStreamBinary::writeObject(OPersist *ob, const char *label)
+// Write a reference to an object.
+// Parameter ob: Object in file or 0 for no object.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeObjectId(ob ? ob->oId() : 0,label);
+}
+
+bool OOStreamBinary::writeBlob(void *buf,OFilePos_t /* mark */,unsigned long blobLength,const char *label)
+// Write the data of a blob.
+// Returns true because the data is always written.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeTag(OBinaryFormat::cBlob,label);
+	writeVarint(blobLength);
+	writeData(buf,blobLength);
+	return true;
+}
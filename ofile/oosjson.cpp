@@ -0,0 +1,738 @@
+/*=============================================================================
+MIT License
+
+Copyright(c) 2019 willywood
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+=============================================================================*/
+///////////////////////////////////////////////////////////////////////////
+// OOStreamJSON is a concrete subclass of OOStream. 
+// It writes objects as JSON Lines(see oosjson.h).
+// The overridden write functions are designed to be called from the oWrite()
+// methods of persistent objects (that are derived from OPersist). Each one
+// writes a field of the object named by its label. Reals are written with
+// enough digits to be read back exactly. Bytes, bits and blobs are written as
+// strings in the same notation as OOStreamXML, and wide strings with \u
+// escapes. The text is collected in a buffer and written to the output
+// stream when it is full.
+///////////////////////////////////////////////////////////////////////////
+#include "odefs.h"
+#include <sstream>
+#include <string.h>
+#include <stdio.h>
+#include <locale.h>
+#include "oosjson.h"
+#include "ofile.h"
+#include "opersist.h"
+#include "ometa.h"
+#include "ox.h"
+#include "oiter.h"
+
+// Used as the name of data that does not have a label.
+static const char *unnamed = "unnamed_object";
+
+static const char hexDigits[] = "0123456789abcdef";
+
+static size_t utf8Length(const char *str,const char *end)
+// Return the length of the valid UTF-8 sequence of a character that is not
+// ASCII at str, or 0 if there is none.
+{
+	const unsigned char *p = (const unsigned char *)str;
+	// Range of the second byte, which excludes overlong sequences, surrogates
+	// and characters beyond 0x10FFFF.
+	unsigned char low = 0x80,high = 0xBF;
+	size_t n;
+	if(*p >= 0xC2 && *p <= 0xDF)
+	{
+		n = 2;
+	}
+	else if(*p >= 0xE0 && *p <= 0xEF)
+	{
+		n = 3;
+		if(*p == 0xE0)
+			low = 0xA0;
+		else if(*p == 0xED)
+			high = 0x9F;
+	}
+	else if(*p >= 0xF0 && *p <= 0xF4)
+	{
+		n = 4;
+		if(*p == 0xF0)
+			low = 0x90;
+		else if(*p == 0xF4)
+			high = 0x8F;
+	}
+	else
+	{
+		return 0;
+	}
+	if((size_t)(end - str) < n || p[1] < low || p[1] > high)
+		return 0;
+	for(size_t i = 2; i < n; i++)
+		if((p[i] & 0xC0) != 0x80)
+			return 0;
+	return n;
+}
+
+OOStreamJSON::OOStreamJSON(OFile *file,std::ostream &out):
+							OOStream(0),
+							_out(out),
+							_fromFile(file),
+							_used(0),
+							_comma(false)
+// Constructor
+// file - OFile from which to take the objects to be written.
+// out - stream to which to write the objects.
+{
+}
+
+OOStreamJSON::~OOStreamJSON(void)
+{
+}
+
+void OOStreamJSON::beginDocument(const char *appName)
+// Write the line that describes a document of name appName(may be 0).
+// The document should be terminated by calling endDocument().
+{
+	writeData("{\"document\":",12);
+	writeString(appName ? appName : "",appName ? strlen(appName) : 0);
+	writeData(",\"root\":",8);
+	writeInteger(_fromFile && _fromFile->getRoot() ? _fromFile->getRoot()->oId() : 0);
+	writeData("}\n",2);
+}
+
+void OOStreamJSON::endDocument(void)
+// Terminate a document that was begun with beginDocument, and write it to
+// the output stream.
+{
+	flush();
+}
+
+void OOStreamJSON::writeObjectAsJSON(OPersist *ob)
+// Write the line of the given object.
+// Exceptions: Throws OFileError if there is an output stream error.
+{
+	writeData("{\"type\":",8);
+	writeInteger(ob->meta()->id());
+	const char *className = ob->meta()->className(ob);
+	if(className)
+	{
+		writeData(",\"class\":",9);
+		writeString(className,strlen(className));
+	}
+	writeData(",\"id\":",6);
+	writeInteger(ob->oId());
+	writeData(",\"ver\":",7);
+	writeInteger(OFile::userSourceVersion());
+	writeData(",\"data\":{",9);
+	_comma = false;
+
+	// virtual base has not been written
+	_VBWritten = false;
+
+	ob->oWrite(this);
+	writeData("}}\n",3);
+}
+
+void OOStreamJSON::writeObjects(const char *appName,
+								OClassId_t classId,
+								bool deep)
+// Write all the objects in file of class classId. Also their sub-classes
+// if deep is true(default = true), as a document of name appName(may be 0).
+// Exceptions: Throws OFileError if there is an output stream error.
+{
+	oFAssert(_fromFile);
+
+	try
+	{
+		beginDocument(appName);
+
+		// Read in file order so that the file is read sequentially.
+		OScanIterator it(_fromFile,classId,deep);
+		OPersist *ob;
+
+		while((ob = it++))
+		{
+			writeObjectAsJSON(ob);
+		}
+		endDocument();
+	}catch(...)
+	{
+		// Discard what has not been written.
+		_used = 0;
+		throw;
+	}
+}
+
+// The parts of a document being written by writeObjectsParallel().
+struct JSONParts
+{
+	OOStreamJSON *_stream;              // Stream to which the document is written
+	std::ostringstream **_bufs;         // Lines formatted by each part
+	OOStreamJSON **_streams;            // Streams that format each part
+};
+
+void OOStreamJSON::writeObjectsParallel(const char *appName,
+								OClassId_t classId,
+								bool deep,
+								int nThreads)
+// As writeObjects, but the objects are formatted by nThreads threads
+// (default 0: the number of hardware threads). Each thread formats a part
+// of a batch of objects into its own buffer, and the buffers are then
+// written to the stream in file order. The document is the same as that
+// written by writeObjects.
+// Exceptions: Throws OFileError if there is an output stream error.
+{
+	oFAssert(_fromFile);
+
+	if(nThreads <= 0)
+		nThreads = OFThread::hardwareConcurrency();
+
+	JSONParts parts;
+	parts._stream = this;
+	parts._bufs = new std::ostringstream *[nThreads];
+	parts._streams = new OOStreamJSON *[nThreads];
+	int i;
+	for(i = 0; i < nThreads; i++)
+	{
+		parts._bufs[i] = 0;
+		parts._streams[i] = 0;
+	}
+
+	try
+	{
+		beginDocument(appName);
+
+		for(i = 0; i < nThreads; i++)
+		{
+			parts._bufs[i] = new std::ostringstream;
+			parts._streams[i] = new OOStreamJSON(_fromFile,*parts._bufs[i]);
+		}
+
+		_fromFile->parallelForEach(classId,deep,writePart,writeParts,&parts,
+									(long)nThreads*cParallelBatch,nThreads);
+		endDocument();
+	}catch(...)
+	{
+		// Cleanup and rethrow
+		for(i = 0; i < nThreads; i++)
+		{
+			delete parts._streams[i];
+			delete parts._bufs[i];
+		}
+		delete []parts._streams;
+		delete []parts._bufs;
+		_used = 0;
+		throw;
+	}
+	for(i = 0; i < nThreads; i++)
+	{
+		delete parts._streams[i];
+		delete parts._bufs[i];
+	}
+	delete []parts._streams;
+	delete []parts._bufs;
+}
+
+bool OOStreamJSON::writePart(OPersist *ob,void *arg,int part)
+// Private. Called by OFile::parallelForEach in the thread of the part.
+// Format the line of the object into the buffer of the part.
+{
+	((JSONParts *)arg)->_streams[part]->writeObjectAsJSON(ob);
+	return false;
+}
+
+void OOStreamJSON::writeParts(void *arg,int nParts)
+// Private. Called by OFile::parallelForEach when a batch has been formatted.
+// Write the buffers of the parts to the stream in order and empty them.
+{
+	JSONParts *parts = (JSONParts *)arg;
+
+	for(int i = 0; i < nParts; i++)
+	{
+		parts->_streams[i]->flush();
+		std::string text = parts->_bufs[i]->str();
+		parts->_stream->writeData(text.data(),text.size());
+		parts->_bufs[i]->str("");
+		parts->_bufs[i]->clear();
+	}
+}
+
+void OOStreamJSON::flush(void)
+// Write the buffered text to the output stream.
+// Exceptions: Throws OFileError if there is an output stream error.
+{
+	if(_used)
+	{
+		_out.write(_buf,_used);
+		_used = 0;
+	}
+	if(_out.fail())
+		throw OFileIOErr("Output stream error.");
+}
+
+void OOStreamJSON::writeData(const char *buf,size_t size)
+// Private.
+// Write size characters. Large data goes straight to the output stream.
+{
+	if(_used + size > cBufferSize)
+	{
+		flush();
+		if(size >= cBufferSize)
+		{
+			_out.write(buf,size);
+			return;
+		}
+	}
+	memcpy(&_buf[_used],buf,size);
+	_used += size;
+}
+
+void OOStreamJSON::writeInteger(OSYS_LONG64 data)
+// Private.
+// Write an integer. This is much faster than inserting it in the stream.
+{
+	char buf[24];
+	char *end = &buf[sizeof(buf)];
+	char *p = end;
+	OSYS_ULONG64 u = data < 0 ? (OSYS_ULONG64)0 - (OSYS_ULONG64)data : (OSYS_ULONG64)data;
+	do
+	{
+		*--p = (char)('0' + (int)(u % 10));
+		u /= 10;
+	}while(u);
+	if(data < 0)
+		*--p = '-';
+	writeData(p,end - p);
+}
+
+void OOStreamJSON::writeReal(double data,int precision)
+// Private.
+// Write a real number with precision significant digits. JSON has no
+// numbers for infinity and NaN, so they are written as strings.
+{
+	if(data != data)
+	{
+		writeData("\"NaN\"",5);
+	}
+	else if(data - data != 0)
+	{
+		if(data > 0)
+			writeData("\"Infinity\"",10);
+		else
+			writeData("\"-Infinity\"",11);
+	}
+	else
+	{
+		char buf[32];
+		int length = sprintf(buf,"%.*g",precision,data);
+		// The C library may use a decimal point of its own locale.
+		char point = *localeconv()->decimal_point;
+		if(point != '.')
+		{
+			char *p = (char *)memchr(buf,point,length);
+			if(p)
+				*p = '.';
+		}
+		writeData(buf,length);
+	}
+}
+
+void OOStreamJSON::writeString(const char *str,size_t len)
+// Private.
+// Write a quoted string. Quotes, backslashes and control characters are
+// escaped. UTF-8 characters are written as they are, and a byte that is not
+// part of one as a lone low surrogate \udc80 to \udcff, which OIStreamJSON
+// reads back as the byte.
+{
+	writeByte('"');
+	const char *end = str + len;
+	while(str != end)
+	{
+		// Write a run of characters that need no escape in one go.
+		const char *run = str;
+		while(str != end)
+		{
+			unsigned char c = (unsigned char)*str;
+			if(c < 0x80)
+			{
+				if(c < 0x20 || c == '"' || c == '\\')
+					break;
+				str++;
+			}
+			else
+			{
+				size_t n = utf8Length(str,end);
+				if(n == 0)
+					break;
+				str += n;
+			}
+		}
+		if(str != run)
+			writeData(run,str - run);
+		if(str == end)
+			break;
+
+		char esc[6] = {'\\',0,'0','0',0,0};
+		switch(*str)
+		{
+		case '"': esc[1] = '"'; break;
+		case '\\': esc[1] = '\\'; break;
+		case '\n': esc[1] = 'n'; break;
+		case '\r': esc[1] = 'r'; break;
+		case '\t': esc[1] = 't'; break;
+		default:
+			esc[1] = 'u';
+			if((unsigned char)*str >= 0x80)
+			{
+				esc[2] = 'd';
+				esc[3] = 'c';
+			}
+			esc[4] = hexDigits[(*str >> 4) & 0xf];
+			esc[5] = hexDigits[*str & 0xf];
+			break;
+		}
+		writeData(esc,esc[1] == 'u' ? 6 : 2);
+		str++;
+	}
+	writeByte('"');
+}
+
+void OOStreamJSON::writeWString(const O_WCHAR_T *str,size_t len)
+// Private.
+// Write a quoted wide character string. Characters that are not ASCII are
+// written as \u escapes, and those beyond 0xFFFF as surrogate pairs.
+{
+	writeByte('"');
+	for(size_t i = 0; i < len; i++)
+	{
+		OSYS_ULONG32 c = (OSYS_ULONG32)str[i];
+		if(c >= 0x20 && c < 0x80)
+		{
+			char ch = (char)c;
+			if(ch == '"' || ch == '\\')
+				writeByte('\\');
+			writeByte(ch);
+			continue;
+		}
+
+		OSYS_ULONG32 units[2];
+		int n = 0;
+		if(c > 0xFFFF)
+		{
+			c -= 0x10000;
+			units[n++] = 0xD800 + ((c >> 10) & 0x3FF);
+			units[n++] = 0xDC00 + (c & 0x3FF);
+		}
+		else
+		{
+			units[n++] = c;
+		}
+		for(int j = 0; j < n; j++)
+		{
+			char esc[6] = {'\\','u',hexDigits[(units[j] >> 12) & 0xf],hexDigits[(units[j] >> 8) & 0xf],
+						   hexDigits[(units[j] >> 4) & 0xf],hexDigits[units[j] & 0xf]};
+			writeData(esc,6);
+		}
+	}
+	writeByte('"');
+}
+
+void OOStreamJSON::writeHex(const void *buf,size_t nBytes)
+// Private.
+// Write bytes as a string of two hex digits for each byte.
+{
+	writeByte('"');
+	const unsigned char *bufp = (const unsigned char *)buf;
+	for(size_t i = 0; i < nBytes; i++)
+	{
+		char hex[2] = {hexDigits[*bufp >> 4],hexDigits[*bufp & 0xf]};
+		writeData(hex,2);
+		bufp++;
+	}
+	writeByte('"');
+}
+
+void OOStreamJSON::writeKey(const char *label)
+// Private.
+// Start a field of the current object.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	if(_comma)
+		writeByte(',');
+	if(!label)
+		label = unnamed;
+	writeString(label,strlen(label));
+	writeByte(':');
+	_comma = true;
+}
+
+void OOStreamJSON::beginObject(const char *label)
+// Indicate the start of a containing object
+{
+	writeKey(label);
+	writeByte('{');
+	_comma = false;
+}
+
+void OOStreamJSON::endObject(void)
+// End of a containing object
+{
+	writeByte('}');
+	_comma = true;
+}
+
+void OOStreamJSON::writeLong(O_LONG data, const char *label)
+// Write a long word.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeKey(label);
+	writeInteger(data);
+}
+
+void OOStreamJSON::writeLong64(O_LONG64 data, const char *label)
+// Write a 64 bit long word.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeKey(label);
+	writeInteger(data);
+}
+
+void OOStreamJSON::writeShort(O_SHORT data, const char *label)
+// Write a two byte word.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeKey(label);
+	writeInteger(data);
+}
+
+void OOStreamJSON::writeFloat(float data, const char *label)
+// Write a float (4 bytes)
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeKey(label);
+	writeReal(data,9);
+}
+
+void OOStreamJSON::writeDouble(double data, const char *label)
+// Write a double (8 bytes)
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeKey(label);
+	writeReal(data,17);
+}
+
+void OOStreamJSON::writeChar(char data, const char *label)
+// Write a single byte character as a string of one character.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeKey(label);
+	O_WCHAR_T c = (O_WCHAR_T)(unsigned char)data;
+	writeWString(&c,1);
+}
+
+void OOStreamJSON::writeBool(bool data, const char *label)
+// Write a bool.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeKey(label);
+	if(data)
+		writeData("true",4);
+	else
+		writeData("false",5);
+}
+
+void OOStreamJSON::writeCString(const char * str, const char *label)
+// Write a null terminated string.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeKey(label);
+	writeString(str,strlen(str));
+}
+
+void OOStreamJSON::writeCString256(const char * str, const char *label)
+// Write a null terminated string of up to 255 characters.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeCString(str,label);
+}
+
+void OOStreamJSON::writeWChar(O_WCHAR_T data, const char *label)
+// Write a wide character as its code.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeKey(label);
+	writeInteger((OSYS_ULONG32)data);
+}
+
+void OOStreamJSON::writeWCString(const O_WCHAR_T * str, const char *label)
+// Write a null terminated wide character string.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	size_t len = 0;
+	while(str[len])
+		len++;
+	writeKey(label);
+	writeWString(str,len);
+}
+
+void OOStreamJSON::writeWCString256(const O_WCHAR_T * str, const char *label)
+// Write a null terminated wide character string of up to 255 characters.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeWCString(str,label);
+}
+
+void OOStreamJSON::writeBytes(const void *buf, size_t nBytes, const char *label)
+// Write an array of bytes as a hex string.
+// buf is a pointer to the array. nBytes is the number of bytes to be written.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeKey(label);
+	writeHex(buf,nBytes);
+}
+
+void OOStreamJSON::writeBits(const void *buf, size_t nBytes, const char *label)
+// Write an array of bits as a string of 0's and 1's, lowest bit first.
+// buf is a pointer to the array. nBytes is the number of bytes to be written.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeKey(label);
+	writeByte('"');
+	const unsigned char *bufp = (const unsigned char *)buf;
+	for(size_t i = 0; i < nBytes; i++)
+	{
+		char bits[8];
+		for(int j = 0; j < 8; j++)
+			bits[j] = (*bufp & (1 << j)) ? '1' : '0';
+		writeData(bits,8);
+		bufp++;
+	}
+	writeByte('"');
+}
+
+void OOStreamJSON::writeShortArray(const O_SHORT *data,size_t n,const char *label)
+// Write an array of n two byte words as a JSON array.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeKey(label);
+	writeByte('[');
+	for(size_t i = 0; i < n; i++)
+	{
+		if(i)
+			writeByte(',');
+		writeInteger(data[i]);
+	}
+	writeByte(']');
+}
+
+void OOStreamJSON::writeLongArray(const O_LONG *data,size_t n,const char *label)
+// Write an array of n long words as a JSON array.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeKey(label);
+	writeByte('[');
+	for(size_t i = 0; i < n; i++)
+	{
+		if(i)
+			writeByte(',');
+		writeInteger(data[i]);
+	}
+	writeByte(']');
+}
+
+void OOStreamJSON::writeLong64Array(const O_LONG64 *data,size_t n,const char *label)
+// Write an array of n 64 bit long words as a JSON array.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeKey(label);
+	writeByte('[');
+	for(size_t i = 0; i < n; i++)
+	{
+		if(i)
+			writeByte(',');
+		writeInteger(data[i]);
+	}
+	writeByte(']');
+}
+
+void OOStreamJSON::writeFloatArray(const float *data,size_t n,const char *label)
+// Write an array of n floats as a JSON array.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeKey(label);
+	writeByte('[');
+	for(size_t i = 0; i < n; i++)
+	{
+		if(i)
+			writeByte(',');
+		writeReal(data[i],9);
+	}
+	writeByte(']');
+}
+
+void OOStreamJSON::writeDoubleArray(const double *data,size_t n,const char *label)
+// Write an array of n doubles as a JSON array.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeKey(label);
+	writeByte('[');
+	for(size_t i = 0; i < n; i++)
+	{
+		if(i)
+			writeByte(',');
+		writeReal(data[i],17);
+	}
+	writeByte(']');
+}
+
+void OOStreamJSON::writeObjectId(OId id,const char *label)
+// Write a reference to the object with identity id, or null for no object.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeKey(label);
+	if(id)
+	{
+		writeData("{\"ref\":",7);
+		writeInteger(id);
+		writeByte('}');
+	}
+	else
+	{
+		writeData("null",4);
+	}
+}
+
+void OOStreamJSON::writeObject(OPersist *ob, const char *label)
+// Write a reference to an object.
+// Parameter ob: Object in file or 0 for no object.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeObjectId(ob ? ob->oId() : 0,label);
+}
+
+bool OOStreamJSON::writeBlob(void *buf,OFilePos_t /* mark */,unsigned long blobLength,const char *label)
+// Write the data of a blob as a hex string.
+// Returns true because the data is always written.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeKey(label);
+	writeHex(buf,blobLength);
+	return true;
+}
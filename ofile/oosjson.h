@@ -0,0 +1,124 @@
+#ifndef OOSJSON_H
+#define OOSJSON_H
+/*=============================================================================
+MIT License
+
+Copyright(c) 2019 willywood
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this softwareand associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright noticeand this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+=============================================================================*/
+
+#include <iostream>
+#include "ostrm.h"
+
+// OOStreamJSON is a concrete subclass of OOStream. It writes the objects of
+// a file to a standard output stream as JSON Lines: a line describing the
+// document followed by one line for each object.
+//
+// {"document":"appName","root":12}
+// {"type":31,"class":"Person","id":12,"ver":1,"data":{"name":"Ann","age":32,"spouse":{"ref":13}}}
+//
+// The fields of "data" are named by the labels passed to the write functions.
+// Object references are always written as references, as by the cFlat style
+// of OOStreamXML. Because every object is on a line of its own the output can
+// be split at any line and processed in parallel.
+
+class OOStreamJSON: public OOStream
+{
+typedef OOStream inherited;
+public:
+	enum {cBufferSize = 0x4000}; // Bytes buffered before they are written to the stream.
+	enum {cParallelBatch = 2048}; // Objects formatted by each thread of
+	                              // writeObjectsParallel() before they are written.
+
+	OOStreamJSON(OFile *f,std::ostream &out);
+	~OOStreamJSON(void);
+protected:
+	void writeLong(O_LONG data,const char *label = 0);
+	void writeLong64(O_LONG64 data,const char *label = 0);
+	void writeFloat(float data,const char *label = 0);
+	void writeDouble(double data,const char *label = 0);
+	void writeShort(O_SHORT data,const char *label = 0);
+	void writeChar(char data,const char *label = 0);
+	void writeBool(bool data,const char *label = 0);
+	void writeCString(const char * str,const char *label = 0);
+	void writeCString256(const char * str,const char *label = 0);
+	// wchar support  can be removed if not used.
+	void writeWChar(O_WCHAR_T data,const char *label = 0);
+	void writeWCString(const O_WCHAR_T * str,const char *label = 0);
+	void writeWCString256(const O_WCHAR_T * str,const char *label = 0);
+	//
+	void writeBytes(const void *buf,size_t nBytes,const char *label = 0);
+	void writeBits(const void *buf,size_t nBytes,const char *label = 0);
+	void writeShortArray(const O_SHORT *data,size_t n,const char *label = 0);
+	void writeLongArray(const O_LONG *data,size_t n,const char *label = 0);
+	void writeLong64Array(const O_LONG64 *data,size_t n,const char *label = 0);
+	void writeFloatArray(const float *data,size_t n,const char *label = 0);
+	void writeDoubleArray(const double *data,size_t n,const char *label = 0);
+	void writeObjectId(OId,const char *label = 0);
+	void writeObject(OPersist *,const char *label = 0);
+	bool writeBlob(void *buf,OFilePos_t mark,unsigned long size,const char *label = 0);
+    void writeBlobHeader(OFilePos_t mark,oulong blobLength){OFILE_UNUSED(mark);OFILE_UNUSED(blobLength);}
+	void writeFile(const char *fname,OFilePos_t mark,oulong from,oulong size){OFILE_UNUSED(fname);OFILE_UNUSED(mark);OFILE_UNUSED(from);OFILE_UNUSED(size);}
+	// Stream is actually writing to the file.
+	bool writing(void)const{return true;}
+
+public:
+	void writeObjects(const char *appName,
+				  OClassId_t classId = cOPersist,
+				  bool deep = true);
+	void writeObjectsParallel(const char *appName,
+				  OClassId_t classId = cOPersist,
+				  bool deep = true,
+				  int nThreads = 0);
+	void writeObjectAsJSON(OPersist *ob);
+	void beginDocument(const char *appName);
+	void endDocument(void);
+	void flush(void);
+
+	void comment(const char *text = 0){OFILE_UNUSED(text);}
+	void beginObject(const char *label);
+	void endObject(void);
+
+private:
+	void writeKey(const char *label);
+	void writeString(const char *str,size_t len);
+	void writeWString(const O_WCHAR_T *str,size_t len);
+	void writeHex(const void *buf,size_t nBytes);
+	void writeInteger(OSYS_LONG64 data);
+	void writeReal(double data,int precision);
+	void writeData(const char *buf,size_t size);
+	void writeByte(char c)
+	{
+		if(_used == cBufferSize)
+			flush();
+		_buf[_used++] = c;
+	}
+	static bool writePart(OPersist *ob,void *arg,int part);
+	static void writeParts(void *arg,int parts);
+
+private:
+	std::ostream &_out;           // Output stream
+	OFile *_fromFile;             // The OFile from which the objects are written
+	char _buf[cBufferSize];       // Data not yet written to _out
+	size_t _used;                 // Bytes in _buf
+	bool _comma;                  // A field has been written in the current object
+};
+
+#endif  // OOSJSON_H
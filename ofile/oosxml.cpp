@@ -57,9 +57,12 @@ SOFTWARE.
 //
 #include "odefs.h"
 #include <iostream>
+#include <sstream>
 #include <typeinfo>
 #include <string.h>
 #include <stdio.h>
+#include <locale.h>
+#include <locale>
 #include "ofile.h"
 #include "opersist.h"
 #include "ox.h"
@@ -70,6 +73,59 @@ SOFTWARE.
 // Used as the tag for data that does not have one of its own.
 static const char *unnamed = "unnamed_object";
 
+static void writeInteger(std::ostream &out,OSYS_LONG64 data)
+// Write an integer. This is much faster than inserting it in the stream.
+{
+	char buf[24];
+	char *end = &buf[sizeof(buf)];
+	char *p = end;
+	OSYS_ULONG64 u = data < 0 ? (OSYS_ULONG64)0 - (OSYS_ULONG64)data : (OSYS_ULONG64)data;
+	do
+	{
+		*--p = (char)('0' + (int)(u % 10));
+		u /= 10;
+	}while(u);
+	if(data < 0)
+		*--p = '-';
+	out.write(p,end - p);
+}
+
+template<class T>
+static void writeValue(std::ostream &out,T data)
+// Write an integer of any width.
+{
+	writeInteger(out,(OSYS_LONG64)data);
+}
+
+static void writeValue(std::ostream &out,double data)
+// Write a real number in the same format as the stream would. With the
+// default format it is formatted directly to the precision of the stream.
+// Other formats, a field width and other locales are left to the stream.
+{
+	const std::ios_base::fmtflags special = std::ios_base::floatfield | std::ios_base::showpoint |
+											std::ios_base::showpos | std::ios_base::uppercase;
+	if((out.flags() & special) || out.width() || out.precision() > 40 ||
+	   out.getloc() != std::locale::classic())
+	{
+		out << data;
+		return;
+	}
+
+	char buf[64];
+	int length = sprintf(buf,"%.*g",(int)out.precision(),data);
+	// The C library may use a decimal point of its own locale.
+	char point = *localeconv()->decimal_point;
+	if(point != '.')
+	{
+		char *p = (char *)memchr(buf,point,length);
+		if(p)
+			*p = '.';
+	}
+	out.write(buf,length);
+}
+
+static void writeValue(std::ostream &out,float data){writeValue(out,(double)data);}
+
 OOStreamXML::OOStreamXML(OFile *file, std::ostream &out,bool writeBlobsToFile):
 							OOStream(0),
 							_out(out),
@@ -185,7 +241,8 @@ void OOStreamXML::writeObjects(const char *appName,
 		// Just in case we are calling the method a second time.
 		reset();
 
-		OIterator it(_fromFile,classId,deep);
+		// Read in file order so that the file is read sequentially.
+		OScanIterator it(_fromFile,classId,deep);
 		OPersist *ob;
 
 		while((ob = it++))
@@ -202,6 +259,120 @@ void OOStreamXML::writeObjects(const char *appName,
 	reset();
 }
 
+// The parts of a document being written by writeObjectsParallel().
+struct XMLParts
+{
+	OOStreamXML *_stream;               // Stream to which the document is written
+	std::ostringstream **_bufs;         // Text formatted by each part
+	OOStreamXML **_streams;             // Streams that format each part
+};
+
+void OOStreamXML::writeObjectsParallel(const char *appName,
+								OClassId_t classId,
+								bool deep,
+								const char *encoding,
+								int nThreads)
+// As writeObjects, but the objects are formatted by nThreads threads
+// (default 0: the number of hardware threads). Each thread formats a part
+// of a batch of objects into its own buffer, and the buffers are then
+// written to the stream in file order. The document is the same as that
+// written by writeObjects.
+// Only the cFlat style can be written in parallel, because the other styles
+// write an object where it is first referenced. Blobs written to separate
+// files are also numbered in the order in which they are written. In these
+// cases writeObjects is used.
+// Exceptions: Throws OFileError if there is an output stream error.
+{
+	oFAssert(_fromFile);
+
+	if(_style != cFlat || _writeBlobsToFile)
+	{
+		writeObjects(appName,classId,deep,encoding);
+		return;
+	}
+
+	if(nThreads <= 0)
+		nThreads = OFThread::hardwareConcurrency();
+
+	XMLParts parts;
+	parts._stream = this;
+	parts._bufs = new std::ostringstream *[nThreads];
+	parts._streams = new OOStreamXML *[nThreads];
+	int i;
+	for(i = 0; i < nThreads; i++)
+	{
+		parts._bufs[i] = 0;
+		parts._streams[i] = 0;
+	}
+
+	try
+	{
+		beginDocument(appName,encoding);
+
+		// Just in case we are calling the method a second time.
+		reset();
+
+		for(i = 0; i < nThreads; i++)
+		{
+			parts._bufs[i] = new std::ostringstream;
+			parts._streams[i] = new OOStreamXML(_fromFile,*parts._bufs[i],false);
+			parts._streams[i]->_style = _style;
+			parts._streams[i]->_indent = _indent;
+			parts._streams[i]->_sp = _sp;
+		}
+
+		_fromFile->parallelForEach(classId,deep,writePart,writeParts,&parts,
+									(long)nThreads*cParallelBatch,nThreads);
+		endDocument();
+	}catch(...)
+	{
+		// Cleanup and rethrow
+		for(i = 0; i < nThreads; i++)
+		{
+			delete parts._streams[i];
+			delete parts._bufs[i];
+		}
+		delete []parts._streams;
+		delete []parts._bufs;
+		reset();
+		throw;
+	}
+	for(i = 0; i < nThreads; i++)
+	{
+		delete parts._streams[i];
+		delete parts._bufs[i];
+	}
+	delete []parts._streams;
+	delete []parts._bufs;
+	reset();
+}
+
+bool OOStreamXML::writePart(OPersist *ob,void *arg,int part)
+// Private. Called by OFile::parallelForEach in the thread of the part.
+// Format the object into the buffer of the part.
+{
+	((XMLParts *)arg)->_streams[part]->writeObjectAsXML(ob);
+	return false;
+}
+
+void OOStreamXML::writeParts(void *arg,int nParts)
+// Private. Called by OFile::parallelForEach when a batch has been formatted.
+// Write the buffers of the parts to the stream in order and empty them.
+{
+	XMLParts *parts = (XMLParts *)arg;
+	std::ostream &out = parts->_stream->_out;
+
+	for(int i = 0; i < nParts; i++)
+	{
+		out << parts->_bufs[i]->str();
+		parts->_bufs[i]->str("");
+		parts->_bufs[i]->clear();
+		parts->_streams[i]->reset();
+	}
+	if(out.fail())
+		throw OFileIOErr("Output stream error.");
+}
+
 void OOStreamXML::start(OPersist *ob)
 // Start writing an object
 // Parameters:mark - Position in file to write object.
@@ -334,7 +505,7 @@ void OOStreamXML::writeLong(O_LONG data, const char *label)
 // label - a pointer to a descriptive label for the attribute or 0.
 {
 	startData(label);
-	_out << data;
+	writeValue(_out,data);
 	endData();
 }
 
@@ -343,10 +514,7 @@ void OOStreamXML::writeLong64(O_LONG64 data, const char *label)
 // label - a pointer to a descriptive label for the attribute or 0.
 {
 	startData(label);
-// Visual C++ 6.0 does not have an operator for __int64
-#ifndef _MSC_VER
-	_out << data;
-#endif
+	writeValue(_out,data);
 	endData();
 }
 
@@ -355,7 +523,7 @@ void OOStreamXML::writeFloat(float data, const char *label)
 // label - a pointer to a descriptive label for the attribute or 0.
 {
 	startData(label);
-	_out << data;
+	writeValue(_out,data);
 	endData();
 }
 
@@ -364,7 +532,7 @@ void OOStreamXML::writeDouble(double data, const char *label)
 // label - a pointer to a descriptive label for the attribute or 0.
 {
 	startData(label);
-	_out << data;
+	writeValue(_out,data);
 	endData();
 }
 
@@ -373,7 +541,7 @@ void OOStreamXML::writeShort(O_SHORT data, const char *label)
 // label - a pointer to a descriptive label for the attribute or 0.
 {
 	startData(label);
-	_out << data;
+	writeValue(_out,data);
 	endData();
 }
 
@@ -467,6 +635,70 @@ void OOStreamXML::writeWCString256(const O_WCHAR_T * str, const char *label)
 	writeWCString(str,label);
 }
 
+template <class T>
+static void writeValues(std::ostream &out,const T *data,size_t n)
+// Write n values separated by spaces.
+{
+	for(size_t i = 0; i < n; i++)
+	{
+		if(i)
+		{
+			out << ' ';
+		}
+		writeValue(out,data[i]);
+	}
+}
+
+void OOStreamXML::writeShortArray(const O_SHORT *data,size_t n,const char *label)
+// Write an array of two byte words as one element. The values are separated
+// by spaces.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	startData(label);
+	writeValues(_out,data,n);
+	endData();
+}
+
+void OOStreamXML::writeLongArray(const O_LONG *data,size_t n,const char *label)
+// Write an array of long words as one element. The values are separated
+// by spaces.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	startData(label);
+	writeValues(_out,data,n);
+	endData();
+}
+
+void OOStreamXML::writeLong64Array(const O_LONG64 *data,size_t n,const char *label)
+// Write an array of 64 bit long words as one element. The values are separated
+// by spaces.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	startData(label);
+	writeValues(_out,data,n);
+	endData();
+}
+
+void OOStreamXML::writeFloatArray(const float *data,size_t n,const char *label)
+// Write an array of floats as one element. The values are separated
+// by spaces.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	startData(label);
+	writeValues(_out,data,n);
+	endData();
+}
+
+void OOStreamXML::writeDoubleArray(const double *data,size_t n,const char *label)
+// Write an array of doubles as one element. The values are separated
+// by spaces.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	startData(label);
+	writeValues(_out,data,n);
+	endData();
+}
+
 void OOStreamXML::writeBytes(const void *buf, size_t nBytes, const char *label)
 // Write an array of bytes.
 // buf is a pointer to the array. nBytes is the number of bytes to be written.
@@ -474,19 +706,18 @@ void OOStreamXML::writeBytes(const void *buf, size_t nBytes, const char *label)
 {
 	startData(label);
 
-	char *bufp = (char *)buf;
+	static const char digits[] = "0123456789abcdef";
+	const unsigned char *bufp = (const unsigned char *)buf;
 	for(size_t i = 0; i < nBytes; i++)
 	{
-		char hex[20];
-		sprintf(hex,"%x",(int)*bufp++);
-		if (strlen(hex) > 2)
-		{
-			_out << ' ' << &hex[6];
-		}
-		else
-		{
-			_out << ' ' << hex;
-		}
+		// Space followed by the byte in hex without leading zeros.
+		char hex[3];
+		int len = 0;
+		hex[len++] = ' ';
+		if(*bufp >= 0x10)
+			hex[len++] = digits[*bufp >> 4];
+		hex[len++] = digits[*bufp++ & 0xf];
+		_out.write(hex,len);
 	}
 	endData();
 }
@@ -49,6 +49,8 @@ public:
 				   cFlat   // All references appear as references (even if "o:"
 				   };
 	enum {cLabelLength = 256}; // maximum number of characters in a label.
+	enum {cParallelBatch = 2048}; // Objects formatted by each thread of
+	                              // writeObjectsParallel() before they are written.
 
 	OOStreamXML(OFile *f,std::ostream &out,bool writeBlobsToFile=false);
 	~OOStreamXML(void);
@@ -69,6 +71,11 @@ protected:
 	//
 	void writeBytes(const void *buf,size_t nBytes,const char *label = 0);
 	void writeBits(const void *buf,size_t nBytes,const char *label = 0);
+	void writeShortArray(const O_SHORT *data,size_t n,const char *label = 0);
+	void writeLongArray(const O_LONG *data,size_t n,const char *label = 0);
+	void writeLong64Array(const O_LONG64 *data,size_t n,const char *label = 0);
+	void writeFloatArray(const float *data,size_t n,const char *label = 0);
+	void writeDoubleArray(const double *data,size_t n,const char *label = 0);
 	void writeObjectId(OId,const char *label = 0);
 	void writeObject(OPersist *,const char *label = 0);
 	bool writeBlob(void *buf,OFilePos_t mark,unsigned long size,const char *label = 0);
@@ -85,6 +92,11 @@ public:
 				  OClassId_t classId = cOPersist,
 				  bool deep = true,
 				  const char *encoding = 0);
+	void writeObjectsParallel(const char *appName,
+				  OClassId_t classId = cOPersist,
+				  bool deep = true,
+				  const char *encoding = 0,
+				  int nThreads = 0);
 	void writeObjectAsXML(OPersist *ob);
 	void beginDocument(const char *appName,const char *encoding = 0);
 	void endDocument(void);
@@ -112,6 +124,8 @@ private:
 	void writeObjectReference(OId id,const char *label);
 	void writeObjectInstance(OPersist *,const char *label);
 	const O_WCHAR_T *pwriteWCString(const O_WCHAR_T * str);
+	static bool writePart(OPersist *ob,void *arg,int part);
+	static void writeParts(void *arg,int parts);
 
 private:
 	std::ostream &_out;			  // Output stream
@@ -61,6 +61,7 @@ void *OPersist::operator new(size_t size)
 		// Object threshold has been reached.
 		if (OFile::_sNew_handler)
 		{
+			ofAtomicAdd(OFile::_sStats.newHandlerCalls,1);
 			(*OFile::_sNew_handler)();
 		}
 		else
@@ -41,6 +41,8 @@ to define a class that writes to some other device.
 #include "opersist.h"
 #include "ox.h"
 #include "oistrm.h"
+#include "olz.h"
+#include "ocrc.h"
 
 bool OOStream::VBWrite(void)
 // Check whether to write virtual base class.
@@ -57,11 +59,57 @@ bool OOStream::VBWrite(void)
 	}
 }
 
+void OOStream::writeShortArray(const O_SHORT *data,size_t n,const char *label)
+// Write an array of n two byte words.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	for(size_t i = 0; i < n; i++)
+		writeShort(data[i],label);
+}
+
+void OOStream::writeLongArray(const O_LONG *data,size_t n,const char *label)
+// Write an array of n long words.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	for(size_t i = 0; i < n; i++)
+		writeLong(data[i],label);
+}
+
+void OOStream::writeLong64Array(const O_LONG64 *data,size_t n,const char *label)
+// Write an array of n 64 bit long words.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	for(size_t i = 0; i < n; i++)
+		writeLong64(data[i],label);
+}
+
+void OOStream::writeFloatArray(const float *data,size_t n,const char *label)
+// Write an array of n floats.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	for(size_t i = 0; i < n; i++)
+		writeFloat(data[i],label);
+}
+
+void OOStream::writeDoubleArray(const double *data,size_t n,const char *label)
+// Write an array of n doubles.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	for(size_t i = 0; i < n; i++)
+		writeDouble(data[i],label);
+}
+
 
 void OOStreamFile::writeLong(O_LONG data,const char * /* label */)
 // Write a long word (4 bytes)
 // label - a pointer to a descriptive label for the attribute or 0.
 {
+	if (_compact)
+	{
+		writeVarint(OUtilityFunction::zigzag(data));
+		return;
+	}
+
 	if (file()->needSwap())
 	{
 		OUtilityFunction::swap32((char*)&data);
@@ -77,6 +125,12 @@ void OOStreamFile::writeLong64(O_LONG64 data,const char * /* label */)
 	// Do not want to write 64 bit longs if we do not have them.
 	oFAssert(sizeof(O_LONG64) == 8);
 
+	if (_compact)
+	{
+		writeVarint(OUtilityFunction::zigzag(data));
+		return;
+	}
+
 	if (file()->needSwap())
 	{
 		OUtilityFunction::swap64((char*)&data);
@@ -89,6 +143,12 @@ void OOStreamFile::writeFilePos(OFilePos_t data,const char * /* label */)
 // Write a long word (4 bytes)
 // label - a pointer to a descriptive label for the attribute or 0.
 {
+	if (_compact)
+	{
+		writeVarint(data);
+		return;
+	}
+
 	if (file()->needSwap())
 	{
 		OUtilityFunction::swapFilePos((char*)&data);
@@ -125,6 +185,12 @@ void OOStreamFile::writeShort(O_SHORT data,const char * /* label */)
 // Write a two byte word.
 // label - a pointer to a descriptive label for the attribute or 0.
 {
+	if (_compact)
+	{
+		writeVarint(OUtilityFunction::zigzag(data));
+		return;
+	}
+
 	if (file()->needSwap())
 	{
 		OUtilityFunction::swap16((char*)&data);
@@ -242,7 +308,10 @@ void OOStreamFile::writeObjectId(OId id,const char * /* label */)
 // Assumes OId is 4 bytes.
 // label - a pointer to a descriptive label for the attribute or 0.
 {
-	writeLong(id);
+	if (_compact)
+		writeVarint(id);
+	else
+		writeLong(id);
 }
 
 
@@ -261,6 +330,80 @@ void OOStreamFile::writeObject(OPersist *ob,const char * /* label */)
 }
 
 
+void OOStreamFile::writeShortArray(const O_SHORT *data,size_t n,const char *label)
+// Write an array of n two byte words in one go.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	if(_compact)
+		OOStream::writeShortArray(data,n,label);
+	else
+		writeSwapped(data,n,sizeof(O_SHORT));
+}
+
+void OOStreamFile::writeLongArray(const O_LONG *data,size_t n,const char *label)
+// Write an array of n long words in one go.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	// A long that is not 4 bytes is swapped by writeLong as if it were.
+	if(_compact || (sizeof(O_LONG) != 4 && file()->needSwap()))
+		OOStream::writeLongArray(data,n,label);
+	else
+		writeSwapped(data,n,sizeof(O_LONG));
+}
+
+void OOStreamFile::writeLong64Array(const O_LONG64 *data,size_t n,const char *label)
+// Write an array of n 64 bit long words in one go.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	if(_compact)
+		OOStream::writeLong64Array(data,n,label);
+	else
+		writeSwapped(data,n,sizeof(O_LONG64));
+}
+
+void OOStreamFile::writeFloatArray(const float *data,size_t n,const char * /* label */)
+// Write an array of n floats in one go.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeSwapped(data,n,sizeof(float));
+}
+
+void OOStreamFile::writeDoubleArray(const double *data,size_t n,const char * /* label */)
+// Write an array of n doubles in one go.
+// label - a pointer to a descriptive label for the attribute or 0.
+{
+	writeSwapped(data,n,sizeof(double));
+}
+
+void OOStreamFile::writeSwapped(const void *data,size_t n,int size)
+// Write n values of size bytes, swapping them if the file needs it.
+{
+	if(!file()->needSwap())
+	{
+		writeData(data,n*size);
+		return;
+	}
+
+	// Swap a block at a time.
+	const size_t cBlock = 1024;
+	char buf[cBlock];
+	const char *p = (const char *)data;
+	size_t perBlock = cBlock/size;
+	while(n)
+	{
+		size_t m = min(n,perBlock);
+		if(size == 2)
+			OUtilityFunction::swapArray16(buf,p,m);
+		else if(size == 4)
+			OUtilityFunction::swapArray32(buf,p,m);
+		else
+			OUtilityFunction::swapArray64(buf,p,m);
+		writeData(buf,m*size);
+		p += m*size;
+		n -= m;
+	}
+}
+
 bool OOStreamFile::writeBlob(void *buf,OFilePos_t mark,unsigned long size,const char * /* label */)
 // Blob gets written straight to the file.
 // Returns true if data was actually written. false otherwise.
@@ -283,13 +426,23 @@ void OOStreamFile::writeBlobHeader(OFilePos_t mark,oulong blobLength)
 // ========================= P R I V A T E =======================================
 
 OOStreamFile::OOStreamFile(OFile *f):OOStream(f),
-		                      _fd(*f->fd()),_count(0),_ownsFile(false)
+		                      _fd(*f->fd()),_count(0),_calculateLengthOnly(false),
+		                      _ownsFile(false),
+		                      _compact(false),_compress(false),_compressed(false),
+		                      _image(0),_imageSize(0),_imageCapacity(0),
+		                      _packed(0),_packedCapacity(0),_keepPacked(false),
+		                      _packedBytes(0),_checksum(false),_crc(0)
 {
 	_fileLength = o_fileLength(_fd);
 }
 
 OOStreamFile::OOStreamFile(OFile *f,const char* fname,long operation):
-								OOStream(f),_count(0),_ownsFile(true)
+								OOStream(f),_count(0),_calculateLengthOnly(false),
+								_ownsFile(true),
+								_compact(false),_compress(false),_compressed(false),
+								_image(0),_imageSize(0),_imageCapacity(0),
+								_packed(0),_packedCapacity(0),_keepPacked(false),
+								_packedBytes(0),_checksum(false),_crc(0)
 {
 	_fd = o_fopen(fname,operation);
 	_fileLength = o_fileLength(_fd);
@@ -308,6 +461,9 @@ void OOStreamFile::close(void)
 
 OOStreamFile::~OOStreamFile(void)
 {
+	delete []_image;
+	delete []_packed;
+
 	if (_ownsFile)
 	{
 		// Close the file.
@@ -333,6 +489,37 @@ bool OOStreamFile::setLength(OFilePos_t size)
 	return true;
 }
 
+bool OOStreamFile::reserve(OFilePos_t size)
+// Reserve disk space for the file to grow to size bytes.
+// Return - true if the space was reserved.
+{
+	if(size <= _fileLength)
+		return true;
+	return o_reserve(_fd,size);
+}
+
+bool OOStreamFile::punchHole(OFilePos_t mark,OFilePos_t length)
+// Release the disk space of length bytes at mark.
+// Return - true if the space was released.
+{
+	return o_punchHole(_fd,mark,length);
+}
+
+ORawOrder OOStreamFile::rawOrder(void)const
+// Fixed width values are raw bytes unless the file is compact.
+{
+	if(_compact)
+		return cRawNone;
+	return _file->needSwap() ? cRawSwapped : cRawNative;
+}
+
+
+void OOStreamFile::writeVarint(OSYS_ULONG64 v)
+// Write an unsigned integer in as few bytes as possible(LEB128).
+{
+	unsigned char buf[OUtilityFunction::cMaxVarintLength];
+	writeData(buf,OUtilityFunction::encodeVarint(v,buf));
+}
 
 void OOStreamFile::writeData(const void *buf,size_t size)
 // Write data to the output buffer. If the buffer gets full then empty it
@@ -340,10 +527,30 @@ void OOStreamFile::writeData(const void *buf,size_t size)
 {
 	_count += (OFilePos_t)size;
 
+	if(_compress)
+	{
+		// Collect the whole object. It is compressed by finish().
+		if(_imageSize + (long)size > _imageCapacity)
+		{
+			long capacity = max(2*_imageCapacity,_imageSize + (long)size);
+			char *image = new char[capacity];
+			memcpy(image,_image,_imageSize);
+			delete []_image;
+			_image = image;
+			_imageCapacity = capacity;
+		}
+		memcpy(_image + _imageSize,buf,size);
+		_imageSize += (long)size;
+		return;
+	}
+
 	if (_calculateLengthOnly)
 	{
 		return;
 	}
+
+	if(_checksum)
+		_crc = OCRC32C::update(_crc,buf,size);
 	
 	// Write large buffers without copying to an intermediate buffer
 	if(size > (size_t)_ostr.bufferSize())
@@ -403,10 +610,12 @@ void OOStreamFile::writeDataAt(OFilePos_t mark,void *buf,unsigned long size)
 
 	// Should handle huge data ???
 	long err = o_fwrite(buf,size,1,_fd);
+	_file->count(&OFileStats::writes);
 	if (err != 1)
 	{
 		throw OFileIOErr("Write failure.");
 	}
+	_file->count(&OFileStats::bytesWritten,size);
 }
 
 void OOStreamFile::writeFile(const char *fname,OFilePos_t mark,oulong from,oulong size)
@@ -436,6 +645,8 @@ void OOStreamFile::writeFile(const char *fname,OFilePos_t mark,oulong from,oulon
 
 		long nBlobBytesRead = o_fread(buf,1,max(cBufSize,size % cBufSize),fd);
 		long nBlobBytesWritten = o_fwrite(buf, 1, nBlobBytesRead, _fd);
+		_file->count(&OFileStats::writes);
+		_file->count(&OFileStats::bytesWritten,nBlobBytesWritten);
 
 		oFAssert(nBlobBytesWritten == nBlobBytesRead);
 	}
@@ -453,6 +664,9 @@ void OOStreamFile::start(OFilePos_t mark,long size,bool calcLength)
 	// virtual base has not been written
 	_VBWritten = false;
 	_count = 0;
+	_imageSize = 0;
+	_compressed = false;
+	_crc = 0;
 	_calculateLengthOnly = calcLength;
 	if(calcLength)
 		return;
@@ -463,7 +677,11 @@ void OOStreamFile::start(OFilePos_t mark,long size,bool calcLength)
 
 long OOStreamFile::finish(void)
 // Finish writing an object
+// Return - The length of the object in the file.
 {
+	if(_compress)
+		return finishCompressed();
+
 	if(!_calculateLengthOnly)
 	{
 		// Check that everything we said we would write is written.
@@ -476,6 +694,105 @@ long OOStreamFile::finish(void)
 	return _count;
 }
 
+// Objects smaller than this are not worth compressing.
+static const long cMinCompress = 64;
+
+long OOStreamFile::finishCompressed(void)
+// Finish writing an object that is collected in _image.
+// A compressed object is the uncompressed length(4 bytes, least significant
+// first) followed by the data compressed by OLZ. Objects that do not get
+// smaller are written as they are.
+// Return - The length of the object in the file.
+// Exceptions: OFileErr is thrown if the object kept for its mark by the
+// length pass has another length.
+{
+	const char *data = _image;
+	_count = _imageSize;
+
+	// The object as compressed when its length was calculated.
+	std::vector<char> kept;
+	PackedObjects::iterator it;
+	if(!_calculateLengthOnly && _imageSize >= cMinCompress &&
+	   (it = _packedObjects.find(_mark)) != _packedObjects.end())
+	{
+		if((*it).second._imageSize != _imageSize)
+			throw OFileErr("An object was written with another length than was calculated.");
+		kept.swap((*it).second._data);
+		_packedBytes -= (long)(kept.size() + sizeof(Packed));
+		_packedObjects.erase(it);
+		if(!kept.empty())
+		{
+			data = &kept[0];
+			_count = kept.size();
+			_compressed = true;
+		}
+	}
+	else if(_imageSize >= cMinCompress)
+	{
+		if(_packedCapacity < _imageSize)
+		{
+			delete []_packed;
+			_packed = new char[_imageSize];
+			_packedCapacity = _imageSize;
+		}
+
+		long packed = _lz.compress(_image,_imageSize,_packed + 4,_imageSize - 5);
+		if(packed)
+		{
+			for(int i = 0; i < 4; i++)
+				_packed[i] = (char)(_imageSize >> (8*i));
+			data = _packed;
+			_count = packed + 4;
+			_compressed = true;
+		}
+	}
+
+	if(!_calculateLengthOnly)
+	{
+		// Check that everything we said we would write is written.
+		oFAssert(_count == (OFilePos_t)_toWrite);
+
+		if(_checksum)
+			_crc = OCRC32C::compute(data,_count);
+		writeDataAt(_mark,(void *)data,_count);
+		_toWrite = 0;
+	}
+	return _count;
+}
+
+void OOStreamFile::keepPacked(bool keep)
+// Start or stop keeping the objects that are compressed while their lengths
+// are calculated. What was kept is released.
+{
+	_keepPacked = keep;
+	PackedObjects().swap(_packedObjects);
+	_packedBytes = 0;
+}
+
+void OOStreamFile::packedAt(OFilePos_t mark)
+// Keep the object whose length was calculated last, as it was compressed,
+// to be written at mark. Objects beyond the budget are compressed again
+// when they are written.
+{
+	if(!_keepPacked || !_calculateLengthOnly || _imageSize < cMinCompress)
+		return;
+	long bytes = (long)((_compressed ? _count : 0) + sizeof(Packed));
+	if(_packedBytes + bytes > cPackedBudget)
+		return;
+
+	std::pair<PackedObjects::iterator,bool> ins =
+		_packedObjects.insert(PackedObjects::value_type(mark,Packed()));
+	Packed &p = (*ins.first).second;
+	if(!ins.second)
+		_packedBytes -= (long)(p._data.size() + sizeof(Packed));
+	p._imageSize = _imageSize;
+	if(_compressed)
+		p._data.assign(_packed,_packed + _count);
+	else
+		p._data.clear();
+	_packedBytes += bytes;
+}
+
 // OBuffer is used to buffer the output. It is probably unnecessary on most OS's as
 // the OS buffers it.
 OOStream::OBuffer::OBuffer(void)
@@ -32,8 +32,11 @@ SOFTWARE.
 
 
 #include <stdio.h>
+#include <vector>
+#include <map>
 //#include "obuf.h"
 #include "oio.h"
+#include "olz.h"
 
 class OFile;
 class FreeList;
@@ -76,7 +79,7 @@ public:
 	};			
 			
 	OOStream(OFile *f):_file(f),_VBWritten(false){}
-	~OOStream(void){}
+	virtual ~OOStream(void){}
 	virtual void writeLong(O_LONG data,const char *label = 0) = 0;
 	virtual void writeLong64(O_LONG64 data,const char *label = 0) = 0;
 	virtual void writeFloat(float data,const char *label = 0) = 0;
@@ -94,6 +97,13 @@ public:
 	//
 	virtual void writeBytes(const void *buf,size_t nBytes,const char *label = 0) = 0;
 	virtual void writeBits(const void *buf,size_t nBytes,const char *label = 0) = 0;
+	// Arrays of n values. n is not written, so the reader must know it.
+	// By default the values are written one at a time.
+	virtual void writeShortArray(const O_SHORT *data,size_t n,const char *label = 0);
+	virtual void writeLongArray(const O_LONG *data,size_t n,const char *label = 0);
+	virtual void writeLong64Array(const O_LONG64 *data,size_t n,const char *label = 0);
+	virtual void writeFloatArray(const float *data,size_t n,const char *label = 0);
+	virtual void writeDoubleArray(const double *data,size_t n,const char *label = 0);
 	virtual void writeObjectId(OId,const char *label = 0) = 0;
 	virtual void writeObject(OPersist *,const char *label = 0) = 0;
 	virtual bool writeBlob(void *buf,OFilePos_t mark,unsigned long size,const char *label = 0) = 0;
@@ -106,6 +116,9 @@ public:
 	OFile *file(void){return _file;}
 	// Stream is actually writing to the file.
 	virtual bool writing(void)const = 0;
+	// Do not need to override. The byte order of fixed width values if they
+	// are stored as raw bytes. Used by OFastWrite.
+	virtual ORawOrder rawOrder(void)const{return cRawNone;}
 
 	bool VBWrite(void);
 
@@ -149,6 +162,11 @@ private:
 	//
 	void writeBytes(const void *buf,size_t nBytes,const char *label = 0);
 	void writeBits(const void *buf,size_t nBytes,const char *label = 0);
+	void writeShortArray(const O_SHORT *data,size_t n,const char *label = 0);
+	void writeLongArray(const O_LONG *data,size_t n,const char *label = 0);
+	void writeLong64Array(const O_LONG64 *data,size_t n,const char *label = 0);
+	void writeFloatArray(const float *data,size_t n,const char *label = 0);
+	void writeDoubleArray(const double *data,size_t n,const char *label = 0);
 	void writeObjectId(OId,const char *label = 0);
 	void writeObject(OPersist *,const char *label = 0);
 	bool writeBlob(void *buf,OFilePos_t mark,unsigned long size,const char *label = 0);
@@ -160,15 +178,37 @@ private:
 	void close(void);
 	void open(const char *fname,long operation);
 	bool setLength(OFilePos_t size);
+	bool reserve(OFilePos_t size);
+	bool punchHole(OFilePos_t mark,OFilePos_t length);
+	// Write integers in the compact encoding.
+	void setCompact(bool compact){_compact = compact;}
+	void writeVarint(OSYS_ULONG64 v);
+	void writeSwapped(const void *data,size_t n,int size);
+	// Compress objects. An object is only compressed if it gets smaller.
+	void setCompress(bool compress){_compress = compress;}
+	// The last object written was compressed.
+	bool compressed(void)const{return _compressed;}
+	// Keep the objects compressed while calculating their lengths, up to
+	// cPackedBudget bytes, so that they are not compressed again when they
+	// are written.
+	void keepPacked(bool keep);
+	// The object whose length was calculated last is written at mark.
+	void packedAt(OFilePos_t mark);
+	enum {cPackedBudget = 0x1000000};
+	// Keep a checksum of what is written since start().
+	void setChecksum(bool checksum){_checksum = checksum;}
+	OSYS_ULONG32 crc(void)const{return _crc;}
 
 	void start(OFilePos_t mark,long size,bool calcLength = false);
 	long finish(void);
+	long finishCompressed(void);
 	void writeData(const void *buf,size_t size);
 	void writeDataAt(OFilePos_t mark,void *buf,unsigned long size);
 	void writeFile(const char *fname,OFilePos_t mark,oulong from,oulong size);
 	OFilePos_t length(void)const{return _count;}
 	// Stream is actually writing to the file.
 	bool writing(void)const{return !_calculateLengthOnly;}
+	ORawOrder rawOrder(void)const;
 
 private:
 	O_fd _fd;
@@ -179,6 +219,25 @@ private:
 	OBuffer _ostr;
 	bool _calculateLengthOnly;
 	bool _ownsFile;
+	bool _compact;    // Integers are variable length
+	bool _compress;   // Compress objects
+	bool _compressed; // The object written was compressed
+	char *_image;     // Uncompressed object when compressing
+	long _imageSize;
+	long _imageCapacity;
+	char *_packed;    // Compressed object
+	long _packedCapacity;
+	OLZ _lz;
+	struct Packed{
+		long _imageSize;         // Uncompressed length
+		std::vector<char> _data; // Compressed object; empty if not compressed
+	};
+	typedef std::map<OFilePos_t,Packed> PackedObjects;
+	bool _keepPacked;
+	PackedObjects _packedObjects; // Objects compressed by the length pass by mark
+	long _packedBytes;            // Bytes kept in _packedObjects
+	bool _checksum;   // Keep a checksum
+	OSYS_ULONG32 _crc;
 };
 
 
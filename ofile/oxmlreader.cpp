@@ -25,6 +25,11 @@ SOFTWARE.
 #include "oxmlreader.h"
 #include "ConvertUTF.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OXML_SSE2
+#include <emmintrin.h>
+#endif
+
 using namespace std;
 
 static const XMLCh cData[] = {'!','[','C','D','A','T','A','['};
@@ -82,64 +87,125 @@ void OXMLReader::copyBufTo(XMLCh *name)const
 
 // From convertUTF.cpp
 extern const char trailingBytesForUTF8[];
+
+static const char *scanText(const char *p,const char *end,char delim)
+// Return a pointer to the first byte in [p,end) that is delim, a newline or
+// not 7 bit ASCII. Return end if there is none.
+{
+#if defined(OXML_SSE2)
+	const __m128i vDelim = _mm_set1_epi8(delim);
+	const __m128i vNewLine = _mm_set1_epi8('\n');
+	for(;end - p >= 16;p += 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *)p);
+		int mask = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v,vDelim),
+		                                                       _mm_cmpeq_epi8(v,vNewLine)),v));
+		if(mask)
+		{
+			while(!(mask & 1))
+			{
+				mask >>= 1;
+				p++;
+			}
+			return p;
+		}
+	}
+#endif
+	for(;p < end;p++)
+	{
+		if(*p == delim || *p == '\n' || (*p & 0x80))
+			break;
+	}
+	return p;
+}
+
+bool OXMLReader::fillBuffer()
+// Move any undecoded bytes to the start of the input buffer and fill the rest
+// from the stream.
+// Return true if more bytes were read.
+{
+	size_t left = _inEnd - _inPos;
+	memmove(_inBuf,_inPos,left);
+	_inPos = _inBuf;
+	_inEnd = _inBuf + left;
+	if(!_in->eof())
+	{
+		_in->read(_inBuf + left,cInBufLen - left);
+		_inEnd += _in->gcount();
+	}
+	return (size_t)(_inEnd - _inPos) > left;
+}
+
 bool OXMLReader::getChar(XMLCh *c)
 // Get a character from the input stream. 
 // If the end of the file or any other error occurs the false is returned and c is set to 0
 // Return true is there are more characters to get.
 {
-	// Read character
-	char cin;
-	_in->get(cin);
-
-	if(_in->eof())
+	if(_inPos == _inEnd && !fillBuffer())
 	{
 		*c = 0;
 		return false;
 	}
+
+	char nTrailing = trailingBytesForUTF8[(unsigned char)*_inPos];
+	if(nTrailing == 0)
+		// Simple character
+		*c = (XMLCh)*_inPos++;
 	else
 	{
-		char nTrailing = trailingBytesForUTF8[(unsigned char)cin];
-		if(nTrailing == 0)
-			// Simple character
-			*c = (XMLCh)cin;
-		else
+		// Complex character. Make sure that all of it is in the buffer.
+		if(_inEnd - _inPos <= nTrailing && (!fillBuffer() || _inEnd - _inPos <= nTrailing))
 		{
-			// Complex character
-			char source[6];
-			source[0] = cin;
-			XMLCh *pTarget = c;
-
-			char *psource = &source[1];
-			// Add the trailing characters.
-			switch(nTrailing)
-			{
-			case 5: _in->get(*psource++);
-			case 4: _in->get(*psource++);
-			case 3: _in->get(*psource++);
-			case 2: _in->get(*psource++);
-			case 1: _in->get(*psource++);
-			}
-			if(_in->eof())
-			{
-				*c = 0;
-				return false;
-			}
-
-			unsigned char *pend = (unsigned char *)psource;
-			psource = &source[0];
-			ConversionResult res = ConvertUTF8toUTF16 ((const unsigned char **)&psource, pend, &pTarget, c+1, lenientConversion);
-		    OFILE_UNUSED(res);
+			_inPos = _inEnd;
+			*c = 0;
+			return false;
 		}
-		if(*c == (XMLCh)'\n')
-		{
-			// Next line
-			_column = -1;
-			_line++;
-		}else
-			// Next column
-			_column++;
+		XMLCh *pTarget = c;
+		const unsigned char *psource = (const unsigned char *)_inPos;
+		_inPos += nTrailing + 1;
+		ConversionResult res = ConvertUTF8toUTF16 (&psource, (const unsigned char *)_inPos, &pTarget, c+1, lenientConversion);
+		if(res != conversionOK)
+			// Malformed, or needs a surrogate pair that does not fit in one XMLCh.
+			*c = 0xFFFD;
+	}
+	if(*c == (XMLCh)'\n')
+	{
+		// Next line
+		_column = -1;
+		_line++;
+	}else
+		// Next column
+		_column++;
 
-		return true;
+	return true;
+}
+
+void OXMLReader::appendText(char delim)
+// Append the run of plain ASCII characters that starts at the current input
+// position, up to but not including delim, a newline or a multi-byte character.
+// The character that ends the run is left for getChar().
+{
+	for(;;)
+	{
+		if(_inPos == _inEnd && !fillBuffer())
+			return;
+		const char *run = scanText(_inPos,_inEnd,delim);
+		while(_inPos < run)
+		{
+			// Copy as much as fits in the character buffer.
+			int n = &_charBuf[cCharBufLen] - _pCharBuf;
+			if(n > run - _inPos)
+				n = run - _inPos;
+			for(int i = 0; i < n; i++)
+				_pCharBuf[i] = (XMLCh)_inPos[i];
+			_pCharBuf += n;
+			_inPos += n;
+			_column += n;
+			if (_pCharBuf == &_charBuf[cCharBufLen])
+				sendCharacters();
+		}
+		if(_inPos != _inEnd)
+			return;
 	}
 }
 
@@ -332,7 +398,7 @@ void OXMLReader::attributeValue()
 void OXMLReader::value()
 {
 	XMLCh c;
-	while (getChar(&c))
+	while (appendText('<'), getChar(&c))
 	{
 		if(c == (XMLCh)'<')
 		{
@@ -364,7 +430,7 @@ void OXMLReader::value()
 void OXMLReader::stringValue()
 {
 	XMLCh c;
-	while (getChar(&c))
+	while (appendText('"'), getChar(&c))
 	{
 		if(c == (XMLCh)'"')
 		{
@@ -388,7 +454,7 @@ void OXMLReader::stringValue()
 void OXMLReader::cdata()
 {
 	XMLCh c;
-	while (getChar(&c))
+	while (appendText(']'), getChar(&c))
 	{
 		if(c == ']')
 		{
@@ -535,6 +601,7 @@ void OXMLReader::parseSetup()
 // Private.
 {
 	_resumeState = _state = &OXMLReader::search;
+	_inPos = _inEnd = _inBuf;
 	clearCharacters();
 	_attributes.reset();
 }
@@ -547,7 +614,9 @@ OXMLReader::OXMLReader(): _fDocHandler(0),
                           _in(0),
 						  _pCharBuf(&_charBuf[0]),
 						  _line(1),
-						  _column(-1)
+						  _column(-1),
+						  _inPos(_inBuf),
+						  _inEnd(_inBuf)
 {
 }
 
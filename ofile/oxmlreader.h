@@ -55,6 +55,10 @@ SOFTWARE.
 // The parser is implemented as a state machine. There is a function to handle each state.
 // Transition to a new state is achieved by assigning a pointer to the function of that state
 // to the _state member.
+// Input is read from the stream in large blocks. Runs of plain ASCII text are scanned for
+// the next delimiter and copied straight to the character buffer; everything else goes
+// through getChar(). The reader may therefore read ahead of the markup it has parsed, so
+// parseFirst() and parse() always start with an empty buffer. Use parseNext() to continue.
 //
 // ToDo
 // Handling UTF-16 + detection of encoding.
@@ -151,8 +155,10 @@ private:
 	void endTag();
 	void search();
 
-	// Input function
+	// Input functions
 	bool getChar(XMLCh *);
+	bool fillBuffer();
+	void appendText(char delim);
 
 	void appendCharacters(const XMLCh );
 	void sendCharacters();
@@ -174,7 +180,7 @@ private:
 	// Buffer length should be divisible by 3 and 4 in order to enable strings
 	// consisting of BinHex and space separated hex (e.g. AE )to be send without
 	// breaking in the middle of a character.
-	enum {cCharBufLen = 204,cLocalNameLen = 100};
+	enum {cCharBufLen = 204,cLocalNameLen = 100,cInBufLen = 0x4000};
 	OAttributes _attributes;		// Attributes vector.
 	XMLCh _localName[cLocalNameLen];// Tag name.
 	XMLCh _charBuf[cCharBufLen];	// Buffer of characters to send to content handler.
@@ -182,6 +188,9 @@ private:
 	bool _progressive;				// True if parsing stops after every element.
 	int _line;						// Last line number read.
 	int _column;					// Last column read.
+	char _inBuf[cInBufLen];			// Block of bytes read from the input stream.
+	const char *_inPos;				// Next byte to decode in _inBuf.
+	const char *_inEnd;				// End of valid bytes in _inBuf.
 };
 
 class OContentHandler
@@ -64,6 +64,18 @@ LOCAL_C_INCLUDES := $(SRC_ROOT)/ofile
 LOCAL_STATIC_LIBRARIES := ofile
 
 
+include $(BUILD_EXECUTABLE)
+#############################################################################
+
+include $(CLEAR_VARS)
+
+LOCAL_MODULE    := bm_fast
+LOCAL_SRC_FILES := $(SRC_ROOT)/test/bm_fast.cpp
+LOCAL_C_INCLUDES := $(SRC_ROOT)/ofile 
+
+LOCAL_STATIC_LIBRARIES := ofile
+
+
 include $(BUILD_EXECUTABLE)
 #############################################################################
 #include $(CLEAR_VARS)
@@ -59,7 +59,7 @@ $(TARGET_PLATFORM)_$(PROJECT) : CC_FLAGS =  -c -g -m32 -fno-common -fmessage-len
 $(TARGET_PLATFORM)_$(PROJECT) : CC_SYMBOLS += $(patsubst %,-D%, $(CC_TESTS))
 $(TARGET_PLATFORM)_$(PROJECT) : LD_FLAGS =  -m32 -Wl,-Map=$(basename $@).map
 #$(TARGET_PLATFORM)_$(PROJECT) : LD_SYS_LIBS = -lrt -lpthread  -lm -lc -lgcc 
-$(TARGET_PLATFORM)_$(PROJECT) : LD_SYS_LIBS =  -lm -lc -lgcc 
+$(TARGET_PLATFORM)_$(PROJECT) : LD_SYS_LIBS =  -lpthread -lm -lc -lgcc 
 
 ifeq ($(DEBUG), 1)
   $(info $(TARGET_PLATFORM)_$(PROJECT) "DEBUG")
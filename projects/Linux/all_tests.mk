@@ -24,13 +24,20 @@ OFILE_SRC   = 	$(SRC_ROOT)/ofile/ofile.cpp \
 				$(SRC_ROOT)/ofile/oistrm.cpp \
 				$(SRC_ROOT)/ofile/oosxml.cpp \
 				$(SRC_ROOT)/ofile/oisxml.cpp \
+				$(SRC_ROOT)/ofile/oisimport.cpp \
+				$(SRC_ROOT)/ofile/oosbin.cpp \
+				$(SRC_ROOT)/ofile/oisbin.cpp \
+				$(SRC_ROOT)/ofile/oosjson.cpp \
+				$(SRC_ROOT)/ofile/oisjson.cpp \
 				$(SRC_ROOT)/ofile/ox.cpp \
 				$(SRC_ROOT)/ofile/oxmlreader.cpp \
 				$(SRC_ROOT)/ofile/oiter.cpp \
+				$(SRC_ROOT)/ofile/olz.cpp \
 				$(SRC_ROOT)/ofile/ox.cpp \
 				$(SRC_ROOT)/ofile/oblob.cpp \
 				$(SRC_ROOT)/ofile/oblobp.cpp \
 				$(SRC_ROOT)/ofile/oconvert.cpp \
+				$(SRC_ROOT)/ofile/ocrc.cpp \
 				$(SRC_ROOT)/ofile/ConvertUTF.cpp \
 
 
@@ -61,6 +68,48 @@ PROJECT=bm_db
 $(PROJECT)_ADDITIONAL_SOURCES:= $(SRC_ROOT)/test/bm_db.cpp $(SRC_ROOT)/test/mmyclass.cpp $(OFILE_SRC)
 																						
 
+include BUILD_TEST_$(TARGET_PLATFORM).mk
+#========================================================================
+PROJECT=bm_fast
+
+$(PROJECT)_ADDITIONAL_SOURCES:= $(SRC_ROOT)/test/bm_fast.cpp $(OFILE_SRC)
+																						
+
+include BUILD_TEST_$(TARGET_PLATFORM).mk
+#========================================================================
+PROJECT=fmttest
+
+$(PROJECT)_ADDITIONAL_SOURCES:= $(SRC_ROOT)/test/fmttest.cpp $(OFILE_SRC)
+																						
+
+include BUILD_TEST_$(TARGET_PLATFORM).mk
+#========================================================================
+PROJECT=xchgtest
+
+$(PROJECT)_ADDITIONAL_SOURCES:= $(SRC_ROOT)/test/xchgtest.cpp $(OFILE_SRC)
+																						
+
+include BUILD_TEST_$(TARGET_PLATFORM).mk
+#========================================================================
+PROJECT=foreachtest
+
+$(PROJECT)_ADDITIONAL_SOURCES:= $(SRC_ROOT)/test/foreachtest.cpp $(OFILE_SRC)
+																						
+
+include BUILD_TEST_$(TARGET_PLATFORM).mk
+#========================================================================
+PROJECT=spacetest
+
+$(PROJECT)_ADDITIONAL_SOURCES:= $(SRC_ROOT)/test/spacetest.cpp $(OFILE_SRC)
+																						
+
+include BUILD_TEST_$(TARGET_PLATFORM).mk
+#========================================================================
+PROJECT=blobiotest
+
+$(PROJECT)_ADDITIONAL_SOURCES:= $(SRC_ROOT)/test/blobiotest.cpp $(OFILE_SRC)
+																						
+
 include BUILD_TEST_$(TARGET_PLATFORM).mk
 #========================================================================
 PROJECT=blobtest
@@ -0,0 +1,386 @@
+//
+// ObjectFile blob io test program. Changes parts of large blobs without
+// reading them into memory, grows them, rewrites single chunks of chunked
+// blobs and reads blobs from a mapped file, checking the data against a
+// copy kept in memory. Also keeps blobs within a memory budget.
+//
+
+#include "odefs.h"
+#include <iostream>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "ofile.h"
+#include "ox.h"
+#include "opersist.h"
+#include "oblobp.h"
+#include "oblob.h"
+#include "ochunk.h"
+#include "tcheck.h"
+
+using namespace std;
+
+template <class Blob,OClassId_t cId>
+class Holder : public OPersist
+// An object with a blob of type Blob.
+{
+	typedef OPersist inherited;
+public:
+	Holder(void){}
+	Holder(const Blob &blob):_blob(blob){}
+	Holder(OIStream *in):inherited(in),_blob(in){}
+	void oWrite(OOStream *out)const
+	{
+		inherited::oWrite(out);
+		_blob.oWrite(out);
+	}
+	void oAttach(OFile *file,bool deep)
+	{
+		inherited::oAttach(file,deep);
+		_blob.oAttach(file);
+	}
+	void oDetach(OFile *file,bool deep)
+	{
+		inherited::oDetach(file,deep);
+		_blob.oDetach(file);
+	}
+	OMeta *meta(void)const{return &_metaClass;}
+	static OPersist *New(OIStream *s){return new Holder(s);}
+	static OMeta _metaClass;
+
+	Blob &blob(void){return _blob;}
+
+private:
+	Blob _blob;
+};
+
+template <class Blob,OClassId_t cId>
+OMeta Holder<Blob,cId>::_metaClass(cId,(Func)Holder<Blob,cId>::New,cOPersist,0);
+
+typedef Holder<OBlobP,97> HolderP;
+typedef Holder<OBlob,98> HolderT;
+
+template class Holder<OBlobP,97>;
+template class Holder<OBlob,98>;
+template class Holder<OChunkBlobT<OBlobP>,99>;
+template class Holder<OChunkBlob,100>;
+
+const size_t cBlobLength = 300000;
+const oulong cChunkSize = 4096;
+
+static unsigned long sRandom = 1;
+
+static unsigned long nextRandom(unsigned long n)
+// A number from 0 to n - 1, the same on every platform.
+{
+	sRandom = sRandom*1103515245UL + 12345UL;
+	return (unsigned long)((sRandom >> 16) & 0x7fff)*(unsigned long)((sRandom >> 8) & 0xff) % n;
+}
+
+static string makeData(size_t length,int seed)
+{
+	string data(length,0);
+	for(size_t i = 0; i < length; i++)
+		data[i] = (char)(i*7 + seed + i/1000);
+	return data;
+}
+
+template <class Blob>
+bool same(const Blob &blob,const string &data)
+// The blob is data, read with readRange() a piece at a time.
+{
+	if(blob.size() != data.size())
+		return false;
+	char buf[777];
+	for(oulong pos = 0; pos < data.size(); pos += sizeof(buf))
+	{
+		oulong n = data.size() - pos < sizeof(buf) ? data.size() - pos : sizeof(buf);
+		blob.readRange(pos,n,buf);
+		if(memcmp(buf,data.data() + pos,n) != 0)
+			return false;
+	}
+	return true;
+}
+
+template <class Blob>
+bool sameRead(const Blob &blob,const string &data)
+// The blob is data, read with a Reader.
+{
+	typename Blob::Reader reader(blob);
+	char buf[1000];
+	oulong pos = 0;
+	oulong n;
+	while((n = reader.read(buf,sizeof(buf))) != 0)
+	{
+		if(pos + n > data.size() || memcmp(buf,data.data() + pos,n) != 0)
+			return false;
+		pos += n;
+	}
+	return reader.eof() && pos == data.size();
+}
+
+template <class H>
+OId create(const char *name,long flags,const string &data,H *holder)
+// Create a file with holder, whose blob is data. Return its id.
+{
+	remove(name);
+	OFile file(name,OFILE_CREATE | OFILE_CHECKSUM | flags);
+	holder->blob().append(data.data(),data.size());
+	file.attach(holder);
+	file.commit();
+	tCheck(same(holder->blob(),data));
+	return holder->oId();
+}
+
+template <class Blob>
+void changeRanges(Blob &blob,string &data)
+// Write some ranges of the blob, and append to it with a Writer, so that it
+// grows past its length in the file.
+{
+	for(int i = 0; i < 20; i++)
+	{
+		oulong offset = nextRandom((unsigned long)data.size());
+		oulong length = nextRandom(5000);
+		if(offset + length > data.size())
+			length = data.size() - offset;
+		string piece = makeData(length,i + 1);
+		blob.writeRange(offset,length,piece.data());
+		data.replace(offset,length,piece);
+	}
+
+	// Writes over the end and past it.
+	typename Blob::Writer writer(blob,data.size() - 500);
+	string piece = makeData(3000,99);
+	for(int i = 0; i < 10; i++)
+		writer.write(piece.data(),piece.size());
+	data.resize(data.size() - 500);
+	for(int i = 0; i < 10; i++)
+		data += piece;
+	tCheck(writer.tell() == data.size());
+
+	string tail = makeData(123,5);
+	blob.append(tail.data(),tail.size());
+	data += tail;
+}
+
+template <class Blob,OClassId_t cId>
+void testRanges(const char *name,long flags)
+// Change a blob of a file a range at a time, commit it and read it back
+// in the same file and when it is opened again.
+{
+	typedef Holder<Blob,cId> H;
+	string data = makeData(cBlobLength,0);
+	OId id = create(name,flags,data,new H);
+
+	for(int pass = 0; pass < 2; pass++)
+	{
+		OFile file(name,OFILE_OPEN_FOR_WRITING | flags);
+		H *holder = (H *)file.getObject(id);
+		tCheck(holder != 0);
+		changeRanges(holder->blob(),data);
+		holder->oSetDirty();
+
+		// The changes are read back before they are committed.
+		tCheck(same(holder->blob(),data));
+		tCheck(sameRead(holder->blob(),data));
+		char last;
+		holder->blob().readRange(data.size() - 1,1,&last);
+		tCheck(last == data[data.size() - 1]);
+
+		file.commit();
+		tCheck(same(holder->blob(),data));
+		tCheck(file.verify() == 0);
+		holder->oSetPurgeable();
+	}
+
+	OFile file(name,OFILE_OPEN_READ_ONLY | flags);
+	H *holder = (H *)file.getObject(id);
+	tCheck(same(holder->blob(),data));
+	tCheck(sameRead(holder->blob(),data));
+	tCheck(file.verify() == 0);
+	holder->oSetPurgeable();
+	cout << name << " ranges OK\n";
+}
+
+static void testGrowInFile(void)
+// A blob that is not in memory and grows is moved in the file without
+// being read into memory.
+{
+	const char *name = "blobgrow.db";
+	string data = makeData(cBlobLength,3);
+	OId id = create(name,0,data,new HolderP);
+
+	{
+		OFile file(name,OFILE_OPEN_FOR_WRITING);
+		HolderP *holder = (HolderP *)file.getObject(id);
+		unsigned long memory = OBlobP::currentTotalMemoryUsage();
+		string tail = makeData(cBlobLength/2,4);
+		holder->blob().append(tail.data(),tail.size());
+		data += tail;
+		holder->oSetDirty();
+		file.commit();
+		tCheck(OBlobP::currentTotalMemoryUsage() == memory);
+		tCheck(same(holder->blob(),data));
+		tCheck(file.verify() == 0);
+		holder->oSetPurgeable();
+	}
+
+	OFile file(name,OFILE_OPEN_READ_ONLY);
+	HolderP *holder = (HolderP *)file.getObject(id);
+	tCheck(same(holder->blob(),data));
+	tCheck(string(holder->blob().const_getBlob(),holder->blob().size()) == data);
+	holder->oSetPurgeable();
+	cout << name << " grown in the file OK\n";
+}
+
+template <class Blob,OClassId_t cId>
+void testChunks(const char *name)
+// Only the chunk that is changed is written by commit.
+{
+	typedef Holder<Blob,cId> H;
+	string data = makeData(cBlobLength,6);
+	OId id = create(name,0,data,new H(Blob(cChunkSize)));
+
+	{
+		OFile file(name,OFILE_OPEN_FOR_WRITING);
+		H *holder = (H *)file.getObject(id);
+		tCheck(holder->blob().chunks() == (cBlobLength + cChunkSize - 1)/cChunkSize);
+		OFileStats before = file.stats();
+		string piece = makeData(1000,7);
+		holder->blob().writeRange(5*cChunkSize + 100,piece.size(),piece.data());
+		data.replace(5*cChunkSize + 100,piece.size(),piece);
+		holder->oSetDirty();
+		file.commit();
+		OSYS_ULONG64 written = file.stats().bytesWritten - before.bytesWritten;
+		tCheck(written < (OSYS_ULONG64)(cBlobLength/10));
+		tCheck(same(holder->blob(),data));
+		tCheck(file.verify() == 0);
+		holder->oSetPurgeable();
+	}
+
+	OFile file(name,OFILE_OPEN_READ_ONLY);
+	H *holder = (H *)file.getObject(id);
+	tCheck(same(holder->blob(),data));
+	Blob copy(holder->blob());
+	tCheck(same(copy,data));
+	holder->oSetPurgeable();
+	cout << name << " single chunk rewritten OK\n";
+}
+
+static void testMappedView(void)
+// A file opened read only with OFILE_MMAP gives the data of blobs in place.
+{
+	const char *name = "blobmap.db";
+	string data = makeData(cBlobLength,8);
+	OId idP = create(name,0,data,new HolderP);
+	OId idT;
+	{
+		OFile file(name,OFILE_OPEN_FOR_WRITING);
+		HolderT *holder = new HolderT;
+		holder->blob().append(data.data(),data.size());
+		file.attach(holder);
+		file.commit();
+		idT = holder->oId();
+	}
+
+	OFile file(name,OFILE_OPEN_READ_ONLY | OFILE_MMAP);
+	bool mapped = file.view(0,1) != 0;
+	HolderP *holderP = (HolderP *)file.getObject(idP);
+	HolderT *holderT = (HolderT *)file.getObject(idT);
+	unsigned long memory = OBlobP::currentTotalMemoryUsage();
+	const char *view = holderP->blob().view();
+	tCheck(memcmp(view,data.data(),data.size()) == 0);
+	tCheck(memcmp(holderT->blob().view(),data.data(),data.size()) == 0);
+	tCheck(same(holderP->blob(),data));
+	tCheck(same(holderT->blob(),data));
+	if(mapped)
+	{
+		// The data is not copied into memory.
+		tCheck(OBlobP::currentTotalMemoryUsage() == memory);
+		const char *start = file.view(0,1);
+		tCheck(view > start && view < start + file.spaceStats().fileLength);
+	}
+	tCheck(file.verify() == 0);
+	holderP->oSetPurgeable();
+	holderT->oSetPurgeable();
+	cout << name << (mapped ? " mapped" : " not mapped") << " views OK\n";
+}
+
+static void testMemoryBudget(void)
+// Blobs read into memory beyond the budget purge those least recently
+// used, which are read again when they are next used. With
+// OF_MULTI_THREAD no budget can be set.
+{
+#ifdef OF_MULTI_THREAD
+	bool thrown = false;
+	try{
+		OBlobP::setMemoryBudget(100000);
+	}catch(OFileErr &){
+		thrown = true;
+	}
+	tCheck(thrown);
+	tCheck(OBlobP::memoryBudget() == 0);
+	cout << "No blob memory budget with threads OK\n";
+#else
+	const char *name = "blobbudget.db";
+	const int cBlobs = 10;
+	const unsigned long cBudget = 3*cBlobLength;
+	OId ids[cBlobs];
+	remove(name);
+	{
+		OFile file(name,OFILE_CREATE);
+		for(int i = 0; i < cBlobs; i++)
+		{
+			HolderP *holder = new HolderP;
+			string data = makeData(cBlobLength,i);
+			holder->blob().copyToBlob(data.data(),data.size());
+			file.attach(holder);
+			ids[i] = holder->oId();
+		}
+		file.commit();
+	}
+
+	OFile file(name,OFILE_OPEN_READ_ONLY);
+	unsigned long memory = OBlobP::currentTotalMemoryUsage();
+	OBlobP::setMemoryBudget(memory + cBudget);
+	HolderP *holders[cBlobs];
+	for(int pass = 0; pass < 2; pass++)
+	{
+		for(int i = 0; i < cBlobs; i++)
+		{
+			holders[i] = (HolderP *)file.getObject(ids[i]);
+			const char *blob = holders[i]->blob().getBlob();
+			tCheck(memcmp(blob,makeData(cBlobLength,i).data(),cBlobLength) == 0);
+			tCheck(OBlobP::currentTotalMemoryUsage() <= memory + cBudget);
+			holders[i]->oSetPurgeable();
+		}
+	}
+
+	// The blobs used last are still in memory, and the others are read again.
+	unsigned long used = OBlobP::currentTotalMemoryUsage();
+	tCheck(same(holders[cBlobs - 1]->blob(),makeData(cBlobLength,cBlobs - 1)));
+	tCheck(OBlobP::currentTotalMemoryUsage() == used);
+	tCheck(same(holders[0]->blob(),makeData(cBlobLength,0)));
+	OBlobP::setMemoryBudget(0);
+	cout << name << " kept within the memory budget OK\n";
+#endif
+}
+
+int main()
+{
+	try{
+		testRanges<OBlobP,97>("blobp.db",0);
+		testRanges<OBlob,98>("blobt.db",0);
+		testRanges<OBlobP,97>("blobpc.db",OFILE_COMPACT);
+		testGrowInFile();
+		testChunks<OChunkBlobT<OBlobP>,99>("blobchp.db");
+		testChunks<OChunkBlob,100>("blobcht.db");
+		testMappedView();
+		testMemoryBudget();
+	}catch(OFileErr &x){
+		cout << x.why() << endl;
+		return 1;
+	}
+	cout << "Finished\n";
+	return 0;
+}
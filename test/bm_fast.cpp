@@ -0,0 +1,244 @@
+//
+//  Command line micro benchmark comparing the cost per attribute of the
+//  virtual stream methods with OFastWrite/OFastRead(see ofaststrm.h).
+//
+//  Two classes with the same 24 attributes are written to and read from a
+//  file. One streams them with writeXxx/readXxx, the other with oFields.
+//  Both produce the same bytes.
+//
+//  Usage: bm_fast [number of objects]
+//
+
+#include "odefs.h"
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#ifdef __unix__
+#include <sys/resource.h>
+#endif
+
+#include "ofile.h"
+#include "oiter.h"
+#include "ox.h"
+#include "opersist.h"
+#include "ofaststrm.h"
+
+using namespace std;
+
+// Where possible only the processor time spent in the program itself is
+// measured. The system time of the file io is much larger than the cost of
+// the attributes and varies from run to run.
+class Timer{
+public:
+	void start(void){
+		_start = now();
+	}
+	float read(void){
+		return((float)(now() - _start));
+	}
+private:
+	static double now(void){
+#ifdef __unix__
+		struct rusage usage;
+		getrusage(RUSAGE_SELF,&usage);
+		return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec/1.0e6;
+#else
+		return (double)clock()/CLOCKS_PER_SEC;
+#endif
+	}
+	double _start;
+};
+
+const long cFields = 24;
+const int cRuns = 5;
+
+// Measures the cost of everything except the attributes.
+class Empty: public OPersist
+{
+	typedef OPersist inherited;
+public:
+	static const OClassId_t cClassId = 102;
+
+	Empty(long seed){_l[1] = seed + 1;}
+	Empty(OIStream *in):inherited(in){_l[1] = 0;}
+	void oWrite(OOStream *out)const
+	{
+		inherited::oWrite(out);
+	}
+	OMeta *meta(void)const{return &_metaClass;}
+	static OPersist *New(OIStream *in){return new Empty(in);}
+	static OMeta _metaClass;
+
+	O_LONG _l[8];
+};
+
+class Plain: public OPersist
+{
+	typedef OPersist inherited;
+public:
+	static const OClassId_t cClassId = 100;
+
+	Plain(long seed)
+	{
+		for(int i = 0; i < 8; i++)
+		{
+			_l[i] = seed + i;
+			_d[i] = seed * 0.5 + i;
+			_s[i] = (O_SHORT)(seed - i);
+		}
+	}
+	Plain(OIStream *in):inherited(in)
+	{
+		for(int i = 0; i < 8; i++)
+		{
+			_l[i] = in->readLong();
+			_d[i] = in->readDouble();
+			_s[i] = in->readShort();
+		}
+	}
+	void oWrite(OOStream *out)const
+	{
+		inherited::oWrite(out);
+		for(int i = 0; i < 8; i++)
+		{
+			out->writeLong(_l[i]);
+			out->writeDouble(_d[i]);
+			out->writeShort(_s[i]);
+		}
+	}
+	OMeta *meta(void)const{return &_metaClass;}
+	static OPersist *New(OIStream *in){return new Plain(in);}
+	static OMeta _metaClass;
+
+	O_LONG _l[8];
+	double _d[8];
+	O_SHORT _s[8];
+};
+
+class Fast: public OPersist
+{
+	typedef OPersist inherited;
+public:
+	static const OClassId_t cClassId = 101;
+
+	Fast(long seed)
+	{
+		for(int i = 0; i < 8; i++)
+		{
+			_l[i] = seed + i;
+			_d[i] = seed * 0.5 + i;
+			_s[i] = (O_SHORT)(seed - i);
+		}
+	}
+	Fast(OIStream *in):inherited(in)
+	{
+		OFastRead(in,*this);
+	}
+	void oWrite(OOStream *out)const
+	{
+		inherited::oWrite(out);
+		OFastWrite(out,*this);
+	}
+	template<class S> void oFields(S &s)
+	{
+		for(int i = 0; i < 8; i++)
+		{
+			s.Long(_l[i]);
+			s.Double(_d[i]);
+			s.Short(_s[i]);
+		}
+	}
+	OMeta *meta(void)const{return &_metaClass;}
+	static OPersist *New(OIStream *in){return new Fast(in);}
+	static OMeta _metaClass;
+
+	O_LONG _l[8];
+	double _d[8];
+	O_SHORT _s[8];
+};
+
+OMeta Empty::_metaClass(Empty::cClassId,(Func)Empty::New,cOPersist,0);
+OMeta Plain::_metaClass(Plain::cClassId,(Func)Plain::New,cOPersist,0);
+OMeta Fast::_metaClass(Fast::cClassId,(Func)Fast::New,cOPersist,0);
+
+template<class T>
+void runOnce(long nObjects,float *writeTime,float *readTime)
+// Time writing and reading nObjects objects of class T.
+{
+Timer timer;
+
+	OFile *file = new OFile("ofast.tst",OFILE_CREATE);
+	for(long i = 0; i < nObjects; i++)
+		file->attach(new T(i));
+
+	timer.start();
+	file->commit();
+	*writeTime = timer.read();
+	delete file;
+
+	file = new OFile("ofast.tst",OFILE_OPEN_READ_ONLY);
+	long sum = 0;
+	timer.start();
+	OIteratorT<T,T::cClassId> it(file);
+	T *p;
+	while((p = it++) != 0)
+		sum += p->_l[1];
+	*readTime = timer.read();
+	delete file;
+
+	if(T::cClassId != Empty::cClassId && sum != nObjects*(nObjects - 1)/2 + nObjects)
+		cout << "Read back the wrong values!\n";
+}
+
+template<class T>
+void run(long nObjects,float *writeTime,float *readTime)
+// Best of several runs.
+{
+	runOnce<T>(nObjects,writeTime,readTime);
+	for(int i = 1; i < cRuns; i++)
+	{
+		float write,read;
+		runOnce<T>(nObjects,&write,&read);
+		*writeTime = min(*writeTime,write);
+		*readTime = min(*readTime,read);
+	}
+}
+
+void printResult(const char *label,long nObjects,float time,float baseTime)
+{
+	char str1[20];
+	char str2[20];
+	sprintf(str1,"%.3f",time);
+	sprintf(str2,"%.2f",(time - baseTime)*1.0e9/((double)nObjects*cFields));
+
+	cout << label << str1 << "          "<< str2 <<'\n';
+}
+
+int main(int argc,char *argv[])
+{
+	long nObjects = (argc > 1) ? atol(argv[1]) : 200000;
+
+	cout << "ObjectFile field streaming benchmark. " << nObjects << " objects of "
+		 << cFields << " attributes.\n";
+	cout << "Best of " << cRuns << " runs. The cost per attribute excludes the cost of an object\n"
+			"without attributes.\n\n";
+	cout << "                          Total(secs)    Per attribute(ns)\n";
+
+	try{
+		float baseWrite,baseRead,write,read;
+		run<Empty>(nObjects,&baseWrite,&baseRead);
+
+		run<Plain>(nObjects,&write,&read);
+		printResult("Virtual methods write     ",nObjects,write,baseWrite);
+		printResult("Virtual methods read      ",nObjects,read,baseRead);
+
+		run<Fast>(nObjects,&write,&read);
+		printResult("OFastWrite                ",nObjects,write,baseWrite);
+		printResult("OFastRead                 ",nObjects,read,baseRead);
+	}catch(OFileErr &x){
+		cout << x.why() << '\n';
+	}
+	remove("ofast.tst");
+	return 0;
+}
@@ -0,0 +1,495 @@
+//
+// ObjectFile file format test program. Checks the checksums and the swaps
+// of arrays, and writes files with the options of the file format, changes
+// them, reopens them and checks that the objects read back are what was
+// written.
+//
+
+#include "odefs.h"
+#include <iostream>
+#include <stdio.h>
+#include <string.h>
+#include "ofile.h"
+#include "oiter.h"
+#include "ox.h"
+#include "opersist.h"
+#include "oblobp.h"
+#include "ocrc.h"
+#include "tcheck.h"
+
+using namespace std;
+
+const OClassId_t cRecId = 90;
+
+class Rec : public OPersist
+// An object of variable size with a blob. Its data is made from its key,
+// so that it can be checked when read back. Blobs repeat every 5 keys.
+{
+	typedef OPersist inherited;
+public:
+	Rec(long key,int n):_key(key),_n(n)
+	{
+		char buf[4000];
+		fill(buf,sizeof(buf),_key % 5,true);
+		_blob.copyToBlob(buf,1000 + 500*(_key % 5));
+	}
+	Rec(OIStream *in):inherited(in),_blob(in)
+	{
+		_key = in->readLong("key");
+		_n = in->readShort("n");
+		in->readBytes(_data,_n,"data");
+	}
+	void oWrite(OOStream *out)const
+	{
+		inherited::oWrite(out);
+		_blob.oWrite(out);
+		out->writeLong(_key,"key");
+		out->writeShort((O_SHORT)_n,"n");
+		char buf[sizeof(_data)];
+		fill(buf,_n,_key,false);
+		out->writeBytes(buf,_n,"data");
+	}
+	void oAttach(OFile *file,bool deep)
+	{
+		inherited::oAttach(file,deep);
+		_blob.oAttach(file);
+	}
+	void oDetach(OFile *file,bool deep)
+	{
+		inherited::oDetach(file,deep);
+		_blob.oDetach(file);
+	}
+	OMeta *meta(void)const{return &_metaClass;}
+	static OPersist *New(OIStream *s){return new Rec(s);}
+	static OMeta _metaClass;
+
+	void resize(int n){_n = n;oSetDirty();}
+	bool ok(void)const
+	// The object is what was written.
+	{
+		char buf[4000];
+		fill(buf,_n,_key,false);
+		if(memcmp(_data,buf,_n) != 0)
+			return false;
+		fill(buf,sizeof(buf),_key % 5,true);
+		return _blob.size() == (size_t)(1000 + 500*(_key % 5)) &&
+			   memcmp(_blob.const_getBlob(),buf,_blob.size()) == 0;
+	}
+	long key(void)const{return _key;}
+
+private:
+	static void fill(char *buf,int n,long key,bool blob)
+	{
+		// Text that compresses, starting with the key.
+		for(int i = 0; i < n; i++)
+			buf[i] = (char)("abcdefgh"[(i / 16) % 8] + key % 5);
+		if(n >= 16)
+		{
+			char mark[16];
+			sprintf(mark,blob ? "[%08ld]" : "<%08ld>",key);
+			memcpy(buf,mark,10);
+		}
+	}
+
+	long _key;
+	int _n;
+	char _data[1200];
+	OBlobP _blob;
+};
+
+OMeta Rec::_metaClass(cRecId,(Func)Rec::New,cOPersist,0);
+
+const OClassId_t cFixedId = 91;
+
+class Fixed : public OPersist
+// An object with a blob, that gives its size with oSize().
+{
+	typedef OPersist inherited;
+public:
+	Fixed(long key):_key(key)
+	{
+		char buf[3000];
+		memset(buf,'a' + (int)(key % 4),sizeof(buf));
+		_blob.copyToBlob(buf,sizeof(buf));
+	}
+	Fixed(OIStream *in):inherited(in),_blob(in)
+	{
+		_key = in->readLong("key");
+	}
+	void oWrite(OOStream *out)const
+	{
+		inherited::oWrite(out);
+		_blob.oWrite(out);
+		out->writeLong(_key,"key");
+	}
+	// The blob header and the key.
+	long oSize(void)const{return sizeof(OFilePos_t) + 2*sizeof(O_LONG);}
+	void oAttach(OFile *file,bool deep)
+	{
+		inherited::oAttach(file,deep);
+		_blob.oAttach(file);
+	}
+	void oDetach(OFile *file,bool deep)
+	{
+		inherited::oDetach(file,deep);
+		_blob.oDetach(file);
+	}
+	OMeta *meta(void)const{return &_metaClass;}
+	static OPersist *New(OIStream *s){return new Fixed(s);}
+	static OMeta _metaClass;
+
+	bool ok(void)const
+	{
+		if(_blob.size() != 3000)
+			return false;
+		for(size_t i = 0; i < _blob.size(); i++)
+			if(_blob.const_getBlob()[i] != 'a' + (int)(_key % 4))
+				return false;
+		return true;
+	}
+
+private:
+	long _key;
+	OBlobP _blob;
+};
+
+OMeta Fixed::_metaClass(cFixedId,(Func)Fixed::New,cOPersist,0);
+
+const OClassId_t cArraysId = 95;
+
+class Arrays : public OPersist
+// An object with an array of each type. It writes and reads them with the
+// array methods, or a value at a time, as _bulkWrite and _bulkRead say, so
+// that files written one way can be read the other.
+{
+	typedef OPersist inherited;
+public:
+	enum {cValues = 301};
+	Arrays(long key):_key(key)
+	{
+		for(int i = 0; i < cValues; i++)
+		{
+			_s[i] = (O_SHORT)(key*31 - i*257);
+			_l[i] = (O_LONG)(key*100003L - i*65537L);
+			_l64[i] = (O_LONG64)(key - i)*(O_LONG64)0x10000001;
+			_f[i] = (float)(key + i)/7.0f;
+			_d[i] = (double)(key - i)/3.0;
+		}
+	}
+	Arrays(OIStream *in):inherited(in)
+	{
+		_key = in->readLong("key");
+		if(_bulkRead)
+		{
+			in->readShortArray(_s,cValues,"s");
+			in->readLongArray(_l,cValues,"l");
+			in->readLong64Array(_l64,cValues,"l64");
+			in->readFloatArray(_f,cValues,"f");
+			in->readDoubleArray(_d,cValues,"d");
+			return;
+		}
+		int i;
+		for(i = 0; i < cValues; i++)
+			_s[i] = in->readShort("s");
+		for(i = 0; i < cValues; i++)
+			_l[i] = in->readLong("l");
+		for(i = 0; i < cValues; i++)
+			_l64[i] = in->readLong64("l64");
+		for(i = 0; i < cValues; i++)
+			_f[i] = in->readFloat("f");
+		for(i = 0; i < cValues; i++)
+			_d[i] = in->readDouble("d");
+	}
+	void oWrite(OOStream *out)const
+	{
+		inherited::oWrite(out);
+		out->writeLong(_key,"key");
+		if(_bulkWrite)
+		{
+			out->writeShortArray(_s,cValues,"s");
+			out->writeLongArray(_l,cValues,"l");
+			out->writeLong64Array(_l64,cValues,"l64");
+			out->writeFloatArray(_f,cValues,"f");
+			out->writeDoubleArray(_d,cValues,"d");
+			return;
+		}
+		int i;
+		for(i = 0; i < cValues; i++)
+			out->writeShort(_s[i],"s");
+		for(i = 0; i < cValues; i++)
+			out->writeLong(_l[i],"l");
+		for(i = 0; i < cValues; i++)
+			out->writeLong64(_l64[i],"l64");
+		for(i = 0; i < cValues; i++)
+			out->writeFloat(_f[i],"f");
+		for(i = 0; i < cValues; i++)
+			out->writeDouble(_d[i],"d");
+	}
+	OMeta *meta(void)const{return &_metaClass;}
+	static OPersist *New(OIStream *s){return new Arrays(s);}
+	static OMeta _metaClass;
+
+	bool ok(void)const
+	// The arrays are what was written.
+	{
+		Arrays made(_key);
+		return memcmp(_s,made._s,sizeof(_s)) == 0 &&
+			   memcmp(_l,made._l,sizeof(_l)) == 0 &&
+			   memcmp(_l64,made._l64,sizeof(_l64)) == 0 &&
+			   memcmp(_f,made._f,sizeof(_f)) == 0 &&
+			   memcmp(_d,made._d,sizeof(_d)) == 0;
+	}
+
+	static bool _bulkWrite;
+	static bool _bulkRead;
+
+private:
+	long _key;
+	O_SHORT _s[cValues];
+	O_LONG _l[cValues];
+	O_LONG64 _l64[cValues];
+	float _f[cValues];
+	double _d[cValues];
+};
+
+OMeta Arrays::_metaClass(cArraysId,(Func)Arrays::New,cOPersist,0);
+bool Arrays::_bulkWrite = true;
+bool Arrays::_bulkRead = true;
+
+static long checkFile(const char *name,long flags)
+// Read every object of the file and verify the file.
+// Return the number of objects.
+{
+	OFile file(name,OFILE_OPEN_READ_ONLY | flags);
+	OIteratorT<Rec,cRecId> it(&file);
+	Rec *rec;
+	long n = 0;
+	while((rec = it++) != 0)
+	{
+		tCheck(rec->ok());
+		n++;
+	}
+	tCheck(file.verify() == 0);
+	return n;
+}
+
+static void testCrc(void)
+// Check the CRC32C against the known check value.
+{
+	const char *check = "123456789";
+	tCheck(OCRC32C::compute(check,9) == 0xE3069283UL);
+	tCheck(OCRC32C::update(OCRC32C::update(0,check,4),check + 4,5) == 0xE3069283UL);
+	tCheck(OCRC32C::compute(check,0) == 0);
+	cout << "CRC32C " << (OCRC32C::hardware() ? "hardware" : "table") << " OK\n";
+}
+
+static void testBadByte(void)
+// A byte of an object changed in the file is found by verify().
+{
+	const char *name = "fmtbad.db";
+	remove(name);
+	{
+		OFile file(name,OFILE_CREATE | OFILE_CHECKSUM);
+		for(long key = 0; key < 20; key++)
+			file.attach(new Rec(key,100));
+		file.commit();
+	}
+	tCheck(checkFile(name,0) == 20);
+
+	// Find the data of object 7 and change a byte of it.
+	FILE *fp = fopen(name,"r+b");
+	tCheck(fp != 0);
+	static char buf[200000];
+	size_t length = fread(buf,1,sizeof(buf),fp);
+	char *found = 0;
+	for(size_t i = 0; i + 10 <= length && !found; i++)
+		if(memcmp(buf + i,"<00000007>",10) == 0)
+			found = buf + i;
+	tCheck(found != 0);
+	fseek(fp,(long)(found - buf) + 20,SEEK_SET);
+	fputc(found[20] ^ 0x01,fp);
+	fclose(fp);
+
+	OFile file(name,OFILE_OPEN_READ_ONLY);
+	tCheck(file.verify() == 1);
+	cout << "Changed byte found by verify OK\n";
+}
+
+static void roundTrip(const char *name,long flags)
+// Create a file, change the size of objects, delete and add objects, and
+// check it each time it is reopened.
+{
+	const long cObjects = 300;
+	remove(name);
+	{
+		OFile file(name,OFILE_CREATE | OFILE_CHECKSUM | flags);
+		for(long key = 0; key < cObjects; key++)
+			file.attach(new Rec(key,(int)(key*7 % 1000)));
+		file.commit();
+	}
+	tCheck(checkFile(name,flags) == cObjects);
+
+	long n = cObjects;
+	for(int pass = 0; pass < 3; pass++)
+	{
+		OFile file(name,OFILE_OPEN_FOR_WRITING | flags);
+		OIteratorT<Rec,cRecId> it(&file);
+		Rec *rec;
+		long i = 0;
+		while((rec = it++) != 0)
+		{
+			if(i % 4 == pass)
+			{
+				file.detach(rec);
+				delete rec;
+				n--;
+			}
+			else if(i % 3 == 0)
+				rec->resize((int)((rec->key() + 13*i + 100*pass) % 1200));
+			i++;
+		}
+		for(long key = 0; key < 30; key++)
+		{
+			file.attach(new Rec(1000*(pass + 1) + key,(int)(key*37 % 1200)));
+			n++;
+		}
+		file.commit();
+		tCheck(file.verify() == 0);
+	}
+	tCheck(checkFile(name,flags) == n);
+	cout << name << " " << n << " objects OK\n";
+}
+
+static void testSwapArrays(void)
+// The swaps of arrays, which use vector instructions where there are any,
+// give what swapping each value does, for lengths that leave a tail, from
+// addresses that are not aligned, and in place.
+{
+	static const int cSizes[3] = {2,4,8};
+	char src[8*70 + 1],dst[8*70 + 1],expect[8*70];
+	for(int s = 0; s < 3; s++)
+	{
+		int size = cSizes[s];
+		for(size_t n = 0; n <= 70; n++)
+		{
+			for(size_t i = 0; i < sizeof(src); i++)
+				src[i] = (char)(i*7 + n*size);
+			for(int offset = 0; offset < 2; offset++)
+			{
+				memcpy(expect,src + offset,n*size);
+				for(size_t i = 0; i < n; i++)
+				{
+					if(size == 2)
+						OUtilityFunction::swap16(expect + i*size);
+					else if(size == 4)
+						OUtilityFunction::swap32(expect + i*size);
+					else
+						OUtilityFunction::swap64(expect + i*size);
+				}
+
+				// From one buffer to another, then in place.
+				char *from = src + offset;
+				char *to = dst + 1 - offset;
+				memcpy(dst,src,sizeof(dst));
+				if(size == 2)
+					OUtilityFunction::swapArray16(to,from,n);
+				else if(size == 4)
+					OUtilityFunction::swapArray32(to,from,n);
+				else
+					OUtilityFunction::swapArray64(to,from,n);
+				tCheck(memcmp(to,expect,n*size) == 0);
+
+				memcpy(dst,src,sizeof(dst));
+				to = dst + offset;
+				if(size == 2)
+					OUtilityFunction::swapArray16(to,to,n);
+				else if(size == 4)
+					OUtilityFunction::swapArray32(to,to,n);
+				else
+					OUtilityFunction::swapArray64(to,to,n);
+				tCheck(memcmp(to,expect,n*size) == 0);
+			}
+		}
+	}
+	cout << "Array swaps OK\n";
+}
+
+static void testArrays(const char *name,long flags)
+// Arrays written with the array methods are read back by reading a value
+// at a time, and the other way round.
+{
+	for(int way = 0; way < 4; way++)
+	{
+		Arrays::_bulkWrite = (way & 1) != 0;
+		Arrays::_bulkRead = (way & 2) != 0;
+		remove(name);
+		{
+			OFile file(name,OFILE_CREATE | OFILE_CHECKSUM | flags);
+			for(long key = 0; key < 20; key++)
+				file.attach(new Arrays(key));
+			file.commit();
+		}
+		OFile file(name,OFILE_OPEN_READ_ONLY);
+		OIteratorT<Arrays,cArraysId> it(&file);
+		Arrays *arrays;
+		long n = 0;
+		while((arrays = it++) != 0)
+		{
+			tCheck(arrays->ok());
+			n++;
+		}
+		tCheck(n == 20);
+		tCheck(file.verify() == 0);
+	}
+	Arrays::_bulkWrite = Arrays::_bulkRead = true;
+	cout << name << " arrays OK\n";
+}
+
+static void testFixedSize(const char *name,long flags)
+// The blobs of objects whose size is given by oSize() are placed before
+// the index is written.
+{
+	remove(name);
+	{
+		OFile file(name,OFILE_CREATE | flags);
+		for(long key = 0; key < 20; key++)
+			file.attach(new Fixed(key));
+		file.commit();
+	}
+	OFile file(name,OFILE_OPEN_READ_ONLY);
+	OIteratorT<Fixed,cFixedId> it(&file);
+	Fixed *fixed;
+	long n = 0;
+	while((fixed = it++) != 0)
+	{
+		tCheck(fixed->ok());
+		n++;
+	}
+	tCheck(n == 20);
+	tCheck(file.verify() == 0);
+	cout << name << " objects of fixed size OK\n";
+}
+
+int main()
+{
+	try{
+		testCrc();
+		testBadByte();
+		testSwapArrays();
+		testArrays("fmtarrays.db",0);
+		testArrays("fmtarraysc.db",OFILE_COMPACT);
+		roundTrip("fmtplain.db",0);
+		roundTrip("fmtsize.db",OFILE_SIZE_CLASSES);
+		roundTrip("fmtcompact.db",OFILE_COMPACT);
+		roundTrip("fmtcompress.db",OFILE_COMPRESS);
+		roundTrip("fmtdedup.db",OFILE_DEDUP);
+		roundTrip("fmtall.db",OFILE_SIZE_CLASSES | OFILE_COMPACT | OFILE_COMPRESS | OFILE_DEDUP);
+		testFixedSize("fmtfixed.db",OFILE_DEDUP);
+		testFixedSize("fmtfixedc.db",OFILE_DEDUP | OFILE_CHECKSUM);
+	}catch(OFileErr &x){
+		cout << x.why() << endl;
+		return 1;
+	}
+	cout << "Finished\n";
+	return 0;
+}
@@ -0,0 +1,122 @@
+//
+// ObjectFile parallelForEach test program. Visits the objects of a file and
+// checks that they are all visited, and that those not kept can be purged
+// afterwards, including one that was referenced while it was visited.
+//
+
+#include "odefs.h"
+#include <iostream>
+#include <stdio.h>
+#include "ofile.h"
+#include "ox.h"
+#include "opersist.h"
+#include "tcheck.h"
+
+using namespace std;
+
+const OClassId_t cItemId = 94;
+
+class Item : public OPersist
+// An object with a value.
+{
+	typedef OPersist inherited;
+public:
+	Item(long value):_value(value){}
+	Item(OIStream *in):inherited(in)
+	{
+		_value = in->readLong("value");
+	}
+	void oWrite(OOStream *out)const
+	{
+		inherited::oWrite(out);
+		out->writeLong(_value,"value");
+	}
+	OMeta *meta(void)const{return &_metaClass;}
+	static OPersist *New(OIStream *s){return new Item(s);}
+	static OMeta _metaClass;
+
+	long value(void)const{return _value;}
+
+private:
+	long _value;
+};
+
+OMeta Item::_metaClass(cItemId,(Func)Item::New,cOPersist,0);
+
+const long cItems = 2000;
+const long cKeptValue = 500;
+
+struct Visit{
+	OFMutex _mutex;
+	long _sum;
+	Item *_kept;
+};
+
+static bool visit(OPersist *ob,void *arg)
+// Add the value of the item, and keep the one with cKeptValue.
+{
+	Visit *v = (Visit *)arg;
+	Item *item = (Item *)ob;
+	OFGuard guard(v->_mutex);
+	v->_sum += item->value();
+	if(item->value() != cKeptValue)
+		return false;
+	v->_kept = item;
+	return true;
+}
+
+static void testPurgeable(void)
+// An object referenced during parallelForEach stays in memory until that
+// reference is removed, and the others visited can be purged.
+{
+	const char *name = "foreach.db";
+	remove(name);
+	OId pinnedId = 0;
+	{
+		OFile file(name,OFILE_CREATE);
+		for(long value = 0; value < cItems; value++)
+		{
+			Item *item = new Item(value);
+			file.attach(item);
+			if(value == 77)
+				pinnedId = item->oId();
+		}
+		file.commit();
+	}
+
+	OFile file(name,OFILE_OPEN_FOR_WRITING);
+	Item *pinned = (Item *)file.getObject(pinnedId);
+	tCheck(pinned != 0 && pinned->value() == 77);
+
+	Visit v;
+	v._sum = 0;
+	v._kept = 0;
+	tCheck(file.parallelForEach(cItemId,false,visit,&v,4) == cItems);
+	tCheck(v._sum == cItems*(cItems - 1)/2);
+	tCheck(v._kept != 0 && v._kept->value() == cKeptValue);
+
+	// Only the pinned and the kept objects stay.
+	file.purge();
+	tCheck(OFile::getObjectCacheCount() == 2);
+
+	pinned->oSetPurgeable();
+	file.purge();
+	tCheck(OFile::getObjectCacheCount() == 1);
+
+	v._kept->oSetPurgeable();
+	file.purge();
+	tCheck(OFile::getObjectCacheCount() == 0);
+	cout << "Objects visited by parallelForEach purged OK\n";
+}
+
+int main()
+{
+	try{
+		testPurgeable();
+	}catch(OFileErr &x){
+		cout << x.why() << endl;
+		return 1;
+	}
+	cout << "Finished\n";
+	return 0;
+}
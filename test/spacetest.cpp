@@ -0,0 +1,494 @@
+//
+// ObjectFile space test program. Deletes objects in a known pattern and
+// checks what spaceStats() says about the space of the file, checks that
+// defragmenting shortens the file, that the space kept for growth is given
+// back and that files with holes punched in them are whole, and checks the
+// counters of stats() and globalStats().
+//
+
+#include "odefs.h"
+#include <iostream>
+#include <stdio.h>
+#include <string.h>
+#include "ofile.h"
+#include "oiter.h"
+#include "ox.h"
+#include "opersist.h"
+#include "tcheck.h"
+
+using namespace std;
+
+const OClassId_t cItemId = 96;
+
+class Item : public OPersist
+// An object whose data is made from its key, all of the same length.
+{
+	typedef OPersist inherited;
+public:
+	enum {cDataLength = 200};
+	Item(long key):_key(key),_ok(true){}
+	Item(OIStream *in):inherited(in)
+	{
+		_key = in->readLong("key");
+		char data[cDataLength];
+		in->readBytes(data,cDataLength,"data");
+		char made[cDataLength];
+		fill(made);
+		_ok = memcmp(data,made,cDataLength) == 0;
+	}
+	void oWrite(OOStream *out)const
+	{
+		inherited::oWrite(out);
+		out->writeLong(_key,"key");
+		char data[cDataLength];
+		fill(data);
+		out->writeBytes(data,cDataLength,"data");
+	}
+	OMeta *meta(void)const{return &_metaClass;}
+	static OPersist *New(OIStream *s){return new Item(s);}
+	static OMeta _metaClass;
+
+	// The data read is what was written.
+	bool ok(void)const{return _ok;}
+
+private:
+	void fill(char *data)const
+	{
+		for(int i = 0; i < cDataLength; i++)
+			data[i] = (char)(_key + i);
+	}
+
+	long _key;
+	bool _ok;
+};
+
+OMeta Item::_metaClass(cItemId,(Func)Item::New,cOPersist,0);
+
+const long cItems = 1000;
+
+static void create(const char *name,long flags)
+// Create a file of cItems items.
+{
+	remove(name);
+	OFile file(name,OFILE_CREATE | flags);
+	for(long key = 0; key < cItems; key++)
+		file.attach(new Item(key));
+	file.commit();
+}
+
+static long deleteOdd(OFile &file)
+// Delete every other item. Return the number left.
+{
+	OIteratorT<Item,cItemId> it(&file);
+	Item *item;
+	long i = 0;
+	long n = 0;
+	while((item = it++) != 0)
+	{
+		if(i++ % 2)
+		{
+			file.detach(item);
+			delete item;
+		}
+		else
+			n++;
+	}
+	return n;
+}
+
+static long readAll(OFile &file)
+// Check every item of the file, leaving them purgeable. Return the number
+// of them.
+{
+	OIteratorT<Item,cItemId> it(&file);
+	Item *item;
+	long n = 0;
+	while((item = it++) != 0)
+	{
+		tCheck(item->ok());
+		item->oSetPurgeable();
+		n++;
+	}
+	return n;
+}
+
+static long diskLength(const char *name)
+// Return the length of the file on disk.
+{
+	FILE *fp = fopen(name,"rb");
+	tCheck(fp != 0);
+	fseek(fp,0,SEEK_END);
+	long length = ftell(fp);
+	fclose(fp);
+	return length;
+}
+
+static int holeBucket(OFilePos_t length)
+// The bucket of the hole histogram for holes of length.
+{
+	int bucket = 0;
+	while(length >>= 1)
+		bucket++;
+	return bucket;
+}
+
+static void checkTotals(const OSpaceStats &stats)
+// The parts of the file add up to its length, and the objects of the
+// classes to the objects.
+{
+	tCheck(stats.indexBytes + stats.liveBytes + stats.freeBytes + stats.reservedBytes +
+		   stats.pageSlack + stats.otherBytes == stats.fileLength);
+	tCheck(stats.otherBytes < stats.fileLength);
+	tCheck(stats.classObjects[cItemId] == stats.objects);
+	tCheck(stats.classBytes[cItemId] == stats.liveBytes);
+	oulong holes = 0;
+	for(int i = 0; i < OSpaceStats::cHoleBuckets; i++)
+		holes += stats.holeHistogram[i];
+	tCheck(holes == stats.holes);
+	tCheck(stats.largestHole <= stats.freeBytes);
+}
+
+static void testSpaceStats(void)
+// Every other object deleted leaves a hole of the length of an object
+// after each one left.
+{
+	const char *name = "space.db";
+	create(name,0);
+	OFile file(name,OFILE_OPEN_FOR_WRITING);
+	OSpaceStats before = file.spaceStats();
+	checkTotals(before);
+	tCheck(before.objects == (oulong)cItems);
+	tCheck(before.liveBytes % cItems == 0);
+	tCheck(before.holes == 0 && before.freeBytes == 0 && before.pages == 0);
+	OFilePos_t length = before.liveBytes/cItems;
+	tCheck(length > Item::cDataLength);
+
+	long n = deleteOdd(file);
+	tCheck(n == cItems/2);
+	OSpaceStats stats = file.spaceStats();
+	checkTotals(stats);
+	tCheck(stats.fileLength == before.fileLength);
+	tCheck(stats.objects == (oulong)n);
+	tCheck(stats.liveBytes == n*length);
+	tCheck(stats.holes == (oulong)(cItems - n));
+	tCheck(stats.freeBytes == (cItems - n)*length);
+	tCheck(stats.largestHole == length);
+	tCheck(stats.holeHistogram[holeBucket(length)] == stats.holes);
+	tCheck(stats.fragmentation() > 0.99);
+	tCheck(stats.averageObjectSize() == (double)length);
+	tCheck(stats.otherBytes == before.otherBytes);
+
+	// The commit writes a shorter index, and the file is cut after the last
+	// object. The other holes stay.
+	file.commit();
+	stats = file.spaceStats();
+	checkTotals(stats);
+	tCheck(stats.objects == (oulong)n);
+	tCheck(stats.indexBytes < before.indexBytes);
+	tCheck(stats.holes >= (oulong)(cItems - n - 1));
+	tCheck(stats.freeBytes == (OFilePos_t)stats.holes*length);
+	tCheck(stats.otherBytes == before.otherBytes);
+	tCheck(file.verify() == 0);
+	file.purge();
+	tCheck(readAll(file) == n);
+	cout << "Space of " << name << " OK\n";
+}
+
+static void testSpaceStatsSizeClasses(void)
+// With size classes the space of objects deleted stays in their pages.
+{
+	const char *name = "spacesc.db";
+	create(name,OFILE_SIZE_CLASSES);
+	OFile file(name,OFILE_OPEN_FOR_WRITING);
+	OSpaceStats before = file.spaceStats();
+	checkTotals(before);
+	tCheck(before.objects == (oulong)cItems);
+	tCheck(before.pages > 0);
+	OFilePos_t length = before.liveBytes/cItems;
+
+	long n = deleteOdd(file);
+	file.commit();
+	OSpaceStats stats = file.spaceStats();
+	checkTotals(stats);
+	tCheck(stats.objects == (oulong)n);
+	tCheck(stats.liveBytes == n*length);
+	tCheck(stats.pages == before.pages);
+	tCheck(stats.pageSlack == before.pageSlack + (cItems - n)*length);
+	tCheck(stats.freeBytes == 0 && stats.holes == 0);
+	tCheck(file.verify() == 0);
+	file.purge();
+	tCheck(readAll(file) == n);
+	cout << "Space of " << name << " OK\n";
+}
+
+static void testDefragment(void)
+// Defragmenting a step at a time and committing shortens the file each
+// time, until the holes are gone, and the objects are still there.
+{
+	const char *name = "defrag.db";
+	create(name,OFILE_CHECKSUM);
+	OFile file(name,OFILE_OPEN_FOR_WRITING);
+	long n = deleteOdd(file);
+	file.commit();
+	OSpaceStats stats = file.spaceStats();
+	tCheck(stats.holes > 0);
+	OFilePos_t length = stats.fileLength;
+	OFilePos_t objectLength = stats.liveBytes/stats.objects;
+
+	int steps = 0;
+	while(file.defragment(20*objectLength) != 0)
+	{
+		file.commit();
+		stats = file.spaceStats();
+		checkTotals(stats);
+		tCheck(stats.fileLength < length);
+		length = stats.fileLength;
+		tCheck(file.verify() == 0);
+		file.purge();
+		tCheck(readAll(file) == n);
+		steps++;
+	}
+	tCheck(steps > 1);
+
+	// What is left is less than the length of an object.
+	stats = file.spaceStats();
+	tCheck(stats.freeBytes < objectLength);
+	tCheck(stats.objects == (oulong)n);
+	cout << "Defragmented " << name << " in " << steps << " steps OK\n";
+}
+
+static void testDefragmentNoCommit(void)
+// Objects are only moved into space that was free at the last commit, not
+// into that of objects deleted since, so a file defragmented and closed
+// without a commit is as it was.
+{
+	const char *name = "defragnc.db";
+	create(name,OFILE_CHECKSUM);
+	long n;
+	{
+		OFile file(name,OFILE_OPEN_FOR_WRITING);
+		n = deleteOdd(file);
+		file.commit();
+	}
+	long length = diskLength(name);
+	{
+		OFile file(name,OFILE_OPEN_FOR_WRITING);
+		OIteratorT<Item,cItemId> it(&file);
+		Item *item;
+		for(int i = 0; i < 50 && (item = it++) != 0; i++)
+		{
+			file.detach(item);
+			delete item;
+		}
+		tCheck(file.defragment() > 0);
+	}
+	tCheck(diskLength(name) == length);
+	OFile file(name,OFILE_OPEN_READ_ONLY);
+	tCheck(file.verify() == 0);
+	tCheck(readAll(file) == n);
+	cout << "Defragmented " << name << " without a commit OK\n";
+}
+
+static void testGrowth(void)
+// The space the file grows by is kept as free space at its end until a
+// commit with no growth gives it back.
+{
+	const char *name = "growth.db";
+	const oulong cGrowth = 1048576L;
+	remove(name);
+	{
+		OFile file(name,OFILE_CREATE);
+		file.setGrowth(cGrowth);
+		for(long key = 0; key < cItems; key++)
+			file.attach(new Item(key));
+		file.commit();
+		OSpaceStats stats = file.spaceStats();
+		checkTotals(stats);
+		tCheck(stats.fileLength >= (OFilePos_t)cGrowth);
+		tCheck(stats.reservedBytes > 0 && stats.freeBytes == 0);
+		tCheck(diskLength(name) == (long)stats.fileLength);
+	}
+
+	// The reserve is still there when the file is opened again, and is
+	// used by the objects added.
+	{
+		OFile file(name,OFILE_OPEN_FOR_WRITING);
+		file.setGrowth(cGrowth);
+		OSpaceStats before = file.spaceStats();
+		tCheck(before.reservedBytes > 0);
+		for(long key = cItems; key < 2*cItems; key++)
+			file.attach(new Item(key));
+		file.commit();
+		OSpaceStats stats = file.spaceStats();
+		checkTotals(stats);
+		tCheck(stats.fileLength == before.fileLength);
+		tCheck(stats.reservedBytes < before.reservedBytes);
+
+		// With no growth the commit cuts the file after the last data.
+		file.setGrowth(0);
+		file.commit();
+		stats = file.spaceStats();
+		checkTotals(stats);
+		tCheck(stats.reservedBytes == 0);
+		tCheck(stats.fileLength < before.fileLength);
+		tCheck(diskLength(name) == (long)stats.fileLength);
+	}
+	OFile file(name,OFILE_OPEN_READ_ONLY);
+	tCheck(file.verify() == 0);
+	tCheck(readAll(file) == 2*cItems);
+	cout << "Growth of " << name << " OK\n";
+}
+
+static void testHolePunching(void)
+// The disk space of a large free space is released by commit, and the
+// file is still whole, also when the space is used again.
+{
+	const char *name = "punch.db";
+	const oulong cHoleMin = 4096;
+	create(name,OFILE_CHECKSUM);
+	{
+		OFile file(name,OFILE_OPEN_FOR_WRITING);
+		file.setHolePunching(cHoleMin);
+		OIteratorT<Item,cItemId> it(&file);
+		Item *item;
+		long i = 0;
+		while((item = it++) != 0)
+		{
+			if(i >= 100 && i < 600)
+			{
+				file.detach(item);
+				delete item;
+			}
+			else
+				item->oSetPurgeable();
+			i++;
+		}
+		file.commit();
+		OSpaceStats stats = file.spaceStats();
+		checkTotals(stats);
+		// The new index may be put in the space of the objects deleted.
+		tCheck(stats.holes == 1);
+		tCheck(stats.largestHole + stats.indexBytes >= 500*(stats.liveBytes/stats.objects));
+		tCheck(file.verify() == 0);
+	}
+	{
+		OFile file(name,OFILE_OPEN_READ_ONLY);
+		tCheck(file.verify() == 0);
+		tCheck(readAll(file) == cItems - 500);
+	}
+
+	// Objects added are put in the punched space.
+	{
+		OFile file(name,OFILE_OPEN_FOR_WRITING);
+		file.setHolePunching(cHoleMin);
+		OFilePos_t length = file.spaceStats().fileLength;
+		for(long key = 0; key < 250; key++)
+			file.attach(new Item(key));
+		file.commit();
+		tCheck(file.spaceStats().fileLength <= length);
+	}
+	OFile file(name,OFILE_OPEN_READ_ONLY);
+	tCheck(file.verify() == 0);
+	tCheck(readAll(file) == cItems - 250);
+	cout << "Holes punched in " << name << " OK\n";
+}
+
+static long sHookCalls = 0;
+static OFile *sHookFile = 0;
+
+static void statsHook(OFile *file,void *arg)
+// Count the calls at the end of commits.
+{
+	*(long *)arg += 1;
+	sHookFile = file;
+}
+
+static bool allZero(const OFileStats &stats)
+{
+	for(int i = 0; i < OFileStats::cCounters; i++)
+		if(stats.counter(i) != 0)
+			return false;
+	return true;
+}
+
+static void testStats(void)
+// The counters of a file count what it does, are kept in the global
+// counters when the file is closed or they are reset, and are cleared
+// by a reset.
+{
+	const char *name = "stats.db";
+	remove(name);
+	OFile::globalStats(true);
+	OFile::setStatsHook(statsHook,&sHookCalls);
+	OFileStats created;
+	{
+		OFile file(name,OFILE_CREATE);
+		for(long key = 0; key < cItems; key++)
+			file.attach(new Item(key));
+		file.commit();
+		tCheck(sHookCalls == 1 && sHookFile == &file);
+		created = file.stats();
+		tCheck(created.commits == 1);
+		tCheck(created.writes > 0);
+		tCheck(created.bytesWritten >= (OSYS_ULONG64)file.spaceStats().liveBytes);
+		tCheck(created.objectsRead == 0 && created.cacheMisses == 0);
+	}
+	OFile::setStatsHook(0);
+	OFileStats global = OFile::globalStats();
+	tCheck(global.commits == 1);
+	tCheck(global.bytesWritten == created.bytesWritten);
+
+	OFile file(name,OFILE_OPEN_READ_ONLY);
+	tCheck(readAll(file) == cItems);
+	OFileStats stats = file.stats();
+	tCheck(stats.objectsRead == (OSYS_ULONG64)cItems);
+	tCheck(stats.cacheMisses == (OSYS_ULONG64)cItems);
+	tCheck(stats.cacheHits == 0);
+	tCheck(stats.reads > 0 && stats.bytesRead > 0);
+	tCheck(stats.commits == 0 && stats.bytesWritten == 0);
+
+	// Objects still in memory are hits.
+	tCheck(readAll(file) == cItems);
+	stats = file.stats();
+	tCheck(stats.cacheHits == (OSYS_ULONG64)cItems);
+	tCheck(stats.objectsRead == (OSYS_ULONG64)cItems);
+
+	// A reset returns the counts and clears them. They stay in the global
+	// counts.
+	OFileStats snapshot = file.stats(true);
+	tCheck(memcmp(&snapshot,&stats,sizeof(stats)) == 0);
+	tCheck(allZero(file.stats()));
+	global = OFile::globalStats();
+	tCheck(global.objectsRead == (OSYS_ULONG64)cItems);
+	tCheck(global.commits == 1);
+
+	file.purge();
+	stats = file.stats();
+	tCheck(stats.purges == 1);
+	tCheck(stats.objectsPurged == (OSYS_ULONG64)cItems);
+
+	// A global reset does not change the counts of the file.
+	global = OFile::globalStats(true);
+	tCheck(global.purges == 1 && global.objectsRead == (OSYS_ULONG64)cItems);
+	tCheck(allZero(OFile::globalStats()));
+	tCheck(file.stats().purges == 1);
+	cout << "Counters of " << name << " OK\n";
+}
+
+int main()
+{
+	try{
+		testSpaceStats();
+		testSpaceStatsSizeClasses();
+		testDefragment();
+		testDefragmentNoCommit();
+		testGrowth();
+		testHolePunching();
+		testStats();
+	}catch(OFileErr &x){
+		cout << x.why() << endl;
+		return 1;
+	}
+	cout << "Finished\n";
+	return 0;
+}
@@ -0,0 +1,19 @@
+#ifndef TCHECK_H
+#define TCHECK_H
+// Checks for the test programs. Unlike oFAssert, they are made in builds
+// with NDEBUG as well. A check that fails throws an OFileErr that names the
+// expression, so that main reports it and returns non-zero.
+
+#include <stdio.h>
+#include "ox.h"
+
+inline void tCheckFailed(const char *expr,const char *file,int line)
+{
+	char msg[400];
+	sprintf(msg,"%.150s(%d): check failed: %.200s",file,line,expr);
+	throw OFileErr(msg);
+}
+
+#define tCheck(x) {if(!(x)) tCheckFailed(#x,__FILE__,__LINE__);}
+
+#endif
@@ -0,0 +1,585 @@
+//
+// ObjectFile interchange format test program. Exports the objects of a file
+// in the binary, JSON and XML formats, imports them into a new file, both as
+// a whole and by streaming, and checks that the objects read back are what
+// was written.
+//
+
+#include "odefs.h"
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <limits>
+#include <limits.h>
+#include <locale.h>
+#include <stdio.h>
+#include <string.h>
+#include "ofile.h"
+#include "oiter.h"
+#include "ox.h"
+#include "opersist.h"
+#include "oblobp.h"
+#include "oisbin.h"
+#include "oosbin.h"
+#include "oisjson.h"
+#include "oosjson.h"
+#include "oisxml.h"
+#include "oosxml.h"
+#include "tcheck.h"
+
+using namespace std;
+
+const long cObjects = 3000;
+const long cRootKey = 42;
+
+const OClassId_t cRecId = 92;
+
+class Rec : public OPersist
+// An object with every kind of attribute. Its data is made from its key,
+// so that it can be checked when read back.
+{
+	typedef OPersist inherited;
+public:
+	Rec(long key):_key(key),_next(0),_prev(0)
+	{
+		_l64 = (O_LONG64)key * 1000000007L - 5;
+		if(key % 7 == 3)
+			_d = numeric_limits<double>::quiet_NaN();
+		else if(key % 7 == 4)
+			_d = numeric_limits<double>::infinity();
+		else if(key % 7 == 5)
+			_d = -numeric_limits<double>::infinity();
+		else
+			_d = key / 3.0;
+		_f = key % 7 >= 3 && key % 7 <= 5 ? (float)_d : key * 0.25f;
+		_s = (O_SHORT)-key;
+		_c = (char)('a' + key % 26);
+		_b = (key & 1) != 0;
+		if(key % 4 == 0)
+			_str[0] = 0;
+		else
+			sprintf(_str,"name <%ld> & \"q\" \\ \t\n\x01 \xc3\xa9 \xff\xe9",key);
+		sprintf(_str256,"key %ld",key);
+		_wc = (O_WCHAR_T)(0x41 + (key % 3)*0x1000);
+		_wstr[0] = 'A';
+		_wstr[1] = 0xE9;
+		_wstr[2] = 0x20AC;
+		_wstr[3] = 0x4E2D;
+		_wstr[4] = (O_WCHAR_T)('0' + key % 10);
+		_wstr[5] = 0;
+		_wstr256[0] = (O_WCHAR_T)('0' + key % 10);
+		_wstr256[1] = 0;
+		for(int i = 0; i < 7; i++)
+			_bytes[i] = (char)(key*i);
+		for(int i = 0; i < 3; i++)
+			_bits[i] = (char)(key >> (i*3));
+		for(int i = 0; i < 5; i++)
+		{
+			_sa[i] = (O_SHORT)(i == 4 ? SHRT_MIN : key - i*1000);
+			_la[i] = (O_LONG)(key - i*100000);
+		}
+		for(int i = 0; i < 4; i++)
+		{
+			_l64a[i] = ((O_LONG64)key << (i*12)) * (i & 1 ? -1 : 1);
+			_fa[i] = (float)(key*i) / 7;
+			_da[i] = key * 1.5e300 / (i + 1);
+		}
+	}
+	Rec(OIStream *in):inherited(in)
+	{
+		_key = in->readLong("key");
+		_l64 = in->readLong64("l64");
+		_f = in->readFloat("f");
+		_d = in->readDouble("d");
+		_s = in->readShort("s");
+		_c = in->readChar("c");
+		_b = in->readBool("b");
+		in->readCString(_str,sizeof(_str),"str");
+		strcpy(_str256,in->readCString256("str256"));
+		_wc = in->readWChar("wc");
+		in->readWCString(_wstr,6,"wstr");
+		O_WCHAR_T *wstr = in->readWCString256("wstr256");
+		_wstr256[0] = wstr[0];
+		_wstr256[1] = wstr[0] ? wstr[1] : 0;
+		in->readBytes(_bytes,sizeof(_bytes),"bytes");
+		in->readBits(_bits,sizeof(_bits),"bits");
+		in->readShortArray(_sa,5,"sa");
+		in->readLongArray(_la,5,"la");
+		in->readLong64Array(_l64a,4,"l64a");
+		in->readFloatArray(_fa,4,"fa");
+		in->readDoubleArray(_da,4,"da");
+		in->readObject((OPersist **)&_next,"next");
+		_prev = (Rec *)in->readObject("prev");
+	}
+	void oWrite(OOStream *out)const
+	{
+		inherited::oWrite(out);
+		out->writeLong(_key,"key");
+		out->writeLong64(_l64,"l64");
+		out->writeFloat(swapped(_f),"f");
+		out->writeDouble(swapped(_d),"d");
+		out->writeShort(_s,"s");
+		out->writeChar(_c,"c");
+		out->writeBool(_b,"b");
+		out->writeCString(_str,"str");
+		out->writeCString256(_str256,"str256");
+		out->writeWChar(_wc,"wc");
+		out->writeWCString(_wstr,"wstr");
+		out->writeWCString256(_wstr256,"wstr256");
+		out->writeBytes(_bytes,sizeof(_bytes),"bytes");
+		out->writeBits(_bits,sizeof(_bits),"bits");
+		out->writeShortArray(_sa,5,"sa");
+		out->writeLongArray(_la,5,"la");
+		out->writeLong64Array(_l64a,4,"l64a");
+		float fa[4];
+		double da[4];
+		for(int i = 0; i < 4; i++)
+		{
+			fa[i] = swapped(_fa[i]);
+			da[i] = swapped(_da[i]);
+		}
+		out->writeFloatArray(fa,4,"fa");
+		out->writeDoubleArray(da,4,"da");
+		out->writeObject(_next,"next");
+		out->writeObject(_prev,"prev");
+	}
+	OMeta *meta(void)const{return &_metaClass;}
+	static OPersist *New(OIStream *s){return new Rec(s);}
+	static OMeta _metaClass;
+
+	// Keys of the objects referred to, or -1. Most references are to objects
+	// written later.
+	static long nextKey(long key){return key % 5 == 1 ? (key + 17) % cObjects : -1;}
+	static long prevKey(long key){return key % 3 == 2 ? (key + cObjects - 1) % cObjects : -1;}
+	void link(Rec **recs)
+	{
+		_next = nextKey(_key) < 0 ? 0 : recs[nextKey(_key)];
+		_prev = prevKey(_key) < 0 ? 0 : recs[prevKey(_key)];
+	}
+	bool ok(void)const
+	// The object is what was written.
+	{
+		Rec rec(_key);
+		if(_l64 != rec._l64 || !same(_f,rec._f) || !same(_d,rec._d) || _s != rec._s ||
+		   _c != rec._c || _b != rec._b || strcmp(_str,rec._str) != 0 ||
+		   strcmp(_str256,rec._str256) != 0 || _wc != rec._wc ||
+		   memcmp(_wstr,rec._wstr,sizeof(_wstr)) != 0 ||
+		   memcmp(_wstr256,rec._wstr256,sizeof(_wstr256)) != 0 ||
+		   memcmp(_bytes,rec._bytes,sizeof(_bytes)) != 0 ||
+		   memcmp(_bits,rec._bits,sizeof(_bits)) != 0 ||
+		   memcmp(_sa,rec._sa,sizeof(_sa)) != 0 || memcmp(_la,rec._la,sizeof(_la)) != 0 ||
+		   memcmp(_l64a,rec._l64a,sizeof(_l64a)) != 0)
+			return false;
+		for(int i = 0; i < 4; i++)
+			if(!same(_fa[i],rec._fa[i]) || !same(_da[i],rec._da[i]))
+				return false;
+		return (_next ? _next->_key : -1) == nextKey(_key) &&
+			   (_prev ? _prev->_key : -1) == prevKey(_key);
+	}
+	long key(void)const{return _key;}
+
+	// Write reals with their bytes reversed, to make a document of the
+	// other byte order.
+	static bool _swapReals;
+
+private:
+	static bool same(double a,double b){return a == b || (a != a && b != b);}
+	static float swapped(float data)
+	{
+		if(_swapReals)
+			OUtilityFunction::swap32((char *)&data);
+		return data;
+	}
+	static double swapped(double data)
+	{
+		if(_swapReals)
+			OUtilityFunction::swap64((char *)&data);
+		return data;
+	}
+
+	long _key;
+	O_LONG64 _l64;
+	float _f;
+	double _d;
+	O_SHORT _s;
+	char _c;
+	bool _b;
+	char _str[64];
+	char _str256[32];
+	O_WCHAR_T _wc;
+	O_WCHAR_T _wstr[6];
+	O_WCHAR_T _wstr256[2];
+	char _bytes[7];
+	char _bits[3];
+	O_SHORT _sa[5];
+	O_LONG _la[5];
+	O_LONG64 _l64a[4];
+	float _fa[4];
+	double _da[4];
+	Rec *_next;
+	Rec *_prev;
+};
+
+OMeta Rec::_metaClass(cRecId,(Func)Rec::New,cOPersist,0);
+bool Rec::_swapReals = false;
+
+const OClassId_t cBlbId = 93;
+
+class Blb : public OPersist
+// An object with a blob, whose size and data are made from its key.
+{
+	typedef OPersist inherited;
+public:
+	Blb(long key):_key(key)
+	{
+		char buf[4000];
+		fill(buf,key);
+		_blob.copyToBlob(buf,size(key));
+	}
+	Blb(OIStream *in):inherited(in),_blob(in)
+	{
+		_key = in->readLong("key");
+	}
+	void oWrite(OOStream *out)const
+	{
+		inherited::oWrite(out);
+		_blob.oWrite(out);
+		out->writeLong(_key,"key");
+	}
+	void oAttach(OFile *file,bool deep)
+	{
+		inherited::oAttach(file,deep);
+		_blob.oAttach(file);
+	}
+	void oDetach(OFile *file,bool deep)
+	{
+		inherited::oDetach(file,deep);
+		_blob.oDetach(file);
+	}
+	OMeta *meta(void)const{return &_metaClass;}
+	static OPersist *New(OIStream *s){return new Blb(s);}
+	static OMeta _metaClass;
+
+	bool ok(void)const
+	{
+		char buf[4000];
+		fill(buf,_key);
+		return _blob.size() == size(_key) &&
+			   memcmp(_blob.const_getBlob(),buf,_blob.size()) == 0;
+	}
+
+private:
+	static size_t size(long key){return (size_t)(key*13 % 4000);}
+	static void fill(char *buf,long key)
+	{
+		for(size_t i = 0; i < size(key); i++)
+			buf[i] = (char)(i*7 + key);
+	}
+
+	long _key;
+	OBlobP _blob;
+};
+
+OMeta Blb::_metaClass(cBlbId,(Func)Blb::New,cOPersist,0);
+
+const OClassId_t cNodeId = 101;
+
+class Node : public OPersist
+// An object that refers to two others, for the XML test. Rec cannot be used
+// there, since its strings have control characters and bytes that are not
+// UTF-8, which the XML streams do not read back.
+{
+	typedef OPersist inherited;
+public:
+	Node(long key):_key(key),_next(0),_prev(0){}
+	Node(OIStream *in):inherited(in)
+	{
+		_key = in->readLong("key");
+		in->readObject((OPersist **)&_next,"next");
+		_prev = (Node *)in->readObject("prev");
+	}
+	void oWrite(OOStream *out)const
+	{
+		inherited::oWrite(out);
+		out->writeLong(_key,"key");
+		out->writeObject(_next,"next");
+		out->writeObject(_prev,"prev");
+	}
+	OMeta *meta(void)const{return &_metaClass;}
+	static OPersist *New(OIStream *s){return new Node(s);}
+	static OMeta _metaClass;
+
+	// Keys of the objects referred to, or -1. The next node is written
+	// later, except at the end, some far enough on that the streaming
+	// import commits the node before reading it. The previous one is always
+	// written earlier, since readObject(const char *) cannot refer forward.
+	// The streaming import keeps the nodes referred to in memory, so only
+	// some are.
+	static long nextKey(long key)
+	{
+		if(key % 5 != 1)
+			return -1;
+		return (key + (key % 10 == 1 ? 1601 : 17)) % cObjects;
+	}
+	static long prevKey(long key){return key % 3 == 2 ? key - 1 : -1;}
+	void link(Node **nodes)
+	{
+		_next = nextKey(_key) < 0 ? 0 : nodes[nextKey(_key)];
+		_prev = prevKey(_key) < 0 ? 0 : nodes[prevKey(_key)];
+	}
+	bool ok(void)const
+	{
+		return (_next ? _next->_key : -1) == nextKey(_key) &&
+			   (_prev ? _prev->_key : -1) == prevKey(_key);
+	}
+	long key(void)const{return _key;}
+
+private:
+	long _key;
+	Node *_next;
+	Node *_prev;
+};
+
+OMeta Node::_metaClass(cNodeId,(Func)Node::New,cOPersist,0);
+
+static void makeFile(const char *name)
+// Create a file of Rec objects that refer to each other, and some Blb objects.
+{
+	static Rec *recs[cObjects];
+	remove(name);
+	OFile file(name,OFILE_CREATE);
+	for(long key = 0; key < cObjects; key++)
+		recs[key] = new Rec(key);
+	for(long key = 0; key < cObjects; key++)
+	{
+		recs[key]->link(recs);
+		file.attach(recs[key],false);
+		if(key % 100 == 0)
+			file.attach(new Blb(key),false);
+	}
+	file.setRoot(recs[cRootKey]);
+	file.commit();
+}
+
+static void checkFile(const char *name)
+// Read every object of the file and check it.
+{
+	OFile file(name,OFILE_OPEN_READ_ONLY);
+	OIteratorT<Rec,cRecId> it(&file);
+	Rec *rec;
+	long n = 0;
+	while((rec = it++) != 0)
+	{
+		tCheck(rec->ok());
+		n++;
+	}
+	tCheck(n == cObjects);
+
+	OIteratorT<Blb,cBlbId> itb(&file);
+	Blb *blb;
+	n = 0;
+	while((blb = itb++) != 0)
+	{
+		tCheck(blb->ok());
+		n++;
+	}
+	tCheck(n == cObjects / 100);
+
+	tCheck(file.getRoot() != 0 && ((Rec *)file.getRoot())->key() == cRootKey);
+}
+
+template<class Out>
+static string exportFile(const char *name,Out *)
+// Return the objects of the file written by an Out stream.
+{
+	OFile file(name,OFILE_OPEN_READ_ONLY);
+	ostringstream out;
+	Out writer(&file,out);
+	writer.writeObjects("xchgtest");
+	return out.str();
+}
+
+template<class In>
+static void importFile(const char *name,const string &doc,bool streaming,In *)
+// Create a file from a document, read with an In stream. When streaming,
+// the objects are committed as they are read.
+{
+	remove(name);
+	OFile file(name,OFILE_CREATE);
+	istringstream in(doc);
+	In reader(&file,in);
+	if(streaming)
+	{
+		file.setAutoCommit();
+		OFile::setObjectThreshold(1500);
+		reader.setStreaming();
+	}
+	reader.readObjects();
+	file.commit();
+	OFile::setObjectThreshold(LONG_MAX);
+}
+
+static void testBinary(void)
+// Export to the binary format and import it again.
+{
+	makeFile("xchg.db");
+	checkFile("xchg.db");
+	string doc = exportFile("xchg.db",(OOStreamBinary *)0);
+
+	importFile("xchgbin.db",doc,false,(OIStreamBinary *)0);
+	OFile::purgeAll();
+	checkFile("xchgbin.db");
+	cout << "Binary import OK\n";
+
+	importFile("xchgbins.db",doc,true,(OIStreamBinary *)0);
+	OFile::purgeAll();
+	checkFile("xchgbins.db");
+	cout << "Binary streaming import OK\n";
+}
+
+static void testBinarySwapped(void)
+// A document written with the other byte order is read.
+{
+	Rec::_swapReals = true;
+	string doc = exportFile("xchg.db",(OOStreamBinary *)0);
+	Rec::_swapReals = false;
+	// Reverse the byte order mark.
+	tCheck(doc.compare(0,4,"OFBX") == 0);
+	reverse(doc.begin() + 5,doc.begin() + 9);
+
+	importFile("xchgswap.db",doc,false,(OIStreamBinary *)0);
+	OFile::purgeAll();
+	checkFile("xchgswap.db");
+	cout << "Binary import of the other byte order OK\n";
+}
+
+template<class Out>
+static string exportParallel(const char *name,Out *)
+// Return the objects of the file written by an Out stream with 4 threads.
+{
+	OFile file(name,OFILE_OPEN_READ_ONLY);
+	ostringstream out;
+	Out writer(&file,out);
+	writer.writeObjectsParallel("xchgtest",cOPersist,true,4);
+	return out.str();
+}
+
+static void testJSON(void)
+// Export to JSON and import it again.
+{
+	string doc = exportFile("xchg.db",(OOStreamJSON *)0);
+	// Bytes that are not UTF-8 are escaped.
+	tCheck(doc.find("\\udcff\\udce9") != string::npos);
+	tCheck(doc.find('\xff') == string::npos);
+	tCheck(exportParallel("xchg.db",(OOStreamJSON *)0) == doc);
+
+	importFile("xchgjson.db",doc,false,(OIStreamJSON *)0);
+	OFile::purgeAll();
+	checkFile("xchgjson.db");
+	cout << "JSON import OK\n";
+
+	importFile("xchgjsons.db",doc,true,(OIStreamJSON *)0);
+	OFile::purgeAll();
+	checkFile("xchgjsons.db");
+	cout << "JSON streaming import OK\n";
+
+	// Reals are written and read with a '.' in a locale that has a decimal
+	// comma, if there is one.
+	const char *locales[] = {"de_DE.UTF-8","de_DE","fr_FR.UTF-8","fr_FR",0};
+	for(int i = 0; locales[i]; i++)
+	{
+		if(!setlocale(LC_NUMERIC,locales[i]))
+			continue;
+		tCheck(exportFile("xchg.db",(OOStreamJSON *)0) == doc);
+		importFile("xchgjsonl.db",doc,false,(OIStreamJSON *)0);
+		OFile::purgeAll();
+		checkFile("xchgjsonl.db");
+		setlocale(LC_NUMERIC,"C");
+		cout << "JSON in locale " << locales[i] << " OK\n";
+		break;
+	}
+}
+
+static void makeNodeFile(const char *name)
+// Create a file of Node objects that refer to each other.
+{
+	static Node *nodes[cObjects];
+	remove(name);
+	OFile file(name,OFILE_CREATE);
+	for(long key = 0; key < cObjects; key++)
+		nodes[key] = new Node(key);
+	for(long key = 0; key < cObjects; key++)
+	{
+		nodes[key]->link(nodes);
+		file.attach(nodes[key],false);
+	}
+	file.setRoot(nodes[cRootKey]);
+	file.commit();
+}
+
+static void checkNodeFile(const char *name)
+// Read every Node of the file and check it.
+{
+	OFile file(name,OFILE_OPEN_READ_ONLY);
+	OIteratorT<Node,cNodeId> it(&file);
+	Node *node;
+	long n = 0;
+	while((node = it++) != 0)
+	{
+		tCheck(node->ok());
+		n++;
+	}
+	tCheck(n == cObjects);
+	tCheck(file.getRoot() != 0 && ((Node *)file.getRoot())->key() == cRootKey);
+}
+
+static string exportXMLFlat(const char *name)
+// Return the objects of the file written as flat XML, in which every
+// reference is an id, so that many are to objects later in the document.
+{
+	OFile file(name,OFILE_OPEN_READ_ONLY);
+	ostringstream out;
+	OOStreamXML writer(&file,out);
+	writer.setXMLStyle(OOStreamXML::cFlat);
+	writer.writeObjects("xchgtest");
+	return out.str();
+}
+
+static void testXMLFlat(void)
+// Export to flat XML and import it as a whole and by streaming. Both files
+// have the same objects, which export the same document.
+{
+	makeNodeFile("xchgnode.db");
+	string doc = exportXMLFlat("xchgnode.db");
+	tCheck(doc.find("IDREF") != string::npos);
+
+	importFile("xchgxml.db",doc,false,(OIStreamXML *)0);
+	OFile::purgeAll();
+	checkNodeFile("xchgxml.db");
+	cout << "Flat XML import OK\n";
+
+	importFile("xchgxmls.db",doc,true,(OIStreamXML *)0);
+	OFile::purgeAll();
+	checkNodeFile("xchgxmls.db");
+	cout << "Flat XML streaming import OK\n";
+
+	string plain = exportXMLFlat("xchgxml.db");
+	tCheck(exportXMLFlat("xchgxmls.db") == plain);
+	tCheck(plain == doc);
+	cout << "Flat XML imports the same OK\n";
+}
+
+int main()
+{
+	try{
+		testBinary();
+		testBinarySwapped();
+		testJSON();
+		testXMLFlat();
+	}catch(OFileErr &x){
+		cout << x.why() << endl;
+		return 1;
+	}
+	cout << "Finished\n";
+	return 0;
+}